@@ -0,0 +1,107 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "autoscale.h"
+#include <math.h> /* INFINITY, isfinite */
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Return the "nice" tick step (1, 2 or 5 times a power of ten) that divides
+ * the specified range into approximately 'AUTOSCALE_NUM_TICKS' intervals.
+ */
+static float nice_tick_step(float range) {
+    const float raw_step  = range / AUTOSCALE_NUM_TICKS;
+    const float magnitude = powf(10.f, floorf(log10f(raw_step)));
+    const float fraction  = raw_step / magnitude;
+
+    if (fraction <= 1.f)
+        return magnitude;
+    if (fraction <= 2.f)
+        return 2.f * magnitude;
+    if (fraction <= 5.f)
+        return 5.f * magnitude;
+    return 10.f * magnitude;
+}
+
+/*
+ * Calculate the range that fits the specified data, with a margin, rounded
+ * outwards to multiples of its tick step.
+ */
+static void fit_range(float data_min,
+                      float data_max,
+                      float* min_value,
+                      float* max_value,
+                      float* tick_step) {
+    /* Constant data still needs a non-empty range */
+    const float range  = data_max - data_min;
+    const float margin = (range > 0.f) ? range * AUTOSCALE_MARGIN : 1.f;
+
+    const float min  = data_min - margin;
+    const float max  = data_max + margin;
+    const float step = nice_tick_step(max - min);
+
+    *min_value = floorf(min / step) * step;
+    *max_value = ceilf(max / step) * step;
+    *tick_step = step;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void autoscale_init(AutoScale* scale, int shrink_dwell) {
+    scale->shrink_dwell    = shrink_dwell;
+    scale->min_value       = INFINITY;
+    scale->max_value       = -INFINITY;
+    scale->tick_step       = 0.f;
+    scale->pending_samples = 0;
+}
+
+bool autoscale_update(AutoScale* scale,
+                      float data_min,
+                      float data_max,
+                      int num_samples) {
+    /* Keep the current range if there is no valid data to fit */
+    if (!isfinite(data_min) || !isfinite(data_max))
+        return false;
+
+    float min_value, max_value, tick_step;
+    fit_range(data_min, data_max, &min_value, &max_value, &tick_step);
+
+    const bool fits =
+      data_min >= scale->min_value && data_max <= scale->max_value;
+    if (min_value == scale->min_value && max_value == scale->max_value) {
+        scale->pending_samples = 0;
+        return false;
+    }
+
+    /*
+     * If the data still fits in the current range, it's only replaced once
+     * the data has needed a different one for long enough.
+     */
+    if (fits) {
+        scale->pending_samples += num_samples;
+        if (scale->pending_samples < scale->shrink_dwell)
+            return false;
+    }
+
+    scale->min_value       = min_value;
+    scale->max_value       = max_value;
+    scale->tick_step       = tick_step;
+    scale->pending_samples = 0;
+    return true;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef AUTOSCALE_H_
+#define AUTOSCALE_H_ 1
+
+#include <stdbool.h>
+
+/*
+ * Margin added above and below the data when fitting a range, as a fraction of
+ * the data range.
+ */
+#define AUTOSCALE_MARGIN 0.1f
+
+/*
+ * Desired number of intervals between ticks in a range. The actual number
+ * depends on how the range is rounded to a "nice" tick step (1, 2 or 5 times a
+ * power of ten).
+ */
+#define AUTOSCALE_NUM_TICKS 5
+
+/*
+ * Structure representing the state of an auto-scaling policy, which decides
+ * the range of values displayed in a chart axis.
+ *
+ * The range always starts and ends at multiples of its tick step. It expands as
+ * soon as the data leaves it, but it only shrinks (or is otherwise refitted)
+ * after the data has needed a different range for a while, so the scale
+ * doesn't change with every sample.
+ */
+typedef struct AutoScale {
+    /*
+     * Number of samples for which the data must need a different range before
+     * the current range is replaced, unless the data doesn't fit in it.
+     */
+    int shrink_dwell;
+
+    /* Current range, and distance between its ticks */
+    float min_value;
+    float max_value;
+    float tick_step;
+
+    /* Number of samples for which the data has needed a different range */
+    int pending_samples;
+} AutoScale;
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Initialize the specified auto-scaling policy, with the specified dwell time,
+ * in samples, before shrinking the range. The range is empty until the first
+ * call to 'autoscale_update'.
+ */
+void autoscale_init(AutoScale* scale, int shrink_dwell);
+
+/*
+ * Update the range of the specified auto-scaling policy, after 'num_samples'
+ * new samples were received. The 'data_min' and 'data_max' arguments are the
+ * extremes of the data that is currently displayed. Returns true if the range
+ * changed, and therefore the data needs to be converted to screen coordinates
+ * again.
+ */
+bool autoscale_update(AutoScale* scale,
+                      float data_min,
+                      float data_max,
+                      int num_samples);
+
+#endif /* AUTOSCALE_H_ */
@@ -19,23 +19,802 @@
 #include "chart.h"
 #include <stdint.h>
 #include <assert.h>
+#include <math.h> /* INFINITY, NAN */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "util.h"
 #include "render.h"
 
-void chart_init(ChartCtx* ctx, int num_channels, int history_size) {
-    ctx->num_channels = num_channels;
-    ctx->history_size = history_size;
-    ctx->write_pos    = 0;
-    ctx->min_value    = 0;
-    ctx->max_value    = 0;
-
-    const size_t circular_buffer_size =
-      ctx->num_channels * ctx->history_size * sizeof(float);
-    ctx->data = malloc(circular_buffer_size);
-    if (ctx->data == NULL) {
+/*
+ * Maximum number of buckets converted to screen coordinates at once by
+ * 'chart_render_history', which are then drawn with a single
+ * 'render_draw_envelope' call.
+ */
+#define ENVELOPE_CHUNK_SIZE 64
+
+/*
+ * Number of fractional bits of the fixed-point numbers used for converting
+ * quantized values to screen coordinates. See 'ChartQuantizer'.
+ */
+#define Y_FRACTION_BITS 32
+
+/*
+ * Colors for different channels, in RGB888 format. They are stored in the
+ * palette of the render context, starting at 'CHART_FIRST_COLOR'.
+ */
+static const uint32_t channel_colors[] = {
+    0xFF0000, /* Red */
+    0x00FF00, /* Green */
+    0x0000FF, /* Blue */
+    0xFFFF00, /* Yellow */
+    0xFF00FF, /* Magenta */
+    0x00FFFF, /* Cyan */
+    0xFFFFFF, /* White */
+    0xFF8800, /* Orange */
+};
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Get the palette index used for drawing the specified channel.
+ */
+static inline uint8_t get_channel_color(int channel) {
+    return CHART_FIRST_COLOR + channel % LENGTH(channel_colors);
+}
+
+/*
+ * Convert a value to a code of the specified quantizer, and vice versa.
+ */
+static inline uint16_t value_to_code(const ChartQuantizer* quantizer,
+                                     float value) {
+    const float code = roundf((value - quantizer->format.offset) /
+                              quantizer->format.scale);
+
+    /* NaN fails the comparison, so it's stored as zero */
+    return (code > 0.f) ? MIN(code, (float)UINT16_MAX) : 0;
+}
+
+static inline float code_to_value(const ChartQuantizer* quantizer,
+                                  uint16_t code) {
+    return code * quantizer->format.scale + quantizer->format.offset;
+}
+
+/*
+ * Get the minimum or maximum of the column at the specified position of the
+ * circular buffer of the specified channel, for comparing it with other
+ * columns of the same channel. When the values are quantized, their codes are
+ * returned, which have the same order.
+ */
+static inline float get_min(const ChartCtx* ctx, int channel, int pos) {
+    const int idx = ctx->history_size * channel + pos;
+    return (ctx->quantizers != NULL) ? ctx->min_codes[idx] : ctx->mins[idx];
+}
+
+static inline float get_max(const ChartCtx* ctx, int channel, int pos) {
+    const int idx = ctx->history_size * channel + pos;
+    return (ctx->quantizers != NULL) ? ctx->max_codes[idx] : ctx->maxs[idx];
+}
+
+/*
+ * Get the actual minimum or maximum value of the column at the specified
+ * position of the circular buffer of the specified channel.
+ */
+static inline float get_min_value(const ChartCtx* ctx, int channel, int pos) {
+    const float min = get_min(ctx, channel, pos);
+    return (ctx->quantizers != NULL)
+             ? code_to_value(&ctx->quantizers[channel], min)
+             : min;
+}
+
+static inline float get_max_value(const ChartCtx* ctx, int channel, int pos) {
+    const float max = get_max(ctx, channel, pos);
+    return (ctx->quantizers != NULL)
+             ? code_to_value(&ctx->quantizers[channel], max)
+             : max;
+}
+
+static inline int deque_front(const ChartDeque* deque) {
+    return deque->positions[deque->head];
+}
+
+static inline int deque_back(const ChartCtx* ctx, const ChartDeque* deque) {
+    return deque->positions[(deque->head + deque->size - 1) %
+                            ctx->history_size];
+}
+
+static inline void deque_pop_front(const ChartCtx* ctx, ChartDeque* deque) {
+    deque->head = (deque->head + 1) % ctx->history_size;
+    deque->size--;
+}
+
+static inline void deque_push_back(const ChartCtx* ctx,
+                                   ChartDeque* deque,
+                                   int pos) {
+    deque->positions[(deque->head + deque->size) % ctx->history_size] = pos;
+    deque->size++;
+}
+
+/*
+ * Remove the column at 'pos' from the monotonic deques of the specified
+ * channel, before it's overwritten. It's the oldest column in the window, so
+ * if it's an extreme, it's at the front of its deque.
+ */
+static void evict_column(ChartCtx* ctx, int channel, int pos) {
+    ChartDeque* min_deque = &ctx->min_deques[channel];
+    ChartDeque* max_deque = &ctx->max_deques[channel];
+
+    if (min_deque->size > 0 && deque_front(min_deque) == pos)
+        deque_pop_front(ctx, min_deque);
+    if (max_deque->size > 0 && deque_front(max_deque) == pos)
+        deque_pop_front(ctx, max_deque);
+}
+
+/*
+ * Update the monotonic deques of the specified channel after the column at
+ * 'pos', which must be the newest one, was written. If 'new_column' is false,
+ * the column was already in the deques, and only its extremes were updated.
+ */
+static void update_deques(ChartCtx* ctx,
+                          int channel,
+                          int pos,
+                          bool new_column) {
+    ChartDeque* min_deque = &ctx->min_deques[channel];
+    ChartDeque* max_deque = &ctx->max_deques[channel];
+    const float min       = get_min(ctx, channel, pos);
+    const float max       = get_max(ctx, channel, pos);
+
+    if (new_column) {
+        evict_column(ctx, channel, pos);
+    } else {
+        /*
+         * Nothing was pushed after the newest column, so it's at the back of
+         * both deques. It's pushed again below.
+         */
+        min_deque->size--;
+        max_deque->size--;
+    }
+
+    /*
+     * Older values that are not smaller (or greater) than the new one can
+     * never be the extreme of the window again, so they are discarded.
+     */
+    while (min_deque->size > 0 &&
+           get_min(ctx, channel, deque_back(ctx, min_deque)) >= min)
+        min_deque->size--;
+    while (max_deque->size > 0 &&
+           get_max(ctx, channel, deque_back(ctx, max_deque)) <= max)
+        max_deque->size--;
+
+    deque_push_back(ctx, min_deque, pos);
+    deque_push_back(ctx, max_deque, pos);
+}
+
+/*
+ * Convert a value of the chart to a screen Y coordinate (inverted, 0 at top),
+ * clamped to the display bounds, using the current scale of the specified
+ * axis.
+ */
+static inline int16_t value_to_y(const ChartCtx* ctx,
+                                 const ChartAxis* axis,
+                                 float value) {
+    const int height = ctx->display_height;
+
+    /* Also handles NaN, which is drawn at the bottom */
+    const float scaled = (value - axis->y_min_value) * axis->y_scale;
+    if (!(scaled > 0.0f))
+        return height - 1;
+    if (scaled >= height)
+        return 0;
+    return MIN(height - (int)scaled, height - 1);
+}
+
+/*
+ * Convert a code of the specified quantizer to a screen Y coordinate, like
+ * 'value_to_y', but using fixed-point arithmetic.
+ */
+static inline int16_t code_to_y(const ChartCtx* ctx,
+                                const ChartQuantizer* quantizer,
+                                uint16_t code) {
+    const int height     = ctx->display_height;
+    const int64_t scaled = code * quantizer->y_mul + quantizer->y_add;
+    if (scaled <= 0)
+        return height - 1;
+    if (scaled >= ((int64_t)height << Y_FRACTION_BITS))
+        return 0;
+    return MIN(height - (int)(scaled >> Y_FRACTION_BITS), height - 1);
+}
+
+/*
+ * Calculate the offset and scale factor used for converting the values of the
+ * specified axis to screen coordinates, from its current range. The range is
+ * never empty (see 'AutoScale').
+ */
+static void update_axis_projection(const ChartCtx* ctx, ChartAxis* axis) {
+    const float min = axis->scale.min_value;
+    const float max = axis->scale.max_value;
+
+    axis->y_min_value = min;
+    axis->y_scale     = (float)ctx->display_height / (max - min);
+}
+
+/*
+ * Calculate the fixed-point factor and term of the specified quantizer from
+ * the projection of its axis. The conversion of 'value_to_y' is rewritten in
+ * terms of the code as 'code * y_mul + y_add'.
+ */
+static void update_quantizer_projection(ChartQuantizer* quantizer,
+                                        const ChartAxis* axis) {
+    const double one    = (int64_t)1 << Y_FRACTION_BITS;
+    const double scale  = quantizer->format.scale;
+    const double offset = quantizer->format.offset;
+
+    quantizer->y_mul = llround(scale * axis->y_scale * one);
+    quantizer->y_add =
+      llround((offset - axis->y_min_value) * axis->y_scale * one);
+}
+
+/*
+ * Convert the specified range of values (or codes) of a channel to screen
+ * coordinates, using its axis.
+ */
+static void convert_channel_ys(ChartCtx* ctx,
+                               int channel,
+                               const ChartAxis* axis,
+                               int first,
+                               int last) {
+    if (ctx->quantizers != NULL) {
+        const ChartQuantizer* quantizer = &ctx->quantizers[channel];
+        for (int i = first; i <= last; i++)
+            ctx->tops[i] = code_to_y(ctx, quantizer, ctx->max_codes[i]);
+        if (ctx->bottoms == ctx->tops)
+            return;
+        for (int i = first; i <= last; i++)
+            ctx->bottoms[i] = code_to_y(ctx, quantizer, ctx->min_codes[i]);
+    } else {
+        for (int i = first; i <= last; i++)
+            ctx->tops[i] = value_to_y(ctx, axis, ctx->maxs[i]);
+        if (ctx->bottoms == ctx->tops)
+            return;
+        for (int i = first; i <= last; i++)
+            ctx->bottoms[i] = value_to_y(ctx, axis, ctx->mins[i]);
+    }
+}
+
+/*
+ * Update the projection of the specified axis, and convert all values of its
+ * channels to screen coordinates again.
+ */
+static void update_axis_ys(ChartCtx* ctx, int axis_index) {
+    ChartAxis* axis = &ctx->axes[axis_index];
+    update_axis_projection(ctx, axis);
+
+    for (int cur_channel = 0; cur_channel < ctx->num_channels; cur_channel++) {
+        if (ctx->channel_axes[cur_channel] != axis_index)
+            continue;
+
+        if (ctx->quantizers != NULL)
+            update_quantizer_projection(&ctx->quantizers[cur_channel], axis);
+
+        /* The order doesn't matter, so the buffer is not traversed in order */
+        const int offset = ctx->history_size * cur_channel;
+        convert_channel_ys(ctx,
+                           cur_channel,
+                           axis,
+                           offset,
+                           offset + ctx->history_size - 1);
+    }
+}
+
+/*
+ * Get the number of columns that should be started for a sample with the
+ * specified timestamp, updating the period of the newest column if necessary.
+ * See 'chart_push'.
+ */
+static int get_num_new_columns(ChartCtx* ctx, int64_t timestamp_us) {
+    if (ctx->column_period_us == 0)
+        return (ctx->num_column_samples >= ctx->samples_per_column) ? 1 : 0;
+
+    /* Samples older than the newest column are collapsed into it */
+    const int64_t period = timestamp_us / ctx->column_period_us;
+    if (period <= ctx->newest_period)
+        return 0;
+
+    const int64_t num_new_columns = period - ctx->newest_period;
+    ctx->newest_period            = period;
+    return MIN(num_new_columns, ctx->history_size);
+}
+
+/*
+ * Start a new column at the write position, and advance it. Returns the
+ * position of the new column in the circular buffers.
+ */
+static int start_column(ChartCtx* ctx) {
+    const int pos           = ctx->write_pos;
+    ctx->num_column_samples = 0;
+
+    ctx->write_pos++;
+    if (ctx->write_pos >= ctx->history_size)
+        ctx->write_pos = 0;
+
+    return pos;
+}
+
+/*
+ * Start a new column without samples, which is not drawn. The column it
+ * overwrites is removed from the deques, and nothing is pushed to them.
+ */
+static void start_empty_column(ChartCtx* ctx) {
+    const int pos           = start_column(ctx);
+    ctx->empty_columns[pos] = true;
+
+    for (int cur_channel = 0; cur_channel < ctx->num_channels; cur_channel++)
+        evict_column(ctx, cur_channel, pos);
+}
+
+/*
+ * Write a value of the specified channel to the column at 'idx' of the
+ * circular buffers, which is either new or the newest one, depending on
+ * 'new_column'. The value is quantized if necessary.
+ */
+static void write_value(ChartCtx* ctx,
+                        int channel,
+                        int idx,
+                        float value,
+                        bool new_column) {
+    if (ctx->quantizers != NULL) {
+        const uint16_t code = value_to_code(&ctx->quantizers[channel], value);
+        ctx->codes[idx]     = code;
+        if (new_column) {
+            ctx->min_codes[idx] = code;
+            ctx->max_codes[idx] = code;
+        } else {
+            ctx->min_codes[idx] = MIN(ctx->min_codes[idx], code);
+            ctx->max_codes[idx] = MAX(ctx->max_codes[idx], code);
+        }
+    } else {
+        ctx->data[idx] = value;
+        if (new_column) {
+            ctx->mins[idx] = value;
+            ctx->maxs[idx] = value;
+        } else {
+            ctx->mins[idx] = fminf(ctx->mins[idx], value);
+            ctx->maxs[idx] = fmaxf(ctx->maxs[idx], value);
+        }
+    }
+}
+
+/*
+ * Add a bucket (or a sample) of the specified channel to the pending bucket of
+ * the specified tier.
+ */
+static inline void tier_accumulate(ChartTier* tier,
+                                   int channel,
+                                   const ChartBucket* bucket) {
+    ChartBucket* pending = &tier->pending[channel];
+    if (tier->num_pending == 0) {
+        *pending = *bucket;
+        return;
+    }
+
+    pending->min = fminf(pending->min, bucket->min);
+    pending->max = fmaxf(pending->max, bucket->max);
+    pending->mean += bucket->mean;
+}
+
+/*
+ * Add a set of values, one per channel, to the downsampled histories of the
+ * specified chart. Each completed bucket is added to the next tier, so on
+ * average, less than two buckets are updated per channel.
+ */
+static void update_tiers(ChartCtx* ctx, const float* values) {
+    if (ctx->num_tiers == 0)
+        return;
+
+    for (int cur_channel = 0; cur_channel < ctx->num_channels; cur_channel++) {
+        const float value = values[cur_channel];
+        tier_accumulate(&ctx->tiers[0],
+                        cur_channel,
+                        &(ChartBucket){ value, value, value });
+    }
+
+    for (int i = 0; i < ctx->num_tiers; i++) {
+        ChartTier* tier = &ctx->tiers[i];
+        if (++tier->num_pending < CHART_TIER_FACTOR)
+            return;
+
+        /* The pending buckets are complete, so they can be stored */
+        ChartTier* next_tier = (i + 1 < ctx->num_tiers) ? tier + 1 : NULL;
+        for (int cur_channel = 0; cur_channel < ctx->num_channels;
+             cur_channel++) {
+            ChartBucket* bucket =
+              &tier->buckets[tier->size * cur_channel + tier->write_pos];
+            *bucket = tier->pending[cur_channel];
+            bucket->mean /= CHART_TIER_FACTOR;
+
+            if (next_tier != NULL)
+                tier_accumulate(next_tier, cur_channel, bucket);
+        }
+        tier->num_pending = 0;
+
+        tier->write_pos++;
+        if (tier->write_pos >= tier->size)
+            tier->write_pos = 0;
+        if (tier->num_buckets < tier->size)
+            tier->num_buckets++;
+    }
+}
+
+/*
+ * Draw consecutive columns of a channel as an envelope, like
+ * 'render_draw_envelope', skipping the columns marked in 'empty'. The columns
+ * after an empty one are not connected to it. If 'empty' is NULL, no column is
+ * empty.
+ */
+static void draw_envelope_runs(RenderCtx* render_ctx,
+                               int x0,
+                               const int16_t* tops,
+                               const int16_t* bottoms,
+                               const bool* empty,
+                               int num_columns,
+                               uint8_t color) {
+    if (empty == NULL) {
+        render_draw_envelope(render_ctx, x0, tops, bottoms, num_columns, color);
+        return;
+    }
+
+    int start = 0;
+    while (start < num_columns) {
+        if (empty[start]) {
+            start++;
+            continue;
+        }
+
+        int end = start + 1;
+        while (end < num_columns && !empty[end])
+            end++;
+
+        /*
+         * The first column of a run after an empty one is only connected to
+         * itself, so its own envelope is drawn.
+         */
+        if (start > 0) {
+            const int16_t run_tops[]    = { tops[start], tops[start] };
+            const int16_t run_bottoms[] = { bottoms[start], bottoms[start] };
+            render_draw_envelope(render_ctx,
+                                 x0 + start - 1,
+                                 run_tops,
+                                 run_bottoms,
+                                 LENGTH(run_tops),
+                                 color);
+        }
+
+        render_draw_envelope(render_ctx,
+                             x0 + start,
+                             &tops[start],
+                             &bottoms[start],
+                             end - start,
+                             color);
+        start = end;
+    }
+}
+
+/*
+ * Draw the specified number of consecutive buckets of a channel, starting at
+ * position 'first_pos' of the specified tier, as an envelope whose first column
+ * is at 'x0'. The values are converted to screen coordinates with the specified
+ * axis.
+ */
+static void render_tier_channel(const ChartCtx* chart_ctx,
+                                RenderCtx* render_ctx,
+                                const ChartTier* tier,
+                                const ChartAxis* axis,
+                                int channel,
+                                int first_pos,
+                                int x0,
+                                int num_buckets) {
+    const ChartBucket* buckets = &tier->buckets[tier->size * channel];
+    const uint8_t color        = get_channel_color(channel);
+
+    /* Consecutive chunks share a column, like in 'chart_render' */
+    int16_t tops[ENVELOPE_CHUNK_SIZE];
+    int16_t bottoms[ENVELOPE_CHUNK_SIZE];
+    for (int x = 0; x < num_buckets - 1; x += ENVELOPE_CHUNK_SIZE - 1) {
+        const int num_columns = MIN(ENVELOPE_CHUNK_SIZE, num_buckets - x);
+        for (int i = 0; i < num_columns; i++) {
+            const ChartBucket* bucket =
+              &buckets[(first_pos + x + i) % tier->size];
+            tops[i]    = value_to_y(chart_ctx, axis, bucket->max);
+            bottoms[i] = value_to_y(chart_ctx, axis, bucket->min);
+        }
+
+        render_draw_envelope(render_ctx,
+                             x0 + x,
+                             tops,
+                             bottoms,
+                             num_columns,
+                             color);
+    }
+}
+
+/*
+ * Decode the last 'num_samples' samples of the log of the specified chart,
+ * which must contain them, and collapse them into 'num_columns' columns of
+ * 'log_columns'.
+ *
+ * If the columns of the chart are started by time, the columns span the time
+ * between the first and last samples, and the ones without samples are marked
+ * as empty. Their extremes are NaN, so they are ignored when scaling.
+ * Otherwise, each column contains the same number of samples (rounded).
+ */
+static void collapse_log_columns(ChartCtx* chart_ctx,
+                                 int64_t num_samples,
+                                 int num_columns) {
+    const int num_values = chart_ctx->num_channels * chart_ctx->history_size;
+    float* mins          = chart_ctx->log_columns;
+    float* maxs          = &chart_ctx->log_columns[num_values];
+    bool* empty          = chart_ctx->log_empty_columns;
+    for (int i = 0; i < num_columns; i++)
+        empty[i] = true;
+
+    SampleLogReader reader;
+    sample_log_seek(&reader,
+                    &chart_ctx->log,
+                    chart_ctx->log.num_samples - num_samples);
+
+    /* The encoder state contains the timestamp of the newest sample */
+    const bool by_time           = (chart_ctx->column_period_us > 0);
+    const int64_t last_timestamp = chart_ctx->log.state.timestamp;
+    int64_t first_timestamp      = 0;
+
+    int64_t timestamp;
+    float values[SAMPLE_LOG_MAX_CHANNELS];
+    for (int64_t i = 0; i < num_samples; i++) {
+        if (!sample_log_read(&reader, &timestamp, values))
+            break;
+        if (i == 0)
+            first_timestamp = timestamp;
+
+        const int column =
+          by_time ? (timestamp - first_timestamp) * num_columns /
+                      (last_timestamp - first_timestamp + 1)
+                  : i * num_columns / num_samples;
+        const bool new_column = empty[column];
+        empty[column]         = false;
+
+        for (int cur_channel = 0; cur_channel < chart_ctx->num_channels;
+             cur_channel++) {
+            const int idx     = chart_ctx->history_size * cur_channel + column;
+            const float value = values[cur_channel];
+            if (new_column) {
+                mins[idx] = value;
+                maxs[idx] = value;
+            } else {
+                mins[idx] = fminf(mins[idx], value);
+                maxs[idx] = fmaxf(maxs[idx], value);
+            }
+        }
+    }
+
+    for (int column = 0; column < num_columns; column++) {
+        if (!empty[column])
+            continue;
+
+        for (int cur_channel = 0; cur_channel < chart_ctx->num_channels;
+             cur_channel++) {
+            const int idx = chart_ctx->history_size * cur_channel + column;
+            mins[idx]     = NAN;
+            maxs[idx]     = NAN;
+        }
+    }
+}
+
+/*
+ * Draw the first 'num_columns' columns of 'log_columns' of a channel as an
+ * envelope whose first column is at 'x0', like 'render_tier_channel', skipping
+ * the empty ones.
+ */
+static void render_log_channel(const ChartCtx* chart_ctx,
+                               RenderCtx* render_ctx,
+                               const ChartAxis* axis,
+                               int channel,
+                               int x0,
+                               int num_columns) {
+    const int num_values = chart_ctx->num_channels * chart_ctx->history_size;
+    const int offset     = chart_ctx->history_size * channel;
+    const float* mins    = &chart_ctx->log_columns[offset];
+    const float* maxs    = &chart_ctx->log_columns[num_values + offset];
+    const uint8_t color  = get_channel_color(channel);
+
+    int16_t tops[ENVELOPE_CHUNK_SIZE];
+    int16_t bottoms[ENVELOPE_CHUNK_SIZE];
+    for (int x = 0; x < num_columns - 1; x += ENVELOPE_CHUNK_SIZE - 1) {
+        const int num_chunk_columns = MIN(ENVELOPE_CHUNK_SIZE, num_columns - x);
+        for (int i = 0; i < num_chunk_columns; i++) {
+            tops[i]    = value_to_y(chart_ctx, axis, maxs[x + i]);
+            bottoms[i] = value_to_y(chart_ctx, axis, mins[x + i]);
+        }
+
+        draw_envelope_runs(render_ctx,
+                           x0 + x,
+                           tops,
+                           bottoms,
+                           &chart_ctx->log_empty_columns[x],
+                           num_chunk_columns,
+                           color);
+    }
+}
+
+/*
+ * Scale the specified axis to fit the specified range, for rendering a view of
+ * the history. Returns false if the range is not finite (e.g. because the axis
+ * is not used), in which case its channels shouldn't be drawn.
+ */
+static bool fit_view_axis(const ChartCtx* chart_ctx,
+                          ChartAxis* axis,
+                          float min,
+                          float max) {
+    autoscale_init(&axis->scale, 0);
+    if (!autoscale_update(&axis->scale, min, max, 0))
+        return false;
+
+    update_axis_projection(chart_ctx, axis);
+    return true;
+}
+
+/*
+ * Render the last 'num_samples' samples of the log of the specified chart,
+ * which must contain them. See 'chart_render_history'.
+ */
+static void render_log_history(ChartCtx* chart_ctx,
+                               RenderCtx* render_ctx,
+                               int num_samples) {
+    const int num_values  = chart_ctx->num_channels * chart_ctx->history_size;
+    const int width       = render_get_width(render_ctx);
+    const int num_columns =
+      MIN(MIN(width, chart_ctx->history_size), num_samples);
+
+    /* The stripes of a frame are drawn from the same columns */
+    if (chart_ctx->log_view_samples != num_samples ||
+        chart_ctx->log_view_columns != num_columns) {
+        collapse_log_columns(chart_ctx, num_samples, num_columns);
+        chart_ctx->log_view_samples = num_samples;
+        chart_ctx->log_view_columns = num_columns;
+    }
+
+    for (int axis_index = 0; axis_index < chart_ctx->num_channels;
+         axis_index++) {
+        float min = INFINITY;
+        float max = -INFINITY;
+        for (int cur_channel = 0; cur_channel < chart_ctx->num_channels;
+             cur_channel++) {
+            if (chart_ctx->channel_axes[cur_channel] != axis_index)
+                continue;
+
+            const int offset = chart_ctx->history_size * cur_channel;
+            for (int i = offset; i < offset + num_columns; i++) {
+                min = fminf(min, chart_ctx->log_columns[i]);
+                max = fmaxf(max, chart_ctx->log_columns[num_values + i]);
+            }
+        }
+
+        ChartAxis axis;
+        if (!fit_view_axis(chart_ctx, &axis, min, max))
+            continue;
+
+        for (int cur_channel = 0; cur_channel < chart_ctx->num_channels;
+             cur_channel++) {
+            if (chart_ctx->channel_axes[cur_channel] != axis_index)
+                continue;
+
+            render_log_channel(chart_ctx,
+                               render_ctx,
+                               &axis,
+                               cur_channel,
+                               width - num_columns,
+                               num_columns);
+        }
+    }
+}
+
+/*
+ * Store the extremes of the columns of the specified chart apart from their
+ * last values, and the bottoms of the columns apart from their tops, if they
+ * share their arrays because there is a single sample per column. The new
+ * arrays are copies of the shared ones.
+ */
+static void separate_extremes(ChartCtx* ctx) {
+    if (ctx->bottoms != ctx->tops)
+        return;
+
+    const int num_values = ctx->num_channels * ctx->history_size;
+    if (ctx->quantizers != NULL) {
+        const size_t array_size = num_values * sizeof(uint16_t);
+        ctx->codes              = realloc(ctx->codes, 3 * array_size);
+        if (ctx->codes == NULL) {
+            fprintf(stderr,
+                    "Failed to reallocate circular buffer for chart (%zu "
+                    "bytes)\n",
+                    3 * array_size);
+            abort();
+        }
+
+        ctx->min_codes = &ctx->codes[num_values];
+        ctx->max_codes = &ctx->codes[2 * num_values];
+        memcpy(ctx->min_codes, ctx->codes, array_size);
+        memcpy(ctx->max_codes, ctx->codes, array_size);
+    } else {
+        const size_t array_size = num_values * sizeof(float);
+        ctx->data               = realloc(ctx->data, 3 * array_size);
+        if (ctx->data == NULL) {
+            fprintf(stderr,
+                    "Failed to reallocate circular buffer for chart (%zu "
+                    "bytes)\n",
+                    3 * array_size);
+            abort();
+        }
+
+        ctx->mins = &ctx->data[num_values];
+        ctx->maxs = &ctx->data[2 * num_values];
+        memcpy(ctx->mins, ctx->data, array_size);
+        memcpy(ctx->maxs, ctx->data, array_size);
+    }
+
+    const size_t ys_size = num_values * sizeof(int16_t);
+    ctx->tops            = realloc(ctx->tops, 2 * ys_size);
+    if (ctx->tops == NULL) {
+        fprintf(stderr,
+                "Failed to reallocate screen coordinates for chart (%zu "
+                "bytes)\n",
+                2 * ys_size);
+        abort();
+    }
+
+    ctx->bottoms = &ctx->tops[num_values];
+    memcpy(ctx->bottoms, ctx->tops, ys_size);
+}
+
+/*----------------------------------------------------------------------------*/
+
+void chart_init(ChartCtx* ctx,
+                int num_channels,
+                int history_size,
+                int display_height,
+                int shrink_dwell,
+                int samples_per_column,
+                const ChartFormat* formats) {
+    assert(samples_per_column > 0);
+
+    ctx->num_channels         = num_channels;
+    ctx->history_size         = history_size;
+    ctx->display_height       = display_height;
+    ctx->samples_per_column   = samples_per_column;
+    ctx->write_pos            = 0;
+    ctx->num_unscaled_samples = 0;
+    ctx->tiers                = NULL;
+    ctx->num_tiers            = 0;
+    ctx->column_period_us     = 0;
+    ctx->empty_columns        = NULL;
+    ctx->log_columns          = NULL;
+    ctx->log_empty_columns    = NULL;
+    ctx->log_view_samples     = 0;
+    ctx->log_view_columns     = 0;
+
+    /* The initial columns are complete, so the first sample starts a new one */
+    ctx->num_column_samples = samples_per_column;
+
+    /*
+     * With more than one sample per column, the last value and the extremes
+     * of each column are stored separately, in a single allocation.
+     */
+    const int num_arrays = (samples_per_column > 1) ? 3 : 1;
+    const int num_values = ctx->num_channels * ctx->history_size;
+    const size_t value_size =
+      (formats != NULL) ? sizeof(uint16_t) : sizeof(float);
+    const size_t circular_buffer_size = num_arrays * num_values * value_size;
+    void* circular_buffers            = malloc(circular_buffer_size);
+    if (circular_buffers == NULL) {
         fprintf(stderr,
                 "Failed to allocate circular buffer for chart (%d channels of "
                 "%d history values; %zu bytes)\n",
@@ -45,113 +824,588 @@ void chart_init(ChartCtx* ctx, int num_channels, int history_size) {
         abort();
     }
 
-    for (size_t i = 0; i < ctx->num_channels * ctx->history_size; i++)
-        ctx->data[i] = 0.f;
+    if (formats != NULL) {
+        ctx->quantizers = malloc(ctx->num_channels * sizeof(ChartQuantizer));
+        if (ctx->quantizers == NULL) {
+            fprintf(stderr,
+                    "Failed to allocate quantizers for chart (%d channels)\n",
+                    ctx->num_channels);
+            abort();
+        }
+
+        ctx->data      = NULL;
+        ctx->mins      = NULL;
+        ctx->maxs      = NULL;
+        ctx->codes     = circular_buffers;
+        ctx->min_codes = &ctx->codes[(num_arrays > 1) ? num_values : 0];
+        ctx->max_codes = &ctx->codes[(num_arrays > 1) ? 2 * num_values : 0];
+
+        /* The initial values are zero, like when storing floats */
+        for (int i = 0; i < ctx->num_channels; i++) {
+            ChartQuantizer* quantizer = &ctx->quantizers[i];
+            quantizer->format         = formats[i];
+            assert(quantizer->format.scale > 0.f);
+
+            const uint16_t zero = value_to_code(quantizer, 0.f);
+            for (int j = 0; j < ctx->history_size; j++) {
+                const int idx       = ctx->history_size * i + j;
+                ctx->codes[idx]     = zero;
+                ctx->min_codes[idx] = zero;
+                ctx->max_codes[idx] = zero;
+            }
+        }
+    } else {
+        ctx->quantizers = NULL;
+        ctx->codes      = NULL;
+        ctx->min_codes  = NULL;
+        ctx->max_codes  = NULL;
+        ctx->data       = circular_buffers;
+        ctx->mins       = &ctx->data[(num_arrays > 1) ? num_values : 0];
+        ctx->maxs       = &ctx->data[(num_arrays > 1) ? 2 * num_values : 0];
+
+        for (int i = 0; i < num_arrays * num_values; i++)
+            ctx->data[i] = 0.f;
+    }
+
+    /* Similarly, the tops and bottoms of the columns are only stored apart */
+    const size_t ys_size =
+      (num_arrays > 1 ? 2 : 1) * num_values * sizeof(int16_t);
+    ctx->tops = malloc(ys_size);
+    if (ctx->tops == NULL) {
+        fprintf(stderr,
+                "Failed to allocate screen coordinates for chart (%zu bytes)\n",
+                ys_size);
+        abort();
+    }
+    ctx->bottoms = (num_arrays > 1) ? &ctx->tops[num_values] : ctx->tops;
+
+    /* Initially, each channel has its own axis */
+    ctx->axes         = malloc(ctx->num_channels * sizeof(ChartAxis));
+    ctx->channel_axes = malloc(ctx->num_channels * sizeof(int));
+    if (ctx->axes == NULL || ctx->channel_axes == NULL) {
+        fprintf(stderr,
+                "Failed to allocate axes for chart (%d channels)\n",
+                ctx->num_channels);
+        abort();
+    }
+
+    for (int i = 0; i < ctx->num_channels; i++) {
+        autoscale_init(&ctx->axes[i].scale, shrink_dwell);
+        ctx->channel_axes[i] = i;
+    }
+
+    /*
+     * Allocate the deques of all channels, and a single array for the
+     * positions stored in all of them.
+     */
+    const size_t positions_size =
+      2 * ctx->num_channels * ctx->history_size * sizeof(int);
+    ctx->min_deques = malloc(2 * ctx->num_channels * sizeof(ChartDeque));
+    int* positions  = malloc(positions_size);
+    if (ctx->min_deques == NULL || positions == NULL) {
+        fprintf(stderr,
+                "Failed to allocate min/max deques for chart (%zu bytes)\n",
+                positions_size);
+        abort();
+    }
+    ctx->max_deques = &ctx->min_deques[ctx->num_channels];
+
+    /*
+     * All values are initially zero, so the last position is both the minimum
+     * and the maximum of each channel; it will be the last one to be
+     * overwritten.
+     */
+    for (int i = 0; i < 2 * ctx->num_channels; i++) {
+        ChartDeque* deque   = &ctx->min_deques[i];
+        deque->positions    = &positions[ctx->history_size * i];
+        deque->head         = 0;
+        deque->size         = 1;
+        deque->positions[0] = ctx->history_size - 1;
+    }
+
+    /* Fit the initial ranges to the zeros, converting them to coordinates */
+    chart_update_minmax(ctx);
 }
 
 void chart_destroy(ChartCtx* ctx) {
     if (ctx->data != NULL) {
         free(ctx->data);
         ctx->data = NULL;
+        ctx->mins = NULL;
+        ctx->maxs = NULL;
+    }
+
+    if (ctx->quantizers != NULL) {
+        free(ctx->codes);
+        free(ctx->quantizers);
+        ctx->quantizers = NULL;
+        ctx->codes      = NULL;
+        ctx->min_codes  = NULL;
+        ctx->max_codes  = NULL;
+    }
+
+    if (ctx->tops != NULL) {
+        free(ctx->tops);
+        ctx->tops    = NULL;
+        ctx->bottoms = NULL;
+    }
+
+    if (ctx->axes != NULL) {
+        free(ctx->axes);
+        free(ctx->channel_axes);
+        ctx->axes         = NULL;
+        ctx->channel_axes = NULL;
+    }
+
+    if (ctx->min_deques != NULL) {
+        free(ctx->min_deques[0].positions);
+        free(ctx->min_deques);
+        ctx->min_deques = NULL;
+        ctx->max_deques = NULL;
+    }
+
+    if (ctx->tiers != NULL) {
+        for (int i = 0; i < ctx->num_tiers; i++)
+            free(ctx->tiers[i].buckets);
+        free(ctx->tiers);
+        ctx->tiers     = NULL;
+        ctx->num_tiers = 0;
+    }
+
+    if (ctx->empty_columns != NULL) {
+        free(ctx->empty_columns);
+        ctx->empty_columns = NULL;
+    }
+
+    if (ctx->log_columns != NULL) {
+        sample_log_destroy(&ctx->log);
+        free(ctx->log_columns);
+        ctx->log_columns       = NULL;
+        ctx->log_empty_columns = NULL;
+    }
+}
+
+void chart_init_tiers(ChartCtx* ctx, const size_t* budgets, int num_tiers) {
+    assert(ctx->tiers == NULL && num_tiers > 0);
+
+    ctx->tiers = malloc(num_tiers * sizeof(ChartTier));
+    if (ctx->tiers == NULL) {
+        fprintf(stderr,
+                "Failed to allocate history tiers for chart (%d tiers)\n",
+                num_tiers);
+        abort();
+    }
+    ctx->num_tiers = num_tiers;
+
+    /* Each tier needs a bucket per channel, plus a pending one */
+    const size_t row_size  = ctx->num_channels * sizeof(ChartBucket);
+    int samples_per_bucket = 1;
+    for (int i = 0; i < num_tiers; i++) {
+        assert(budgets[i] >= 2 * row_size);
+
+        ChartTier* tier = &ctx->tiers[i];
+        samples_per_bucket *= CHART_TIER_FACTOR;
+
+        tier->size      = budgets[i] / row_size - 1;
+        tier->num_bytes = (tier->size + 1) * row_size;
+        tier->buckets   = malloc(tier->num_bytes);
+        if (tier->buckets == NULL) {
+            fprintf(stderr,
+                    "Failed to allocate history tier %d for chart (%zu "
+                    "bytes)\n",
+                    i,
+                    tier->num_bytes);
+            abort();
+        }
+
+        tier->pending = &tier->buckets[tier->size * ctx->num_channels];
+
+        tier->write_pos          = 0;
+        tier->num_buckets        = 0;
+        tier->num_pending        = 0;
+        tier->samples_per_bucket = samples_per_bucket;
+    }
+}
+
+void chart_init_log(ChartCtx* ctx, size_t num_bytes) {
+    assert(ctx->log_columns == NULL);
+
+    /* The empty flags are stored after the extremes, in the same allocation */
+    const int num_values = ctx->num_channels * ctx->history_size;
+    const size_t columns_size =
+      2 * num_values * sizeof(float) + ctx->history_size * sizeof(bool);
+    assert(num_bytes > columns_size);
+
+    sample_log_init(&ctx->log, ctx->num_channels, num_bytes - columns_size);
+
+    ctx->log_columns = malloc(columns_size);
+    if (ctx->log_columns == NULL) {
+        fprintf(stderr,
+                "Failed to allocate log columns for chart (%zu bytes)\n",
+                columns_size);
+        abort();
+    }
+    ctx->log_empty_columns = (bool*)&ctx->log_columns[2 * num_values];
+}
+
+void chart_set_column_period(ChartCtx* ctx, int64_t period_us) {
+    assert(period_us > 0 && ctx->empty_columns == NULL);
+
+    ctx->empty_columns = malloc(ctx->history_size * sizeof(bool));
+    if (ctx->empty_columns == NULL) {
+        fprintf(stderr,
+                "Failed to allocate empty column flags for chart (%d "
+                "columns)\n",
+                ctx->history_size);
+        abort();
+    }
+
+    /*
+     * Several samples can be collapsed into a column even if a single one is
+     * expected, so the extremes of the columns are needed.
+     */
+    separate_extremes(ctx);
+
+    /*
+     * No column has samples yet, so none of them is drawn, and the deques are
+     * empty. The timestamps are not negative, so the first sample starts a new
+     * column.
+     */
+    for (int i = 0; i < ctx->history_size; i++)
+        ctx->empty_columns[i] = true;
+    for (int i = 0; i < ctx->num_channels; i++) {
+        ctx->min_deques[i].size = 0;
+        ctx->max_deques[i].size = 0;
+    }
+
+    ctx->column_period_us = period_us;
+    ctx->newest_period    = -1;
+}
+
+void chart_set_axes(ChartCtx* ctx, const int* channel_axes) {
+    for (int i = 0; i < ctx->num_channels; i++) {
+        assert(channel_axes[i] >= 0 && channel_axes[i] < ctx->num_channels);
+        ctx->channel_axes[i] = channel_axes[i];
+    }
+
+    /* Forget the current ranges, so all used axes are fitted again */
+    for (int i = 0; i < ctx->num_channels; i++) {
+        AutoScale* scale = &ctx->axes[i].scale;
+        autoscale_init(scale, scale->shrink_dwell);
+    }
+    chart_update_minmax(ctx);
+}
+
+void chart_set_colors(RenderCtx* render_ctx, float brightness) {
+    for (size_t i = 0; i < LENGTH(channel_colors); i++) {
+        const uint8_t r = ((channel_colors[i] >> 16) & 0xFF) * brightness;
+        const uint8_t g = ((channel_colors[i] >> 8) & 0xFF) * brightness;
+        const uint8_t b = (channel_colors[i] & 0xFF) * brightness;
+        render_set_palette_color(render_ctx,
+                                 CHART_FIRST_COLOR + i,
+                                 (r << 16) | (g << 8) | b);
     }
 }
 
-void chart_push(ChartCtx* ctx, const float* values, int num_values) {
+int chart_push(ChartCtx* ctx,
+               int64_t timestamp_us,
+               const float* values,
+               int num_values) {
     /* This function must receive a value per chart channel */
     assert(num_values == ctx->num_channels);
 
     /*
-     * Write each value from the received array into the circular buffer of the
-     * corresponding channel.
+     * Get the position of the column where the values are collapsed, starting
+     * a new one at the write position if the newest one is complete. If whole
+     * periods were skipped, their columns are left empty.
      */
-    for (int cur_channel = 0; cur_channel < ctx->num_channels; cur_channel++)
-        ctx->data[ctx->history_size * cur_channel + ctx->write_pos] =
-          values[cur_channel];
+    const int num_new_columns = get_num_new_columns(ctx, timestamp_us);
+    const bool new_column     = (num_new_columns > 0);
+    for (int i = 1; i < num_new_columns; i++)
+        start_empty_column(ctx);
 
-    /* Advance write position */
-    ctx->write_pos++;
-    if (ctx->write_pos >= ctx->history_size)
-        ctx->write_pos = 0;
+    int pos;
+    if (new_column) {
+        pos = start_column(ctx);
+    } else {
+        /* The newest column is before the write position */
+        pos = ctx->write_pos - 1;
+        if (pos < 0)
+            pos = ctx->history_size - 1;
+    }
+    ctx->num_column_samples++;
+    if (ctx->empty_columns != NULL)
+        ctx->empty_columns[pos] = false;
+
+    /*
+     * Write each value from the received array into the circular buffers of
+     * the corresponding channel.
+     */
+    for (int cur_channel = 0; cur_channel < ctx->num_channels; cur_channel++) {
+        const ChartAxis* axis = &ctx->axes[ctx->channel_axes[cur_channel]];
+        const int idx         = ctx->history_size * cur_channel + pos;
+
+        write_value(ctx, cur_channel, idx, values[cur_channel], new_column);
+        convert_channel_ys(ctx, cur_channel, axis, idx, idx);
+        update_deques(ctx, cur_channel, pos, new_column);
+    }
+    update_tiers(ctx, values);
+
+    if (ctx->log_columns != NULL) {
+        sample_log_append(&ctx->log, timestamp_us, values);
+        ctx->log_view_samples = 0;
+    }
+
+    ctx->num_unscaled_samples++;
+    return num_new_columns;
 }
 
-void chart_update_minmax(ChartCtx* ctx) {
+bool chart_update_minmax(ChartCtx* ctx) {
     assert(ctx->num_channels > 0);
 
-    float min = ctx->data[0];
-    float max = ctx->data[0];
+    bool changed = false;
+    for (int axis = 0; axis < ctx->num_channels; axis++) {
+        /*
+         * The extremes of each channel are at the front of its deques. Unused
+         * axes are left empty, so their range is not updated.
+         */
+        float min = INFINITY;
+        float max = -INFINITY;
+        for (int cur_channel = 0; cur_channel < ctx->num_channels;
+             cur_channel++) {
+            if (ctx->channel_axes[cur_channel] != axis)
+                continue;
 
-    for (int cur_channel = 0; cur_channel < ctx->num_channels; cur_channel++) {
-        for (int i = 0; i < ctx->history_size; i++) {
-            const float val = ctx->data[ctx->history_size * cur_channel + i];
-            if (val < min)
-                min = val;
-            if (val > max)
-                max = val;
-        }
-    }
-
-    /* Add 10% margin to avoid clipping at edges */
-    const float range  = max - min;
-    const float margin = range * 0.1f;
-
-    ctx->min_value = min - margin;
-    ctx->max_value = max + margin;
-}
-
-void chart_render(const ChartCtx* chart_ctx, const RenderCtx* render_ctx) {
-    /* Color palette for different channels */
-    static const uint32_t channel_colors[] = {
-        0xFF0000, /* Red */
-        0x00FF00, /* Green */
-        0x0000FF, /* Blue */
-        0xFFFF00, /* Yellow */
-        0xFF00FF, /* Magenta */
-        0x00FFFF, /* Cyan */
-        0xFFFFFF, /* White */
-        0xFF8800, /* Orange */
+            /* Channels without samples in the window are skipped */
+            const ChartDeque* min_deque = &ctx->min_deques[cur_channel];
+            const ChartDeque* max_deque = &ctx->max_deques[cur_channel];
+            if (min_deque->size == 0)
+                continue;
+
+            const float channel_min =
+              get_min_value(ctx, cur_channel, deque_front(min_deque));
+            const float channel_max =
+              get_max_value(ctx, cur_channel, deque_front(max_deque));
+            if (channel_min < min)
+                min = channel_min;
+            if (channel_max > max)
+                max = channel_max;
+        }
+
+        if (autoscale_update(&ctx->axes[axis].scale,
+                             min,
+                             max,
+                             ctx->num_unscaled_samples)) {
+            update_axis_ys(ctx, axis);
+            changed = true;
+        }
+    }
+
+    ctx->num_unscaled_samples = 0;
+    return changed;
+}
+
+void chart_render(const ChartCtx* chart_ctx, RenderCtx* render_ctx) {
+    assert(chart_ctx->num_channels > 0);
+
+    /*
+     * The oldest column is at the write position, so the circular buffers of
+     * each channel are drawn as two envelopes: from the write position to the
+     * end of the buffer, and from the start of the buffer to the write
+     * position. The last column of the first envelope is connected to the
+     * first column of the second one separately.
+     */
+    const int history_size = chart_ctx->history_size;
+    const int write_pos    = chart_ctx->write_pos;
+    const int wrap_x       = history_size - write_pos;
+
+    /* Empty columns are skipped, if there can be any */
+    const bool* empty       = chart_ctx->empty_columns;
+    const bool wrap_empty[] = {
+        empty != NULL && empty[history_size - 1],
+        empty != NULL && empty[0],
     };
 
+    for (int cur_channel = 0; cur_channel < chart_ctx->num_channels;
+         cur_channel++) {
+        const int offset        = history_size * cur_channel;
+        const int16_t* tops     = &chart_ctx->tops[offset];
+        const int16_t* bottoms  = &chart_ctx->bottoms[offset];
+        const uint8_t cur_color = get_channel_color(cur_channel);
+
+        draw_envelope_runs(render_ctx,
+                           0,
+                           &tops[write_pos],
+                           &bottoms[write_pos],
+                           (empty != NULL) ? &empty[write_pos] : NULL,
+                           wrap_x,
+                           cur_color);
+        if (write_pos == 0)
+            continue;
+
+        const int16_t wrap_tops[] = {
+            tops[history_size - 1],
+            tops[0],
+        };
+        const int16_t wrap_bottoms[] = {
+            bottoms[history_size - 1],
+            bottoms[0],
+        };
+        draw_envelope_runs(render_ctx,
+                           wrap_x - 1,
+                           wrap_tops,
+                           wrap_bottoms,
+                           (empty != NULL) ? wrap_empty : NULL,
+                           LENGTH(wrap_tops),
+                           cur_color);
+        draw_envelope_runs(render_ctx,
+                           wrap_x,
+                           tops,
+                           bottoms,
+                           empty,
+                           write_pos,
+                           cur_color);
+    }
+}
+
+void chart_render_history(ChartCtx* chart_ctx,
+                          RenderCtx* render_ctx,
+                          int num_samples) {
     assert(chart_ctx->num_channels > 0);
 
-    /* Prevent division by zero if all values are identical */
-    float min_value = chart_ctx->min_value;
-    float max_value = chart_ctx->max_value;
-    if (min_value == max_value) {
-        min_value -= 1.0f;
-        max_value += 1.0f;
+    const int max_samples =
+      chart_ctx->history_size * chart_ctx->samples_per_column;
+    if (num_samples <= max_samples) {
+        chart_render(chart_ctx, render_ctx);
+        return;
+    }
+
+    if (chart_ctx->log_columns != NULL &&
+        num_samples <= chart_ctx->log.num_samples) {
+        render_log_history(chart_ctx, render_ctx, num_samples);
+        return;
+    }
+
+    if (chart_ctx->num_tiers == 0) {
+        chart_render(chart_ctx, render_ctx);
+        return;
+    }
+
+    /*
+     * Find the highest-resolution tier that covers the samples, with at most a
+     * bucket per column. Its number of valid buckets doesn't matter, since it
+     * only grows with time.
+     */
+    const int width       = render_get_width(render_ctx);
+    const ChartTier* tier = &chart_ctx->tiers[chart_ctx->num_tiers - 1];
+    for (int i = 0; i < chart_ctx->num_tiers; i++) {
+        const ChartTier* cur_tier = &chart_ctx->tiers[i];
+        const int64_t max_samples =
+          (int64_t)MIN(cur_tier->size, width) * cur_tier->samples_per_bucket;
+        if (max_samples >= num_samples) {
+            tier = cur_tier;
+            break;
+        }
     }
 
-    /* Calculate scale factor based on min/max values */
-    const int display_height = render_get_height(render_ctx);
-    const float value_range  = max_value - min_value;
-    const float scale        = (float)display_height / value_range;
+    const int samples_per_bucket = tier->samples_per_bucket;
+    const int num_buckets =
+      MIN(MIN(tier->num_buckets, width),
+          (num_samples + samples_per_bucket - 1) / samples_per_bucket);
+    const int first_pos =
+      (tier->write_pos - num_buckets + tier->size) % tier->size;
+
+    for (int axis_index = 0; axis_index < chart_ctx->num_channels;
+         axis_index++) {
+        /*
+         * Scale the axis to fit the rendered buckets of its channels. Unused
+         * axes are left empty, so they are skipped.
+         */
+        float min = INFINITY;
+        float max = -INFINITY;
+        for (int cur_channel = 0; cur_channel < chart_ctx->num_channels;
+             cur_channel++) {
+            if (chart_ctx->channel_axes[cur_channel] != axis_index)
+                continue;
+
+            const ChartBucket* buckets =
+              &tier->buckets[tier->size * cur_channel];
+            for (int i = 0; i < num_buckets; i++) {
+                const ChartBucket* bucket =
+                  &buckets[(first_pos + i) % tier->size];
+                min = fminf(min, bucket->min);
+                max = fmaxf(max, bucket->max);
+            }
+        }
+
+        ChartAxis axis;
+        if (!fit_view_axis(chart_ctx, &axis, min, max))
+            continue;
+
+        for (int cur_channel = 0; cur_channel < chart_ctx->num_channels;
+             cur_channel++) {
+            if (chart_ctx->channel_axes[cur_channel] != axis_index)
+                continue;
+
+            render_tier_channel(chart_ctx,
+                                render_ctx,
+                                tier,
+                                &axis,
+                                cur_channel,
+                                first_pos,
+                                width - num_buckets,
+                                num_buckets);
+        }
+    }
+}
+
+void chart_render_column(const ChartCtx* chart_ctx,
+                         RenderCtx* render_ctx,
+                         int x,
+                         int age) {
+    assert(chart_ctx->num_channels > 0);
+
+    /* The oldest value has no previous value to connect to */
+    if (age < 0 || age >= chart_ctx->history_size - 1)
+        return;
+
+    /*
+     * Get indices in circular buffer; the newest column is before 'write_pos'.
+     */
+    const int history_size = chart_ctx->history_size;
+    const int idx_cur = (chart_ctx->write_pos - 1 - age + 2 * history_size) %
+                        history_size;
+    int idx_prev = (idx_cur - 1 + history_size) % history_size;
+
+    /*
+     * Empty columns are not drawn, and a column after an empty one is only
+     * connected to itself.
+     */
+    const bool* empty = chart_ctx->empty_columns;
+    if (empty != NULL && empty[idx_cur])
+        return;
+    if (empty != NULL && empty[idx_prev])
+        idx_prev = idx_cur;
 
-    /* Draw each channel */
     for (int cur_channel = 0; cur_channel < chart_ctx->num_channels;
          cur_channel++) {
-        for (int x = 1; x < chart_ctx->history_size; x++) {
-            /* Get indices in circular buffer */
-            const int idx_prev =
-              (chart_ctx->write_pos + x - 1) % chart_ctx->history_size;
-            const int idx_cur =
-              (chart_ctx->write_pos + x) % chart_ctx->history_size;
-
-            /* Get values and scale to screen coordinates */
-            const float val_prev =
-              chart_ctx->data[chart_ctx->history_size * cur_channel + idx_prev];
-            const float val_cur =
-              chart_ctx->data[chart_ctx->history_size * cur_channel + idx_cur];
-
-            /* Convert to screen Y coordinates (inverted, 0 at top) */
-            const int y_prev =
-              display_height - (int)((val_prev - min_value) * scale);
-            const int y_cur =
-              display_height - (int)((val_cur - min_value) * scale);
-
-            /* Draw line segment */
-            const uint32_t cur_color =
-              channel_colors[cur_channel % LENGTH(channel_colors)];
-            render_draw_line(render_ctx, x - 1, y_prev, x, y_cur, cur_color);
-        }
+        const int offset     = history_size * cur_channel;
+        const int16_t tops[] = {
+            chart_ctx->tops[offset + idx_prev],
+            chart_ctx->tops[offset + idx_cur],
+        };
+        const int16_t bottoms[] = {
+            chart_ctx->bottoms[offset + idx_prev],
+            chart_ctx->bottoms[offset + idx_cur],
+        };
+
+        /* Draw the envelope of the current column, at column 'x' */
+        const uint8_t cur_color = get_channel_color(cur_channel);
+        render_draw_envelope(render_ctx,
+                             x - 1,
+                             tops,
+                             bottoms,
+                             LENGTH(tops),
+                             cur_color);
     }
 }
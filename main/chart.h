@@ -19,7 +19,118 @@
 #ifndef CHART_H_
 #define CHART_H_ 1
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 #include "render.h"
+#include "autoscale.h"
+#include "sample_log.h"
+
+/*
+ * First palette index used for the colors of the chart channels. See
+ * 'chart_set_colors'.
+ */
+#define CHART_FIRST_COLOR 1
+
+/*
+ * Number of buckets (or samples) of each history tier that are combined into a
+ * single bucket of the next one. See 'ChartTier'.
+ */
+#define CHART_TIER_FACTOR 2
+
+/*
+ * Double-ended queue of positions in the circular buffer of a channel, whose
+ * values are monotonic (increasing or decreasing) from front to back. Used for
+ * tracking the minimum or maximum of a channel incrementally: the front always
+ * holds the position of the extreme value in the current window.
+ */
+typedef struct ChartDeque {
+    /* Circular array of 'history_size' positions */
+    int* positions;
+
+    /* Index of the front element in 'positions', and number of elements */
+    int head;
+    int size;
+} ChartDeque;
+
+/*
+ * Vertical axis of a chart, shared by one or more of its channels.
+ */
+typedef struct ChartAxis {
+    /* Range of values displayed in the axis */
+    AutoScale scale;
+
+    /* Offset and scale factor used for converting its values to coordinates */
+    float y_min_value;
+    float y_scale;
+} ChartAxis;
+
+/*
+ * Linear format of the values of a channel, when they are stored quantized.
+ * Each value is stored as an unsigned 16-bit code, which represents the value
+ * 'code * scale + offset'. The scale must be positive. Values outside of the
+ * range of the codes are clamped, and NaN values are stored as zero codes.
+ *
+ * This is the same format used for decoding OBD-II PIDs (see
+ * 'elm327_get_pid_format'), so their values are stored exactly.
+ */
+typedef struct ChartFormat {
+    float scale;
+    float offset;
+} ChartFormat;
+
+/*
+ * Format of the quantized values of a channel, along with the fixed-point
+ * factor and term used for converting its codes to screen coordinates, which
+ * are calculated from the projection of its axis.
+ */
+typedef struct ChartQuantizer {
+    ChartFormat format;
+    int64_t y_mul;
+    int64_t y_add;
+} ChartQuantizer;
+
+/*
+ * Summary of consecutive values of a channel.
+ */
+typedef struct ChartBucket {
+    float min;
+    float max;
+    float mean;
+} ChartBucket;
+
+/*
+ * Downsampled history of a chart, used for displaying much longer periods than
+ * the full-resolution circular buffers. Each bucket of the first tier
+ * summarizes 'CHART_TIER_FACTOR' samples, and each bucket of the following
+ * tiers summarizes 'CHART_TIER_FACTOR' buckets of the previous one.
+ */
+typedef struct ChartTier {
+    /*
+     * Array of 'num_channels' circular buffers, each with 'size' buckets, and
+     * the position where the next bucket will be written. Only the last
+     * 'num_buckets' buckets are valid.
+     */
+    ChartBucket* buckets;
+    int size;
+    int write_pos;
+    int num_buckets;
+
+    /* Number of samples summarized by each bucket */
+    int samples_per_bucket;
+
+    /*
+     * Bucket of each channel that is being accumulated, and number of buckets
+     * (or samples) accumulated into them. While accumulating, the 'mean'
+     * member contains the sum of the values.
+     */
+    ChartBucket* pending;
+    int num_pending;
+
+    /* Memory used by the tier, in bytes */
+    size_t num_bytes;
+} ChartTier;
 
 /*
  * Structure representing the context for a multi-channel scrolling chart.
@@ -28,18 +139,120 @@ typedef struct ChartCtx {
     /*
      * Pointer to an array of 'num_channels' arrays, each with 'history_size'
      * values. Each of these arrays will be used as a circular buffer with the
-     * actual data to be plotted.
+     * actual data to be plotted, with a value per display column.
      */
     float* data;
     int num_channels;
     int history_size;
 
-    /* Position in the circular buffer where the next value will be written */
+    /*
+     * Number of samples that are collapsed into each column. Each column
+     * stores the minimum, maximum and last value of its samples, and it's
+     * drawn as an envelope between its extremes, so fast spikes remain
+     * visible. The last values are stored in 'data'.
+     *
+     * Arrays with the same layout as 'data', containing the minimum and
+     * maximum values of each column. With a single sample per column, both
+     * point to 'data'.
+     */
+    int samples_per_column;
+    float* mins;
+    float* maxs;
+
+    /*
+     * Array of 'num_channels' quantizers, or NULL if the values are stored as
+     * floats. When quantized, the values, minimums and maximums are stored as
+     * codes (see 'ChartFormat') in 'codes', 'min_codes' and 'max_codes',
+     * instead of 'data', 'mins' and 'maxs', which are NULL. This halves the
+     * memory used by the history, and the extremes and screen coordinates are
+     * calculated with integer arithmetic.
+     */
+    ChartQuantizer* quantizers;
+    uint16_t* codes;
+    uint16_t* min_codes;
+    uint16_t* max_codes;
+
+    /*
+     * Position in the circular buffers where the next column will be written,
+     * and number of samples collapsed into the newest column (the one before
+     * 'write_pos') so far.
+     */
     int write_pos;
+    int num_column_samples;
+
+    /*
+     * Duration of each column in microseconds, or zero if the columns are
+     * started by number of samples. See 'chart_set_column_period'.
+     *
+     * With a period, the column of each sample depends on its timestamp, and
+     * 'newest_period' is the index of the period of the newest column, that
+     * is, the timestamps of its samples divided by 'column_period_us'. Columns
+     * whose period had no samples are marked in 'empty_columns', an array of
+     * 'history_size' flags, and they are not drawn. Otherwise, it's NULL.
+     */
+    int64_t column_period_us;
+    int64_t newest_period;
+    bool* empty_columns;
 
-    /* Minimum and maximum values in the entire graph, for auto-scaling */
-    float min_value;
-    float max_value;
+    /*
+     * Array of 'num_channels' axes, and index of the axis used by each
+     * channel. Channels that share an axis are scaled together, and each axis
+     * is scaled independently. Not all axes are necessarily used.
+     */
+    ChartAxis* axes;
+    int* channel_axes;
+
+    /* Number of samples pushed since the axes were last updated */
+    int num_unscaled_samples;
+
+    /*
+     * Arrays with the same layout as 'data', containing the screen Y
+     * coordinates of the maximum and minimum values of each column (i.e. the
+     * top and bottom of its envelope), for a display of 'display_height'
+     * pixels. New values are converted by 'chart_push', and the values of an
+     * axis are converted again only when its scale changes, so rendering
+     * doesn't need to convert any values. With a single sample per column, both
+     * point to the same array.
+     */
+    int16_t* tops;
+    int16_t* bottoms;
+    int display_height;
+
+    /*
+     * Arrays of 'num_channels' deques, tracking the positions of the minimum
+     * and maximum values (in 'mins' and 'maxs') of each channel. They are
+     * updated on each 'chart_push', so the extremes never need to be searched.
+     */
+    ChartDeque* min_deques;
+    ChartDeque* max_deques;
+
+    /*
+     * Array of 'num_tiers' downsampled histories, from highest to lowest
+     * resolution. They are updated on each 'chart_push'. See
+     * 'chart_init_tiers'.
+     */
+    ChartTier* tiers;
+    int num_tiers;
+
+    /*
+     * Compressed log of all pushed samples, which is updated on each
+     * 'chart_push' if 'log_columns' is not NULL. See 'chart_init_log'.
+     *
+     * The 'log_columns' array is used while rendering from the log, for
+     * collapsing the decoded samples into columns. It contains two arrays with
+     * the same layout as 'data', with the minimum and maximum of each column,
+     * and 'log_empty_columns' marks the columns without samples.
+     *
+     * The columns are kept between calls, so the log is only decoded once per
+     * frame when the chart is rendered in stripes. They hold the view of the
+     * last 'log_view_samples' samples in 'log_view_columns' columns, which is
+     * reset to zero samples on each 'chart_push'.
+     */
+    SampleLog log;
+    float* log_columns;
+    bool* log_empty_columns;
+    int64_t log_view_samples;
+    int log_view_columns;
 } ChartCtx;
 
 /*----------------------------------------------------------------------------*/
@@ -47,8 +260,27 @@ typedef struct ChartCtx {
 /*
  * Initialize the specified chart context, allocating the necessary data for a
  * chart of the specified number of channels, with the specified history size.
+ * The chart will be rendered on a display of the specified height. Each channel
+ * initially has its own axis, whose range only shrinks after the data has fit
+ * in a smaller one for 'shrink_dwell' samples (see 'AutoScale'). Each column of
+ * the chart collapses 'samples_per_column' samples, which can be used when the
+ * samples arrive faster than the columns should scroll.
+ *
+ * If 'formats' is not NULL, it should point to an array with the format of
+ * each channel, and the history is stored quantized (see 'ChartFormat').
+ * Otherwise, it's stored as floats.
+ *
+ * If the columns are started by time instead (see 'chart_set_column_period'),
+ * 'samples_per_column' should be the expected number of samples per column. It
+ * is only used by 'chart_render_history'.
  */
-void chart_init(ChartCtx* ctx, int num_channels, int history_size);
+void chart_init(ChartCtx* ctx,
+                int num_channels,
+                int history_size,
+                int display_height,
+                int shrink_dwell,
+                int samples_per_column,
+                const ChartFormat* formats);
 
 /*
  * Deinitialize a chart context, freeing its necessary members. This function
@@ -57,27 +289,134 @@ void chart_init(ChartCtx* ctx, int num_channels, int history_size);
 void chart_destroy(ChartCtx* ctx);
 
 /*
- * Push a set of values to all channels of the specified chart context. The
- * 'values' argument should point to a float array of 'num_values'
- * elements. This array must contain exactly the number of channels that were
- * specified when calling 'chart_init'.
+ * Allocate the downsampled histories of the specified chart, with the
+ * specified memory budget for each one, in bytes. Each tier has half the
+ * resolution of the previous one (see 'ChartTier'), so it covers twice as many
+ * samples with the same budget. This function should be called after
+ * 'chart_init', and before pushing any value.
+ */
+void chart_init_tiers(ChartCtx* ctx, const size_t* budgets, int num_tiers);
+
+/*
+ * Allocate the compressed log of the specified chart, with the specified
+ * memory budget in bytes (see 'SampleLog'). Unlike the downsampled histories,
+ * it stores the exact samples, but slowly changing signals only take a few
+ * bits per sample, so it usually covers several times more samples than the
+ * circular buffers would with the same memory. This function should be called
+ * after 'chart_init', and before pushing any value.
+ *
+ * The budget includes the columns that the log is collapsed into for rendering
+ * (see 'log_columns'), which take 'history_size' times
+ * '2 * num_channels * sizeof(float) + 1' bytes, so it must be larger than that.
+ */
+void chart_init_log(ChartCtx* ctx, size_t num_bytes);
+
+/*
+ * Start the columns of the specified chart by time, instead of by number of
+ * samples, so each column contains the samples whose timestamps are in a
+ * period of 'period_us' microseconds. The X axis of the chart is then a time
+ * axis, even if the samples don't arrive at a constant rate: when there were
+ * no samples in a period, its column is left empty, and it's not drawn. Samples
+ * older than the newest column are collapsed into it.
+ *
+ * Initially, all columns are empty. This function should be called after
+ * 'chart_init', and before pushing any value.
+ */
+void chart_set_column_period(ChartCtx* ctx, int64_t period_us);
+
+/*
+ * Set the axis used by each channel of the specified chart. The 'channel_axes'
+ * argument should point to an array with an axis index for each channel, lower
+ * than the number of channels. Channels with the same index share an axis, so
+ * they are scaled together (e.g. when plotting values with the same unit).
+ *
+ * All axes are scaled again, so the chart needs to be redrawn afterwards.
+ */
+void chart_set_axes(ChartCtx* ctx, const int* channel_axes);
+
+/*
+ * Set the palette colors of the specified render context that are used for
+ * drawing the chart channels, scaled by the specified brightness, from 0 to 1.
+ * Changing the brightness (e.g. for dimming the display at night) doesn't
+ * require redrawing the chart when using a framebuffer.
  */
-void chart_push(ChartCtx* ctx, const float* values, int num_values);
+void chart_set_colors(RenderCtx* render_ctx, float brightness);
 
 /*
- * Update the minimum and maximum stored values of the specified chart context,
- * based on the current data.
+ * Push a set of values to all channels of the specified chart context, received
+ * at the specified timestamp, in microseconds. The timestamps should not
+ * decrease. The 'values' argument should point to a float array of
+ * 'num_values' elements. This array must contain exactly the number of channels
+ * that were specified when calling 'chart_init'.
+ *
+ * The values are collapsed into the newest column of the chart, unless it
+ * already contains 'samples_per_column' samples, or unless the timestamp is
+ * after its period (see 'chart_set_column_period'). Returns the number of
+ * columns that were started, including empty ones, up to the history size. If
+ * it's zero, the newest column was updated.
+ */
+int chart_push(ChartCtx* ctx,
+               int64_t timestamp_us,
+               const float* values,
+               int num_values);
+
+/*
+ * Update the range of each axis of the specified chart context, based on the
+ * current data. Since the extremes of each channel are tracked by 'chart_push',
+ * this only needs to look at one value per channel. Returns true if the scale
+ * of any axis changed, in which case the screen coordinates of the values of
+ * its channels are updated, and the chart needs to be redrawn. The coordinates
+ * of other channels, converted by 'chart_push', are still valid.
  *
  * TODO: Does this need to be exposed? Couldn't it be a static function called
- * by 'chart_render'? Are the 'min_value' and 'max_value' members of 'ChartCtx'
- * even needed?
+ * by 'chart_render'?
  */
-void chart_update_minmax(ChartCtx* ctx);
+bool chart_update_minmax(ChartCtx* ctx);
 
 /*
  * Render all data in the specified chart context into the display referenced by
  * the specified render context.
  */
-void chart_render(const ChartCtx* chart_ctx, const RenderCtx* render_ctx);
+void chart_render(const ChartCtx* chart_ctx, RenderCtx* render_ctx);
+
+/*
+ * Render the last 'num_samples' samples of the chart into the display
+ * referenced by the specified render context.
+ *
+ * If they fit in the columns of the chart, this is equivalent to
+ * 'chart_render'. If they are in the compressed log, they are decoded and
+ * collapsed into at most a column per display column, which are rendered as
+ * filled envelopes between their extremes, and each axis is scaled to fit the
+ * rendered columns. The rendering time is proportional to the number of
+ * samples. If the columns of the chart are started by time, the samples are
+ * placed by their timestamps, and columns without samples are left empty.
+ *
+ * Otherwise, they are rendered in the same way from the highest-resolution tier
+ * that covers them with at most a bucket per column. Therefore, the rendering
+ * time doesn't depend on the number of samples. If no tier covers them, the
+ * whole history of the lowest-resolution tier is rendered.
+ *
+ * Like in 'chart_render', the newest column is drawn at the right edge of the
+ * display, even if there are fewer columns than the display width.
+ */
+void chart_render_history(ChartCtx* chart_ctx,
+                          RenderCtx* render_ctx,
+                          int num_samples);
+
+/*
+ * Render a single column of the chart, at the horizontal position 'x' of the
+ * display referenced by the specified render context. The column contains the
+ * envelope of each channel at the specified age (where zero is the newest
+ * column), connected to the envelope of the previous column. Empty columns
+ * are not drawn, nor connected to (see 'chart_set_column_period').
+ *
+ * This is used for updating the display incrementally, instead of redrawing
+ * the whole chart with 'chart_render' after each sample. The caller is
+ * responsible for clearing the column beforehand.
+ */
+void chart_render_column(const ChartCtx* chart_ctx,
+                         RenderCtx* render_ctx,
+                         int x,
+                         int age);
 
 #endif /* CHART_H_ */
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "decimal.h"
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "util.h"
+
+/*
+ * Largest mantissa that can be represented exactly in a single-precision float
+ * (2^24). Together with the exact powers of ten below, it limits the inputs
+ * that can be converted with a single rounding.
+ */
+#define MAX_EXACT_MANTISSA 16777216u
+
+/*
+ * Largest exponent that will be accumulated while parsing. Anything beyond
+ * this will fall back to 'strtof' anyway, so it's only used to avoid integer
+ * overflows.
+ */
+#define MAX_PARSED_EXPONENT 10000
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Powers of ten that can be represented exactly in a single-precision float.
+ */
+static const float exact_powers_of_ten[] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f,
+};
+
+static inline bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+/*
+ * Fallback for inputs that can't be converted by the fast path, using
+ * 'strtof'.
+ */
+static bool parse_slow(const char* str, const char** endptr, float* dst) {
+    errno = 0;
+    char* end;
+    const float result = strtof(str, &end);
+    if (end == str || errno == ERANGE)
+        return false;
+
+    *endptr = end;
+    *dst    = result;
+    return true;
+}
+
+/*----------------------------------------------------------------------------*/
+
+bool decimal_parse(const char* str, const char** endptr, float* dst) {
+    const char* cur = str;
+
+    bool negative = false;
+    if (*cur == '+' || *cur == '-') {
+        negative = (*cur == '-');
+        cur++;
+    }
+
+    /*
+     * Accumulate all significant digits, both from the integer and fractional
+     * parts, into a single integer mantissa. Each fractional digit decreases
+     * the decimal exponent by one.
+     */
+    uint32_t mantissa  = 0;
+    int exponent       = 0;
+    int num_digits     = 0;
+    bool mantissa_fits = true;
+
+    for (; is_digit(*cur); cur++, num_digits++) {
+        if (mantissa >= MAX_EXACT_MANTISSA / 10)
+            mantissa_fits = false;
+        else
+            mantissa = mantissa * 10 + (*cur - '0');
+    }
+
+    if (*cur == '.') {
+        cur++;
+        for (; is_digit(*cur); cur++, num_digits++) {
+            if (mantissa >= MAX_EXACT_MANTISSA / 10)
+                mantissa_fits = false;
+            else
+                mantissa = mantissa * 10 + (*cur - '0');
+            exponent--;
+        }
+    }
+
+    /*
+     * Inputs without digits (e.g. "inf" or "nan") are not handled by the fast
+     * path, but they might still be valid for 'strtof'.
+     */
+    if (num_digits == 0 || !mantissa_fits)
+        return parse_slow(str, endptr, dst);
+
+    /* The exponent is only consumed if it contains at least one digit */
+    if ((*cur == 'e' || *cur == 'E') &&
+        (is_digit(cur[1]) ||
+         ((cur[1] == '+' || cur[1] == '-') && is_digit(cur[2])))) {
+        cur++;
+
+        bool exponent_negative = false;
+        if (*cur == '+' || *cur == '-') {
+            exponent_negative = (*cur == '-');
+            cur++;
+        }
+
+        int explicit_exponent = 0;
+        for (; is_digit(*cur); cur++)
+            if (explicit_exponent < MAX_PARSED_EXPONENT)
+                explicit_exponent = explicit_exponent * 10 + (*cur - '0');
+
+        exponent += exponent_negative ? -explicit_exponent : explicit_exponent;
+    }
+
+    /*
+     * If the exponent is out of the exactly-representable range, the result
+     * would need more than one rounding, so let 'strtof' handle it.
+     */
+    const int max_exponent = LENGTH(exact_powers_of_ten) - 1;
+    if (exponent < -max_exponent || exponent > max_exponent)
+        return parse_slow(str, endptr, dst);
+
+    /*
+     * Both operands are exact, and IEEE 754 guarantees that the multiplication
+     * and division are correctly rounded, so the result matches 'strtof'.
+     */
+    float result = (float)mantissa;
+    if (exponent < 0)
+        result /= exact_powers_of_ten[-exponent];
+    else
+        result *= exact_powers_of_ten[exponent];
+
+    *endptr = cur;
+    *dst    = negative ? -result : result;
+    return true;
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DECIMAL_H_
+#define DECIMAL_H_ 1
+
+#include <stdbool.h>
+
+/*
+ * Parse a decimal number from the start of the specified string, and write it
+ * to 'dst'. This function returns true on success, or false if the string
+ * doesn't start with a number, or if the number is out of range. On success,
+ * 'endptr' is set to the first character after the number.
+ *
+ * Only plain decimal input is supported: an optional sign, digits, an optional
+ * fraction and an optional exponent, which is the format sent through the
+ * serial port. It's converted without calling 'strtof' if the result can be
+ * computed with a single correctly rounded floating-point operation, and with
+ * 'strtof' otherwise, so for such input, the result is identical to the one
+ * returned by it. Other formats accepted by 'strtof' are not: for example, only
+ * the leading zero of a hexadecimal number like "0x1A" is parsed.
+ */
+bool decimal_parse(const char* str, const char** endptr, float* dst);
+
+#endif /* DECIMAL_H_ */
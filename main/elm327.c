@@ -0,0 +1,481 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "elm327.h"
+#include <stdio.h>
+#include <stdlib.h> /* strtoul */
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/uart.h"
+
+#include "util.h"
+
+/*
+ * Serial communication with the ELM327 adapter.
+ *
+ * UART zero is used by the USB port, so the adapter is connected to the free
+ * GPIOs of the CN1 connector of the ESP32-CYD board. The baud rate is the
+ * default of most ELM327 adapters.
+ */
+#define ELM327_UART_NUM       UART_NUM_2
+#define ELM327_UART_BAUD_RATE 38400
+#define ELM327_UART_TX_PIN    27
+#define ELM327_UART_RX_PIN    22
+#define ELM327_UART_BUF_SIZE  1024
+
+/*
+ * Maximum time to wait for a response, in milliseconds. The reset command is
+ * much slower than the rest, and the first OBD request might take several
+ * seconds while the adapter searches for the vehicle's protocol.
+ */
+#define ELM327_TIMEOUT_MS       1000
+#define ELM327_RESET_TIMEOUT_MS 3000
+#define ELM327_FIRST_TIMEOUT_MS 10000
+
+/*
+ * Character sent by the adapter when it's ready for the next command.
+ */
+#define ELM327_PROMPT '>'
+
+/*
+ * Mode for requesting current data, and offset added to the mode byte in the
+ * positive responses.
+ */
+#define OBD_MODE_CURRENT_DATA 0x01
+#define OBD_RESPONSE_OFFSET   0x40
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Structure describing how to decode a mode 01 PID. The data bytes of all the
+ * supported PIDs form a single big-endian unsigned integer, which is linearly
+ * converted to its real value as 'raw * scale + offset'.
+ */
+typedef struct PidInfo {
+    uint8_t pid;
+    uint8_t num_bytes;
+    float scale;
+    float offset;
+} PidInfo;
+
+static const PidInfo pid_table[] = {
+    /* PID                      Bytes  Scale         Offset   Units */
+    { ELM327_PID_ENGINE_LOAD,     1, 100.f / 255.f,  0.f   }, /* % */
+    { ELM327_PID_COOLANT_TEMP,    1, 1.f,            -40.f }, /* C */
+    { ELM327_PID_INTAKE_PRESSURE, 1, 1.f,            0.f   }, /* kPa */
+    { ELM327_PID_ENGINE_RPM,      2, 0.25f,          0.f   }, /* rpm */
+    { ELM327_PID_VEHICLE_SPEED,   1, 1.f,            0.f   }, /* km/h */
+    { ELM327_PID_TIMING_ADVANCE,  1, 0.5f,           -64.f }, /* deg */
+    { ELM327_PID_INTAKE_TEMP,     1, 1.f,            -40.f }, /* C */
+    { ELM327_PID_MAF_RATE,        2, 0.01f,          0.f   }, /* g/s */
+    { ELM327_PID_THROTTLE,        1, 100.f / 255.f,  0.f   }, /* % */
+    { ELM327_PID_FUEL_LEVEL,      1, 100.f / 255.f,  0.f   }, /* % */
+    { ELM327_PID_MODULE_VOLTAGE,  2, 0.001f,         0.f   }, /* V */
+    { ELM327_PID_AMBIENT_TEMP,    1, 1.f,            -40.f }, /* C */
+    { ELM327_PID_OIL_TEMP,        1, 1.f,            -40.f }, /* C */
+};
+
+/*
+ * Whether no OBD request has been sent yet, so the adapter still has to
+ * detect the vehicle's protocol.
+ */
+static bool g_first_request = true;
+
+/*
+ * Whether the number of expected CAN frames is appended to the requests. It's
+ * disabled once a response misses some PID, in case the vehicle has several
+ * ECUs that split the PIDs between them, since the adapter would return after
+ * the frames of the first one.
+ */
+static bool g_use_response_count = true;
+
+/*----------------------------------------------------------------------------*/
+
+static const PidInfo* find_pid_info(uint8_t pid) {
+    for (size_t i = 0; i < LENGTH(pid_table); i++)
+        if (pid_table[i].pid == pid)
+            return &pid_table[i];
+    return NULL;
+}
+
+static inline int hex_digit_value(char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+/*
+ * Send the specified command to the adapter, and read its response until the
+ * prompt character. The response is stored in 'dst' as a null-terminated
+ * string, without the prompt. Returns true on success, or false if the
+ * response was not received before the timeout, or if it didn't fit in 'dst'.
+ */
+static bool send_command(const char* command,
+                         char* dst,
+                         size_t dst_size,
+                         int timeout_ms) {
+    /* Discard anything that was received after the last prompt */
+    uart_flush_input(ELM327_UART_NUM);
+
+    uart_write_bytes(ELM327_UART_NUM, command, strlen(command));
+    uart_write_bytes(ELM327_UART_NUM, "\r", 1);
+
+    const TickType_t start_ticks   = xTaskGetTickCount();
+    const TickType_t timeout_ticks = pdMS_TO_TICKS(timeout_ms);
+    size_t dst_pos                 = 0;
+
+    for (;;) {
+        const TickType_t elapsed_ticks = xTaskGetTickCount() - start_ticks;
+        if (elapsed_ticks >= timeout_ticks)
+            return false;
+
+        /*
+         * Read everything that is buffered, or block until at least one byte
+         * arrives.
+         */
+        size_t available = 0;
+        uart_get_buffered_data_len(ELM327_UART_NUM, &available);
+        const size_t space = dst_size - 1 - dst_pos;
+        if (space == 0)
+            return false;
+
+        const int len = uart_read_bytes(ELM327_UART_NUM,
+                                        &dst[dst_pos],
+                                        MAX(1, MIN(available, space)),
+                                        timeout_ticks - elapsed_ticks);
+        if (len <= 0)
+            continue;
+
+        char* prompt = memchr(&dst[dst_pos], ELM327_PROMPT, len);
+        dst_pos += len;
+        if (prompt != NULL) {
+            *prompt = '\0';
+            return true;
+        }
+    }
+}
+
+/*
+ * Send the specified AT command, and check that the adapter responded with
+ * "OK". Returns true on success, or false otherwise.
+ */
+static bool send_at_command(const char* command) {
+    char response[64];
+    if (!send_command(command, response, sizeof(response), ELM327_TIMEOUT_MS))
+        return false;
+    return strstr(response, "OK") != NULL;
+}
+
+/*
+ * Convert the specified line of hexadecimal digits into bytes, appending up to
+ * 'dst_size' of them to 'dst' from position '*dst_pos', which is updated.
+ * Returns false if the line is not entirely hexadecimal data, like
+ * "SEARCHING...", in which case nothing is stored.
+ */
+static bool hex_line_to_bytes(const char* line,
+                              uint8_t* dst,
+                              size_t dst_size,
+                              size_t* dst_pos) {
+    const size_t line_len = strlen(line);
+    if (line_len == 0 || line_len % 2 != 0)
+        return false;
+
+    for (size_t i = 0; i < line_len; i++)
+        if (hex_digit_value(line[i]) < 0)
+            return false;
+
+    for (size_t i = 0; i < line_len && *dst_pos < dst_size; i += 2)
+        dst[(*dst_pos)++] = (hex_digit_value(line[i]) << 4) |
+                            hex_digit_value(line[i + 1]);
+    return true;
+}
+
+/*
+ * Decode the PIDs of a single response message, that is, the data of a
+ * positive mode 01 response from one ECU. The value of each PID is written to
+ * the position of 'dst' where it was requested, and that position of
+ * 'received' is set. Returns the number of positions that were set for the
+ * first time.
+ */
+static int decode_message(const uint8_t* bytes,
+                          size_t num_bytes,
+                          const uint8_t* pids,
+                          int num_pids,
+                          float* dst,
+                          bool* received) {
+    if (num_bytes < 1 ||
+        bytes[0] != OBD_RESPONSE_OFFSET + OBD_MODE_CURRENT_DATA)
+        return 0;
+
+    /*
+     * The message contains each PID followed by its data bytes, not
+     * necessarily in the same order as the request.
+     */
+    int num_decoded = 0;
+    size_t pos      = 1;
+    while (pos < num_bytes) {
+        const PidInfo* info = find_pid_info(bytes[pos]);
+        if (info == NULL || pos + 1 + info->num_bytes > num_bytes)
+            break;
+
+        uint32_t raw = 0;
+        for (int i = 0; i < info->num_bytes; i++)
+            raw = (raw << 8) | bytes[pos + 1 + i];
+
+        for (int i = 0; i < num_pids; i++) {
+            if (pids[i] == info->pid) {
+                dst[i] = raw * info->scale + info->offset;
+                if (!received[i])
+                    num_decoded++;
+                received[i] = true;
+                break;
+            }
+        }
+
+        pos += 1 + info->num_bytes;
+    }
+
+    return num_decoded;
+}
+
+/*
+ * Decode every message of the specified response with 'decode_message'.
+ * Returns the number of requested PIDs that were received.
+ *
+ * With headers and spaces disabled, single-frame CAN messages are a single
+ * line of hexadecimal digits. Multi-frame messages start with a line containing
+ * their total number of bytes, followed by lines with a "N:" prefix, where N is
+ * the frame index; the last frame is padded, so the byte count is used for
+ * finding the end of the data. When several ECUs respond, each of them sends
+ * its own message. Lines that are not hexadecimal data, like "SEARCHING...",
+ * are ignored.
+ */
+static int decode_response(char* response,
+                           const uint8_t* pids,
+                           int num_pids,
+                           float* dst) {
+    bool received[ELM327_MAX_PIDS_PER_REQUEST] = { false };
+    int num_decoded                            = 0;
+
+    /* Multi-frame message being received, if its size is not zero */
+    uint8_t message[64];
+    size_t message_size = 0;
+    size_t message_pos  = 0;
+
+    for (char* line = strtok(response, "\r\n"); line != NULL;
+         line = strtok(NULL, "\r\n")) {
+        char* colon = strchr(line, ':');
+        if (colon != NULL) {
+            if (message_size > 0)
+                hex_line_to_bytes(colon + 1,
+                                  message,
+                                  message_size,
+                                  &message_pos);
+        } else if (strlen(line) == 3) {
+            /* Byte count of a new multi-frame message */
+            message_size = MIN(strtoul(line, NULL, 16), sizeof(message));
+            message_pos  = 0;
+        } else {
+            uint8_t bytes[8];
+            size_t num_bytes = 0;
+            if (hex_line_to_bytes(line, bytes, sizeof(bytes), &num_bytes))
+                num_decoded += decode_message(bytes,
+                                              num_bytes,
+                                              pids,
+                                              num_pids,
+                                              dst,
+                                              received);
+        }
+
+        /* Decode multi-frame messages once all their frames arrived */
+        if (message_size > 0 && message_pos >= message_size) {
+            num_decoded += decode_message(message,
+                                          message_size,
+                                          pids,
+                                          num_pids,
+                                          dst,
+                                          received);
+            message_size = 0;
+        }
+    }
+
+    /* Decode whatever arrived of an incomplete multi-frame message */
+    if (message_size > 0)
+        num_decoded +=
+          decode_message(message, message_pos, pids, num_pids, dst, received);
+
+    return num_decoded;
+}
+
+/*
+ * Get the number of CAN frames of the response to a request for the specified
+ * PIDs, if a single ECU supports all of them. Returns zero if any of the PIDs
+ * is not known.
+ *
+ * The first frame of a message has room for 7 data bytes if the whole message
+ * fits in it, or for 6 otherwise, since the byte count takes the rest, and each
+ * of the consecutive frames has room for 7 more.
+ */
+static int expected_response_frames(const uint8_t* pids, int num_pids) {
+    size_t num_bytes = 1;
+    for (int i = 0; i < num_pids; i++) {
+        const PidInfo* info = find_pid_info(pids[i]);
+        if (info == NULL)
+            return 0;
+        num_bytes += 1 + info->num_bytes;
+    }
+
+    /* 6 bytes fit in the first frame, and 7 in each consecutive frame */
+    if (num_bytes <= 7)
+        return 1;
+    return 1 + DIV_CEIL(num_bytes - 6, 7);
+}
+
+/*----------------------------------------------------------------------------*/
+
+bool elm327_init(void) {
+    const uart_config_t uart_config = {
+        .baud_rate  = ELM327_UART_BAUD_RATE,
+        .data_bits  = UART_DATA_8_BITS,
+        .parity     = UART_PARITY_DISABLE,
+        .stop_bits  = UART_STOP_BITS_1,
+        .flow_ctrl  = UART_HW_FLOWCTRL_DISABLE,
+        .source_clk = UART_SCLK_DEFAULT,
+    };
+
+    /*
+     * The initialization is retried until the adapter responds, but the
+     * driver can only be installed once.
+     */
+    if (!uart_is_driver_installed(ELM327_UART_NUM)) {
+        uart_param_config(ELM327_UART_NUM, &uart_config);
+        uart_set_pin(ELM327_UART_NUM,
+                     ELM327_UART_TX_PIN,
+                     ELM327_UART_RX_PIN,
+                     UART_PIN_NO_CHANGE,
+                     UART_PIN_NO_CHANGE);
+        uart_driver_install(ELM327_UART_NUM,
+                            ELM327_UART_BUF_SIZE,
+                            0,
+                            0,
+                            NULL,
+                            0);
+    }
+
+    /* Reset the adapter; it responds with its version instead of "OK" */
+    char response[64];
+    if (!send_command("ATZ",
+                      response,
+                      sizeof(response),
+                      ELM327_RESET_TIMEOUT_MS)) {
+        fprintf(stderr, "ELM327 adapter didn't respond to reset\n");
+        return false;
+    }
+
+    /*
+     * Disable everything that is not needed for decoding the responses, so
+     * each of them has as few bytes as possible.
+     */
+    static const char* const setup_commands[] = {
+        "ATE0",  /* Echo off */
+        "ATL0",  /* Linefeeds off */
+        "ATS0",  /* Spaces off */
+        "ATH0",  /* Headers off */
+        "ATSP0", /* Automatic protocol */
+    };
+
+    for (size_t i = 0; i < LENGTH(setup_commands); i++) {
+        if (!send_at_command(setup_commands[i])) {
+            fprintf(stderr,
+                    "ELM327 adapter rejected command '%s'\n",
+                    setup_commands[i]);
+            return false;
+        }
+    }
+
+    g_first_request      = true;
+    g_use_response_count = true;
+    return true;
+}
+
+int elm327_read_pids(const uint8_t* pids, int num_pids, float* dst) {
+    if (num_pids <= 0 || num_pids > ELM327_MAX_PIDS_PER_REQUEST)
+        return 0;
+
+    /*
+     * Build the request: the mode, each PID, and, if possible, a final digit
+     * with the number of expected CAN frames.
+     */
+    char request[4 + ELM327_MAX_PIDS_PER_REQUEST * 2];
+    int request_pos = snprintf(request, sizeof(request), "%02X",
+                               OBD_MODE_CURRENT_DATA);
+    for (int i = 0; i < num_pids; i++)
+        request_pos += snprintf(&request[request_pos],
+                                sizeof(request) - request_pos,
+                                "%02X",
+                                pids[i]);
+
+    const int num_frames = expected_response_frames(pids, num_pids);
+    const bool use_response_count =
+      g_use_response_count && num_frames > 0 && num_frames <= 0xF;
+    if (use_response_count)
+        snprintf(&request[request_pos],
+                 sizeof(request) - request_pos,
+                 "%X",
+                 num_frames);
+
+    const int timeout_ms =
+      g_first_request ? ELM327_FIRST_TIMEOUT_MS : ELM327_TIMEOUT_MS;
+    g_first_request = false;
+
+    char response[256];
+    if (!send_command(request, response, sizeof(response), timeout_ms))
+        return 0;
+
+    const int num_decoded = decode_response(response, pids, num_pids, dst);
+    if (use_response_count && num_decoded < num_pids) {
+        fprintf(stderr,
+                "ELM327 response missed %d PIDs, no longer limiting the "
+                "number of responses\n",
+                num_pids - num_decoded);
+        g_use_response_count = false;
+    }
+
+    return num_decoded;
+}
+
+bool elm327_pid_is_known(uint8_t pid) {
+    return find_pid_info(pid) != NULL;
+}
+
+bool elm327_get_pid_format(uint8_t pid, float* scale, float* offset) {
+    const PidInfo* info = find_pid_info(pid);
+    if (info == NULL)
+        return false;
+
+    *scale  = info->scale;
+    *offset = info->offset;
+    return true;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef ELM327_H_
+#define ELM327_H_ 1
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Maximum number of PIDs that can be packed in a single mode 01 request.
+ */
+#define ELM327_MAX_PIDS_PER_REQUEST 6
+
+/*
+ * Some common mode 01 (current data) PIDs, as defined by SAE J1979. See the
+ * table in 'elm327.c' for the units of their decoded values.
+ */
+#define ELM327_PID_ENGINE_LOAD     0x04
+#define ELM327_PID_COOLANT_TEMP    0x05
+#define ELM327_PID_INTAKE_PRESSURE 0x0B
+#define ELM327_PID_ENGINE_RPM      0x0C
+#define ELM327_PID_VEHICLE_SPEED   0x0D
+#define ELM327_PID_TIMING_ADVANCE  0x0E
+#define ELM327_PID_INTAKE_TEMP     0x0F
+#define ELM327_PID_MAF_RATE        0x10
+#define ELM327_PID_THROTTLE        0x11
+#define ELM327_PID_FUEL_LEVEL      0x2F
+#define ELM327_PID_MODULE_VOLTAGE  0x42
+#define ELM327_PID_AMBIENT_TEMP    0x46
+#define ELM327_PID_OIL_TEMP        0x5C
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Initialize the UART connected to the ELM327 adapter, and configure the
+ * adapter for minimal traffic: echo, linefeeds, spaces and headers are
+ * disabled, and the OBD protocol is detected automatically.
+ *
+ * This function returns true on success, or false if the adapter didn't
+ * respond as expected.
+ */
+bool elm327_init(void);
+
+/*
+ * Request the current values of the specified mode 01 PIDs in a single
+ * request, and write the decoded value of each PID to the same position in
+ * 'dst'. At most 'ELM327_MAX_PIDS_PER_REQUEST' PIDs can be requested at once.
+ *
+ * The request includes the number of CAN frames of the expected response, so
+ * the adapter returns as soon as the vehicle responds, instead of waiting for
+ * its timeout. If a response misses some PID, the following requests don't
+ * include it, so the responses of every ECU are received. Note that requesting
+ * multiple PIDs at once is only supported by vehicles using CAN protocols.
+ *
+ * Returns the number of PIDs whose value was decoded from the response. The
+ * values of PIDs missing from the response are left untouched in 'dst'.
+ */
+int elm327_read_pids(const uint8_t* pids, int num_pids, float* dst);
+
+/*
+ * Is the specified mode 01 PID supported by 'elm327_read_pids'?
+ */
+bool elm327_pid_is_known(uint8_t pid);
+
+/*
+ * Get the factor and offset applied by 'elm327_read_pids' to the raw value of
+ * the specified mode 01 PID, that is, 'value = raw * scale + offset'. Returns
+ * false if the PID is not known.
+ */
+bool elm327_get_pid_format(uint8_t pid, float* scale, float* offset);
+
+#endif /* ELM327_H_ */
@@ -0,0 +1,163 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "frame.h"
+#include <stdlib.h> /* abs */
+#include <string.h> /* memcpy */
+
+/*
+ * Size of the fixed header of each frame type, and of the CRC trailer.
+ */
+#define FRAME_HEADER_SIZE_F32 4
+#define FRAME_HEADER_SIZE_I16 5
+#define FRAME_CRC_SIZE        2
+
+/*
+ * Maximum absolute value of the decimal exponent of 'FRAME_TYPE_I16' frames.
+ */
+#define FRAME_MAX_EXPONENT 10
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Decode the specified COBS-encoded data into 'dst', which must be able to
+ * hold 'dst_size' bytes. Returns the number of decoded bytes, or zero if the
+ * data is malformed or if it doesn't fit in 'dst'.
+ */
+static size_t cobs_decode(const uint8_t* src,
+                          size_t src_size,
+                          uint8_t* dst,
+                          size_t dst_size) {
+    size_t src_pos = 0;
+    size_t dst_pos = 0;
+
+    while (src_pos < src_size) {
+        /*
+         * Each block starts with a code byte, which is the offset of the next
+         * zero byte in the original data. A code of 0xFF indicates a block of
+         * 254 bytes that was not followed by a zero.
+         */
+        const uint8_t code = src[src_pos++];
+        if (code == 0)
+            return 0;
+
+        for (int i = 1; i < code; i++) {
+            if (src_pos >= src_size || dst_pos >= dst_size)
+                return 0;
+            dst[dst_pos++] = src[src_pos++];
+        }
+
+        /* The zero implied by the last block is not part of the data */
+        if (code != 0xFF && src_pos < src_size) {
+            if (dst_pos >= dst_size)
+                return 0;
+            dst[dst_pos++] = 0;
+        }
+    }
+
+    return dst_pos;
+}
+
+/*
+ * Calculate the CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF)
+ * of the specified data.
+ */
+static uint16_t crc16(const uint8_t* data, size_t size) {
+    uint16_t crc = 0xFFFF;
+
+    for (size_t i = 0; i < size; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+
+    return crc;
+}
+
+static inline uint16_t read_u16_le(const uint8_t* src) {
+    return (uint16_t)src[0] | ((uint16_t)src[1] << 8);
+}
+
+static inline float read_f32_le(const uint8_t* src) {
+    const uint32_t bits = (uint32_t)src[0] | ((uint32_t)src[1] << 8) |
+                          ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+bool frame_decode_sample(const uint8_t* encoded,
+                         size_t encoded_size,
+                         float* dst,
+                         int num_values,
+                         uint16_t* sequence) {
+    uint8_t frame[FRAME_MAX_SIZE];
+    const size_t frame_size =
+      cobs_decode(encoded, encoded_size, frame, sizeof(frame));
+    if (frame_size < FRAME_HEADER_SIZE_F32 + FRAME_CRC_SIZE)
+        return false;
+
+    /* Verify the CRC before interpreting any other field */
+    const size_t crc_pos = frame_size - FRAME_CRC_SIZE;
+    if (read_u16_le(&frame[crc_pos]) != crc16(frame, crc_pos))
+        return false;
+
+    const uint8_t type = frame[0];
+    if (frame[1] != num_values)
+        return false;
+
+    switch (type) {
+        case FRAME_TYPE_F32: {
+            if (crc_pos != FRAME_HEADER_SIZE_F32 + num_values * 4)
+                return false;
+
+            const uint8_t* payload = &frame[FRAME_HEADER_SIZE_F32];
+            for (int i = 0; i < num_values; i++)
+                dst[i] = read_f32_le(&payload[i * 4]);
+        } break;
+
+        case FRAME_TYPE_I16: {
+            if (crc_pos != FRAME_HEADER_SIZE_I16 + num_values * 2)
+                return false;
+
+            const int exponent = (int8_t)frame[4];
+            if (exponent < -FRAME_MAX_EXPONENT || exponent > FRAME_MAX_EXPONENT)
+                return false;
+
+            /* Powers of ten up to 10^10 are exact in a float */
+            float power = 1.f;
+            for (int i = 0; i < abs(exponent); i++)
+                power *= 10.f;
+
+            const uint8_t* payload = &frame[FRAME_HEADER_SIZE_I16];
+            for (int i = 0; i < num_values; i++) {
+                const float raw = (int16_t)read_u16_le(&payload[i * 2]);
+                dst[i] = (exponent < 0) ? raw / power : raw * power;
+            }
+        } break;
+
+        default:
+            return false;
+    }
+
+    *sequence = read_u16_le(&frame[2]);
+    return true;
+}
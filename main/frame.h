@@ -0,0 +1,83 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef FRAME_H_
+#define FRAME_H_ 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Binary sample frames.
+ *
+ * As an alternative to ASCII records, samples can be sent as binary frames,
+ * which are protected by a CRC and need no parsing. Only the scaled 16-bit
+ * values of 'FRAME_TYPE_I16' frames are smaller than ASCII records: with the
+ * four one-decimal values of 'bench_frame', integer frames take 17 bytes per
+ * sample, against 19.8 bytes for ASCII records and 24 bytes for float frames,
+ * since each frame adds 8 or 9 bytes of header, CRC, COBS and delimiter.
+ *
+ * Before encoding, a frame has the following layout, with all multi-byte
+ * fields in little-endian:
+ *
+ *   Offset  Size  Description
+ *   0       1     Frame type ('FRAME_TYPE_F32' or 'FRAME_TYPE_I16').
+ *   1       1     Number of values (N).
+ *   2       2     Sequence number, incremented by one on each frame.
+ *   4       1     Only in 'FRAME_TYPE_I16': signed decimal exponent (E).
+ *   ...     ...   N values, either as 32-bit IEEE 754 floats, or as signed
+ *                 16-bit integers whose real value is 'raw * 10^E'.
+ *   ...     2     CRC-16/CCITT-FALSE of all the previous bytes.
+ *
+ * The whole frame is then encoded with COBS (Consistent Overhead Byte
+ * Stuffing), so it never contains a zero byte, and it's followed by a single
+ * zero byte as delimiter. This allows the receiver to resynchronize at the
+ * next delimiter after any corrupted byte.
+ */
+#define FRAME_TYPE_F32 0x01
+#define FRAME_TYPE_I16 0x02
+
+/*
+ * Value of the byte used for delimiting COBS-encoded frames.
+ */
+#define FRAME_DELIMITER 0x00
+
+/*
+ * Maximum size of a decoded frame, in bytes.
+ */
+#define FRAME_MAX_SIZE 255
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Decode the specified COBS-encoded frame (without its delimiter), and write
+ * its 'num_values' values to 'dst', and its sequence number to 'sequence'.
+ *
+ * This function returns true on success, or false if the frame is malformed,
+ * if its CRC doesn't match, or if it doesn't contain exactly 'num_values'
+ * values. On failure, 'dst' is left untouched.
+ */
+bool frame_decode_sample(const uint8_t* encoded,
+                         size_t encoded_size,
+                         float* dst,
+                         int num_values,
+                         uint16_t* sequence);
+
+#endif /* FRAME_H_ */
@@ -16,13 +16,22 @@
  * this program. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <inttypes.h> /* PRId64 */
+#include <math.h>     /* NAN, isnan */
 #include <stdio.h>
-#include <string.h> /* memset, strtok */
-#include <stdlib.h> /* atof */
+#include <stdlib.h> /* qsort */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"     /* esp_timer_get_time */
+#include "esp_heap_caps.h" /* heap_caps_get_free_size */
 
 #include "render.h"
 #include "chart.h"
 #include "serial_uart.h"
+#include "elm327.h"
+#include "pid_scheduler.h"
+#include "sample_queue.h"
 #include "util.h"
 
 /*
@@ -37,60 +46,664 @@
  * fields.
  */
 #define CHANNEL_NUM 4
+_Static_assert(CHANNEL_NUM <= SAMPLE_MAX_CHANNELS,
+               "Too many channels for a single sample");
+_Static_assert(CHANNEL_NUM <= PID_SCHEDULER_MAX_CHANNELS,
+               "Too many channels for the PID scheduler");
 
 /*
- * ESP-IDF application entry point.
+ * Source of the plotted data. With 'INPUT_SOURCE_SERIAL', records are received
+ * from a computer through the USB port (see 'serial_uart.h'). With
+ * 'INPUT_SOURCE_ELM327', the PIDs in 'channel_pids' are polled directly from an
+ * ELM327 adapter (see 'elm327.h'), at the rates decided by a 'PidScheduler'.
+ */
+#define INPUT_SOURCE_SERIAL 0
+#define INPUT_SOURCE_ELM327 1
+#define INPUT_SOURCE        INPUT_SOURCE_SERIAL
+
+/*
+ * Time to wait before retrying the initialization of the ELM327 adapter, in
+ * milliseconds.
+ */
+#define ELM327_RETRY_DELAY_MS 1000
+
+/*
+ * How the chart is updated on the display after receiving new samples.
+ *
+ * With 'DISPLAY_MODE_REDRAW', the whole chart is redrawn and the full
+ * framebuffer is flushed each time.
  *
- * Initializes the display and UART, then enters a loop to read CSV data from
- * serial and plot it as a scrolling multi-channel line chart.
+ * With 'DISPLAY_MODE_HW_SCROLL', the hardware scrolling of the LCD is advanced
+ * by one column per sample, so only the newly exposed columns are drawn and
+ * flushed.
+ *
+ * With 'DISPLAY_MODE_SWEEP', the chart doesn't scroll. Instead, like in an
+ * oscilloscope, a cursor sweeps from left to right, and each sample is drawn in
+ * the column under it, followed by a blank gap of 'SWEEP_GAP' columns that
+ * separates the newest samples from the oldest ones. Only the column under the
+ * cursor and the column at the end of the gap are flushed.
+ *
+ * In the last two modes, the whole chart is only redrawn when its scale
+ * changes.
  */
-void app_main(void) {
-    /* Initialize rendering */
-    RenderCtx render_ctx;
-    render_init(&render_ctx, LCD_WIDTH, LCD_HEIGHT);
-    render_clear(&render_ctx);
-    render_flush(&render_ctx);
+#define DISPLAY_MODE_REDRAW    0
+#define DISPLAY_MODE_HW_SCROLL 1
+#define DISPLAY_MODE_SWEEP     2
+#define DISPLAY_MODE           DISPLAY_MODE_REDRAW
 
-    /* Initialize chart context, which will contain the data being plotted */
+/*
+ * Number of blank columns after the cursor, when using 'DISPLAY_MODE_SWEEP'.
+ */
+#if DISPLAY_MODE == DISPLAY_MODE_SWEEP
+#define SWEEP_GAP 8
+#else
+#define SWEEP_GAP 0
+#endif
+
+/*
+ * Buffers used for rendering the display. With 'RENDER_STRIPES', the chart is
+ * drawn once for each horizontal stripe of the screen, instead of into a
+ * framebuffer, which saves most of the DMA-capable memory. See
+ * 'RenderBuffering'.
+ */
+#define RENDER_BUFFERING RENDER_FRAMEBUFFER
+
+/*
+ * Number of samples for which the data must fit in a smaller range before the
+ * chart is scaled down. The chart is scaled up as soon as the data doesn't fit.
+ */
+#define SCALE_SHRINK_DWELL 64
+
+/*
+ * Number of samples collapsed into each column of the chart. When samples
+ * arrive faster than the chart should scroll, each column is drawn as an
+ * envelope between the extremes of its samples, so spikes remain visible, and
+ * the rendering work per frame doesn't depend on the input rate.
+ */
+#define SAMPLES_PER_COLUMN 1
+
+/*
+ * Duration of each column of the chart, in microseconds, or zero for starting
+ * the columns by number of samples instead. With a duration, the samples are
+ * placed by their timestamps, so the X axis is a time axis: samples that
+ * arrive in bursts (e.g. after a stalled read) are collapsed into the columns
+ * of their periods, and periods without samples are left empty. In that case,
+ * 'SAMPLES_PER_COLUMN' should be the expected number of samples per period.
+ * See 'chart_set_column_period'.
+ *
+ * It's disabled by default, so the chart scrolls a column per sample (or per
+ * 'SAMPLES_PER_COLUMN' samples). For example, 50000 shows 20 columns per
+ * second.
+ */
+#define COLUMN_PERIOD_US 0
+
+/*
+ * Number of downsampled history tiers kept by the chart, and memory budget of
+ * each one, in bytes. Each tier halves the resolution of the previous one, so
+ * with a bucket per column, the last of N tiers covers 'LCD_WIDTH' times 2^N
+ * samples. See 'ChartTier'.
+ *
+ * The tiers are only drawn in views longer than the display (see
+ * 'REDRAW_VIEW_SAMPLES'), and each one takes about 15 KiB of the internal RAM,
+ * so they are disabled by default.
+ */
+#define HISTORY_NUM_TIERS 0
+#define HISTORY_TIER_BUDGET                                                    \
+    ((LCD_WIDTH + 1) * CHANNEL_NUM * sizeof(ChartBucket))
+
+/*
+ * Memory budget of the compressed log of exact samples kept by the chart, in
+ * bytes, including the columns that it's collapsed into for rendering, or zero
+ * for not keeping a log. Zoomed-out views that it covers are rendered from it
+ * instead of the downsampled history, so it can take the place of the upper
+ * tiers, with their budget. For example, '2 * HISTORY_TIER_BUDGET' holds over
+ * 3000 samples of the default channels in the drive of 'bench_sample_log',
+ * while two tiers only cover 1280 samples, without their exact values. See
+ * 'chart_init_log'.
+ *
+ * Like the tiers, it's only drawn in views longer than the display, so it's
+ * disabled by default.
+ */
+#define HISTORY_LOG_BYTES 0
+
+/*
+ * Number of samples displayed when using 'DISPLAY_MODE_REDRAW'. If it's larger
+ * than the display width, the chart is zoomed out, and rendered from the
+ * compressed log or the downsampled history (see 'chart_render_history').
+ */
+#define REDRAW_VIEW_SAMPLES LCD_WIDTH
+
+/*
+ * Number of samples that can be buffered between the ingestion and render
+ * tasks (must be a power of two), and maximum number of samples that the
+ * render task pops at once.
+ */
+#define SAMPLE_QUEUE_CAPACITY 128
+#define RENDER_BATCH_SIZE     16
+
+/*
+ * Number of frames whose render time is accumulated before reporting its
+ * percentiles.
+ */
+#define FRAME_TIME_WINDOW 128
+
+/*
+ * Configuration of the FreeRTOS tasks. The ingestion task has a higher priority
+ * than the render task, and they run on different cores, so input is consumed
+ * while a frame is being rendered or flushed.
+ */
+#define INGEST_TASK_CORE       0
+#define INGEST_TASK_PRIORITY   6
+#define INGEST_TASK_STACK_SIZE 4096
+#define RENDER_TASK_CORE       1
+#define RENDER_TASK_PRIORITY   5
+#define RENDER_TASK_STACK_SIZE 4096
+
+/*
+ * Structure containing the state shared by the application tasks.
+ */
+typedef struct AppCtx {
+    RenderCtx render_ctx;
     ChartCtx chart_ctx;
-    chart_init(&chart_ctx, CHANNEL_NUM, render_get_width(&render_ctx));
 
-    /* Initialize serial communication, which will be used to receive data */
+    /* Queue of received samples, from the ingestion to the render task */
+    SampleQueue sample_queue;
+
+    /* Handle of the render task, notified whenever a sample is queued */
+    TaskHandle_t render_task;
+
+    /*
+     * Framebuffer column where the next sample will be drawn, when using
+     * 'DISPLAY_MODE_HW_SCROLL' or 'DISPLAY_MODE_SWEEP'. In the former, it's
+     * also the hardware scrolling offset (see 'render_scroll').
+     */
+    int cursor;
+
+    /*
+     * Time spent by the render task on each of the last frames, in
+     * microseconds. See 'report_frame_time'.
+     */
+    int64_t frame_times_us[FRAME_TIME_WINDOW];
+    int num_frame_times;
+} AppCtx;
+
+/*
+ * Axis used for scaling each channel. Channels with the same axis share their
+ * range, which is useful for comparing values with the same unit. The other
+ * channels are scaled independently, so signals with very different ranges
+ * (e.g. engine RPM and coolant temperature) can be plotted together.
+ */
+static const int channel_axes[CHANNEL_NUM] = { 0, 1, 2, 3 };
+
+#if INPUT_SOURCE == INPUT_SOURCE_ELM327
+/*
+ * Mode 01 PID plotted in each channel when polling an ELM327 adapter, along
+ * with its target polling rate and priority. Fast-changing signals are polled
+ * much more often than slow ones, so they don't compete for the bandwidth of
+ * the OBD bus.
+ */
+static const PidSchedulerConfig channel_pids[CHANNEL_NUM] = {
+    { ELM327_PID_ENGINE_RPM,    20.f, 2 },
+    { ELM327_PID_VEHICLE_SPEED, 10.f, 1 },
+    { ELM327_PID_COOLANT_TEMP,  0.5f, 0 },
+    { ELM327_PID_THROTTLE,      20.f, 2 },
+};
+
+/* Scheduler that decides which PIDs are requested each time */
+static PidScheduler g_pid_scheduler;
+#endif
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Initialize the selected input source. This function blocks until the input
+ * is ready.
+ */
+static void input_init(void) {
+#if INPUT_SOURCE == INPUT_SOURCE_ELM327
+    while (!elm327_init()) {
+        fprintf(stderr, "Failed to initialize ELM327 adapter, retrying...\n");
+        vTaskDelay(pdMS_TO_TICKS(ELM327_RETRY_DELAY_MS));
+    }
+
+    pid_scheduler_init(&g_pid_scheduler,
+                       channel_pids,
+                       CHANNEL_NUM,
+                       esp_timer_get_time());
+#else
     serial_uart_init();
+#endif
+}
+
+/*
+ * Get the format of the values of each channel, used by the chart for storing
+ * them as 16-bit codes. The values of OBD PIDs are always a raw integer scaled
+ * by a fixed factor, so they can be stored exactly. Returns NULL if the values
+ * of the selected input source have no format, and must be stored as floats.
+ */
+static const ChartFormat* input_get_formats(void) {
+#if INPUT_SOURCE == INPUT_SOURCE_ELM327
+    static ChartFormat formats[CHANNEL_NUM];
+    for (int i = 0; i < CHANNEL_NUM; i++) {
+        if (!elm327_get_pid_format(channel_pids[i].pid,
+                                   &formats[i].scale,
+                                   &formats[i].offset)) {
+            fprintf(stderr,
+                    "Unknown PID %02X in channel %d\n",
+                    channel_pids[i].pid,
+                    i);
+            abort();
+        }
+    }
+    return formats;
+#else
+    return NULL;
+#endif
+}
 
+/*
+ * Read the values of a new sample from the selected input source into
+ * 'values'. Returns true on success, or false if no value could be read, in
+ * which case 'values' is left untouched.
+ */
+static bool input_read(float* values) {
+#if INPUT_SOURCE == INPUT_SOURCE_ELM327
     /*
-     * Array of values read each iteration. It is declared outside of the main
-     * loop, so the old values are stored in case one read fails.
+     * Ask the scheduler which channels should be polled now. If none of them
+     * is due yet, sleep until the next one is.
      */
-    float values[CHANNEL_NUM];
-    for (int i = 0; i < LENGTH(values); i++)
-        values[i] = 0.f;
+    const int64_t start_us = esp_timer_get_time();
+    int batch[ELM327_MAX_PIDS_PER_REQUEST];
+    const int batch_size = pid_scheduler_next_batch(&g_pid_scheduler,
+                                                    start_us,
+                                                    batch,
+                                                    LENGTH(batch));
+    if (batch_size == 0) {
+        const int64_t wait_us =
+          pid_scheduler_time_until_due(&g_pid_scheduler, start_us);
+        vTaskDelay(MAX(1, pdMS_TO_TICKS(wait_us / 1000)));
+        return false;
+    }
+
+    /* Request all the selected PIDs at once */
+    uint8_t pids[ELM327_MAX_PIDS_PER_REQUEST];
+    float decoded[ELM327_MAX_PIDS_PER_REQUEST];
+    for (int i = 0; i < batch_size; i++) {
+        pids[i]    = g_pid_scheduler.channels[batch[i]].config.pid;
+        decoded[i] = NAN;
+    }
+    const int num_decoded = elm327_read_pids(pids, batch_size, decoded);
+
+    /* Update the channels whose PID was received */
+    bool received[ELM327_MAX_PIDS_PER_REQUEST];
+    for (int i = 0; i < batch_size; i++) {
+        received[i] = !isnan(decoded[i]);
+        if (received[i])
+            values[batch[i]] = decoded[i];
+    }
+
+    /* Report the achieved rates whenever they are updated */
+    if (pid_scheduler_complete(&g_pid_scheduler,
+                               batch,
+                               received,
+                               batch_size,
+                               start_us,
+                               esp_timer_get_time())) {
+        printf("PID rates (RTT %" PRId64 " us):", g_pid_scheduler.rtt_us);
+        for (int i = 0; i < g_pid_scheduler.num_channels; i++)
+            printf(" %02X=%.1f/%.1fHz",
+                   g_pid_scheduler.channels[i].config.pid,
+                   g_pid_scheduler.channels[i].achieved_hz,
+                   g_pid_scheduler.channels[i].config.target_hz);
+        printf("\n");
+    }
+
+    if (num_decoded == 0) {
+        fprintf(stderr, "No PIDs were received from the ELM327 adapter\n");
+        return false;
+    }
+    return true;
+#else
+    /*
+     * Read a complete record from serial. If it's malformed, it's discarded as
+     * a whole.
+     */
+    if (!serial_uart_read_record(values, CHANNEL_NUM)) {
+        SerialUartStats stats;
+        serial_uart_get_stats(&stats);
+        fprintf(stderr,
+                "Rejected malformed serial record (%u accepted, %u "
+                "rejected)\n",
+                stats.records_accepted,
+                stats.records_rejected);
+        return false;
+    }
+    return true;
+#endif
+}
+
+/*
+ * Ingestion task. Reads samples from the selected input source, timestamps
+ * them, and pushes them to the sample queue, notifying the render task.
+ */
+static void ingest_task(void* param) {
+    AppCtx* ctx = param;
+
+    input_init();
+
+    /*
+     * The sample is declared outside of the loop, so channels that are not
+     * updated by a read keep their previous value.
+     */
+    Sample sample = { 0 };
 
     for (;;) {
-        /* Read values from serial */
-        for (int i = 0; i < LENGTH(values); i++) {
-            float received_value;
-            if (!serial_uart_read_value(&received_value)) {
-                fprintf(stderr,
-                        "Failed to read serial data in channel #%d\n",
-                        i);
-                continue;
-            }
-            values[i] = received_value;
+        if (!input_read(sample.values))
+            continue;
+        sample.timestamp_us = esp_timer_get_time();
+
+        /*
+         * Never block the ingestion if the render task falls behind; the
+         * sample is dropped instead, and accounted in the queue.
+         */
+        if (!sample_queue_push(&ctx->sample_queue, &sample)) {
+            fprintf(stderr,
+                    "Sample queue full, dropped sample (%u total)\n",
+                    atomic_load(&ctx->sample_queue.dropped));
+            continue;
         }
 
-        /* Push the received values to the chart context */
-        chart_push(&chart_ctx, values, LENGTH(values));
+        xTaskNotifyGive(ctx->render_task);
+    }
+}
+
+/*
+ * Clear the display, as a 'RenderDrawFunc'.
+ */
+static void draw_blank(RenderCtx* render_ctx, void* arg) {
+    render_clear(render_ctx);
+}
+
+#if DISPLAY_MODE == DISPLAY_MODE_HW_SCROLL || DISPLAY_MODE == DISPLAY_MODE_SWEEP
+/*
+ * Draw the chart relative to the cursor, as a 'RenderDrawFunc'. The newest
+ * sample is displayed just before the cursor, and older samples are displayed
+ * further to the left, wrapping around the screen until the blank gap after the
+ * cursor. Only the columns inside the clipping area are drawn.
+ */
+static void draw_chart(RenderCtx* render_ctx, void* arg) {
+    const AppCtx* ctx = arg;
+    const int width   = render_get_width(render_ctx);
+
+    render_clear(render_ctx);
+    for (int x = render_ctx->clip_rect.x0; x < render_ctx->clip_rect.x1; x++) {
+        const int age = ((ctx->cursor - 1 - x) % width + width) % width;
+        if (age < width - SWEEP_GAP)
+            chart_render_column(&ctx->chart_ctx, render_ctx, x, age);
+    }
+}
+
+/*
+ * Redraw the specified number of columns, starting at 'x' and wrapping around
+ * the right edge of the screen.
+ */
+static void redraw_columns(AppCtx* ctx, int x, int num_columns) {
+    const int width  = render_get_width(&ctx->render_ctx);
+    const int height = render_get_height(&ctx->render_ctx);
+
+    num_columns             = MIN(num_columns, width);
+    const int first_columns = MIN(num_columns, width - x);
+    render_area(&ctx->render_ctx,
+                x,
+                0,
+                x + first_columns,
+                height,
+                draw_chart,
+                ctx);
+    render_area(&ctx->render_ctx,
+                0,
+                0,
+                num_columns - first_columns,
+                height,
+                draw_chart,
+                ctx);
+}
+#else
+/*
+ * Draw the whole chart, as a 'RenderDrawFunc'. Only the traces of the previous
+ * frame are erased, instead of clearing the whole display.
+ */
+static void draw_chart(RenderCtx* render_ctx, void* arg) {
+    AppCtx* ctx = arg;
+
+    render_erase(render_ctx);
+    chart_render_history(&ctx->chart_ctx, render_ctx, REDRAW_VIEW_SAMPLES);
+}
+#endif
+
+/*
+ * Update the display after samples were pushed to the chart, starting the
+ * specified number of new columns, according to the selected 'DISPLAY_MODE'.
+ */
+static void update_display(AppCtx* ctx, int num_new, bool scale_changed) {
+    const int width = render_get_width(&ctx->render_ctx);
+
+#if DISPLAY_MODE == DISPLAY_MODE_HW_SCROLL || DISPLAY_MODE == DISPLAY_MODE_SWEEP
+    /*
+     * Advance the cursor past the new columns, and redraw them. With more than
+     * one sample per column, or with columns started by time, the column before
+     * them (the newest one of the previous frame) might have been updated too.
+     * The whole chart is redrawn if its scale changed.
+     *
+     * When sweeping, the gap moves forward with the cursor: the new columns
+     * overwrite its start, which was blank, and as many columns past its end,
+     * which contained the oldest samples, are cleared. The rest of the gap is
+     * still blank, so it's not redrawn.
+     */
+    const int num_updated =
+      (SAMPLES_PER_COLUMN > 1 || COLUMN_PERIOD_US > 0) ? 1 : 0;
+    const int old_cursor  = ctx->cursor;
+    ctx->cursor           = (old_cursor + num_new) % width;
+    if (scale_changed || num_updated + num_new + SWEEP_GAP >= width) {
+        redraw_columns(ctx, 0, width);
+    } else {
+        redraw_columns(ctx,
+                       (old_cursor - num_updated + width) % width,
+                       num_updated + num_new);
+        if (SWEEP_GAP > 0)
+            redraw_columns(ctx, (old_cursor + SWEEP_GAP) % width, num_new);
+    }
+
+    /*
+     * Only the redrawn columns are transferred. The next frame can be computed
+     * in the meantime.
+     */
+    render_flush_async(&ctx->render_ctx);
+
+#if DISPLAY_MODE == DISPLAY_MODE_HW_SCROLL
+    /*
+     * The column under the cursor is the one displayed on the left edge of the
+     * screen, so advancing the scrolling offset turns the new columns into the
+     * right edge.
+     */
+    render_scroll(&ctx->render_ctx, ctx->cursor);
+#endif
+#else
+    /*
+     * Redraw chart to framebuffer and flush to display. The next frame can be
+     * computed while it's being transferred, since the drawing functions will
+     * wait for the transfer before modifying the framebuffer.
+     */
+    const int height = render_get_height(&ctx->render_ctx);
+    render_area(&ctx->render_ctx, 0, 0, width, height, draw_chart, ctx);
+    render_flush_async(&ctx->render_ctx);
+#endif
+}
+
+static int compare_frame_times(const void* a, const void* b) {
+    const int64_t time_a = *(const int64_t*)a;
+    const int64_t time_b = *(const int64_t*)b;
+    return (time_a > time_b) - (time_a < time_b);
+}
+
+/*
+ * Accumulate the time spent on a frame by the render task, and report the
+ * percentiles of the last 'FRAME_TIME_WINDOW' frames once enough of them have
+ * been accumulated.
+ */
+static void report_frame_time(AppCtx* ctx, int64_t frame_time_us) {
+    ctx->frame_times_us[ctx->num_frame_times++] = frame_time_us;
+    if (ctx->num_frame_times < FRAME_TIME_WINDOW)
+        return;
+    ctx->num_frame_times = 0;
+
+    qsort(ctx->frame_times_us,
+          FRAME_TIME_WINDOW,
+          sizeof(ctx->frame_times_us[0]),
+          compare_frame_times);
+    printf("Frame time: p50=%" PRId64 "us p90=%" PRId64 "us p99=%" PRId64
+           "us max=%" PRId64 "us (last flush: %zu bytes, %d transfers, "
+           "%zu pixels cleared)\n",
+           ctx->frame_times_us[FRAME_TIME_WINDOW * 50 / 100],
+           ctx->frame_times_us[FRAME_TIME_WINDOW * 90 / 100],
+           ctx->frame_times_us[FRAME_TIME_WINDOW * 99 / 100],
+           ctx->frame_times_us[FRAME_TIME_WINDOW - 1],
+           ctx->render_ctx.last_flush_bytes,
+           ctx->render_ctx.last_flush_transfers,
+           ctx->render_ctx.last_flush_cleared_pixels);
+}
+
+/*
+ * Render task. Waits for queued samples, pushes all of them to the chart in
+ * batches, and then updates the display once. The samples of the next frame
+ * are pushed while the previous frame is still being transferred.
+ */
+static void render_task(void* param) {
+    AppCtx* ctx = param;
+    Sample batch[RENDER_BATCH_SIZE];
+
+    for (;;) {
+        /* Sleep until the ingestion task has queued at least one sample */
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        const int64_t start_us = esp_timer_get_time();
+
+        size_t total_popped = 0;
+        int num_new_columns = 0;
+        size_t num_popped;
+        while ((num_popped = sample_queue_pop(&ctx->sample_queue,
+                                              batch,
+                                              LENGTH(batch))) > 0) {
+            /* Push the received values to the chart context */
+            for (size_t i = 0; i < num_popped; i++)
+                num_new_columns += chart_push(&ctx->chart_ctx,
+                                              batch[i].timestamp_us,
+                                              batch[i].values,
+                                              CHANNEL_NUM);
+            total_popped += num_popped;
+        }
+
+        if (total_popped == 0)
+            continue;
 
         /* Update auto-scaling of the chart */
-        chart_update_minmax(&chart_ctx);
+        const bool scale_changed = chart_update_minmax(&ctx->chart_ctx);
+
+        update_display(ctx, num_new_columns, scale_changed);
 
-        /* Redraw chart to framebuffer and flush to display */
-        render_clear(&render_ctx);
-        chart_render(&chart_ctx, &render_ctx);
-        render_flush(&render_ctx);
+        /*
+         * The frame time includes waiting for the transfers of the previous
+         * frame, but not for the ones that were just queued.
+         */
+        report_frame_time(ctx, esp_timer_get_time() - start_us);
     }
+}
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * ESP-IDF application entry point.
+ *
+ * Initializes the display, and starts the ingestion and render tasks, which
+ * read samples from the selected input source and plot them as a scrolling
+ * multi-channel line chart.
+ */
+void app_main(void) {
+    /*
+     * The context must outlive this function, since it returns after creating
+     * the tasks.
+     */
+    static AppCtx ctx;
+
+    /* Initialize rendering */
+    render_init(&ctx.render_ctx, LCD_WIDTH, LCD_HEIGHT, RENDER_BUFFERING);
+    render_area(&ctx.render_ctx, 0, 0, LCD_WIDTH, LCD_HEIGHT, draw_blank, NULL);
+    render_flush(&ctx.render_ctx);
+
+    /* Initialize chart context, which will contain the data being plotted */
+    chart_init(&ctx.chart_ctx,
+               CHANNEL_NUM,
+               render_get_width(&ctx.render_ctx),
+               render_get_height(&ctx.render_ctx),
+               SCALE_SHRINK_DWELL,
+               SAMPLES_PER_COLUMN,
+               input_get_formats());
+    chart_set_axes(&ctx.chart_ctx, channel_axes);
+#if COLUMN_PERIOD_US > 0
+    chart_set_column_period(&ctx.chart_ctx, COLUMN_PERIOD_US);
+#endif
+
+    /* Allocate the histories, and report their memory usage */
+#if HISTORY_NUM_TIERS > 0
+    size_t tier_budgets[HISTORY_NUM_TIERS];
+    for (int i = 0; i < HISTORY_NUM_TIERS; i++)
+        tier_budgets[i] = HISTORY_TIER_BUDGET;
+    chart_init_tiers(&ctx.chart_ctx, tier_budgets, HISTORY_NUM_TIERS);
+
+    size_t history_bytes = 0;
+    for (int i = 0; i < HISTORY_NUM_TIERS; i++) {
+        const ChartTier* tier = &ctx.chart_ctx.tiers[i];
+        printf("History tier %d: %dx, %d buckets, %zu bytes\n",
+               i,
+               tier->samples_per_bucket,
+               tier->size,
+               tier->num_bytes);
+        history_bytes += tier->num_bytes;
+    }
+    printf("History tiers: %zu bytes in total\n", history_bytes);
+#endif
 
-    chart_destroy(&chart_ctx);
-    render_destroy(&render_ctx);
+#if HISTORY_LOG_BYTES > 0
+    chart_init_log(&ctx.chart_ctx, HISTORY_LOG_BYTES);
+    printf("History log: %d blocks, %zu bytes\n",
+           ctx.chart_ctx.log.num_blocks,
+           sample_log_get_num_bytes(&ctx.chart_ctx.log));
+#endif
+    chart_set_colors(&ctx.render_ctx, 1.0f);
+
+    /* Initialize the queue used for passing samples between tasks */
+    sample_queue_init(&ctx.sample_queue, SAMPLE_QUEUE_CAPACITY);
+
+    /* Report what is left for the tasks, and for larger histories */
+    printf("Free heap after initialization: %zu bytes (largest block: %zu)\n",
+           heap_caps_get_free_size(MALLOC_CAP_DEFAULT),
+           heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT));
+
+    /*
+     * Create the render task first, since the ingestion task needs its handle
+     * for notifying it.
+     */
+    xTaskCreatePinnedToCore(render_task,
+                            "render",
+                            RENDER_TASK_STACK_SIZE,
+                            &ctx,
+                            RENDER_TASK_PRIORITY,
+                            &ctx.render_task,
+                            RENDER_TASK_CORE);
+    xTaskCreatePinnedToCore(ingest_task,
+                            "ingest",
+                            INGEST_TASK_STACK_SIZE,
+                            &ctx,
+                            INGEST_TASK_PRIORITY,
+                            NULL,
+                            INGEST_TASK_CORE);
 }
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "pid_scheduler.h"
+#include <assert.h>
+#include <stdint.h> /* INT64_MAX */
+
+#include "util.h"
+
+/*
+ * Weight of each new round-trip measurement in the moving average, as the
+ * inverse of a power of two (1/4). The difference is divided instead of
+ * shifted, since it's negative when the latency drops, and shifting would
+ * round it down, making the average drift low.
+ */
+#define RTT_AVERAGE_SHIFT 2
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Calculate the scheduling score of a channel at the specified time. The score
+ * is the channel priority, plus the number of periods it's overdue.
+ */
+static float channel_score(const PidSchedulerChannel* channel, int64_t now_us) {
+    const float overdue_periods =
+      (float)(now_us - channel->next_due_us) / channel->period_us;
+    return channel->config.priority + MAX(overdue_periods, 0.f);
+}
+
+/*----------------------------------------------------------------------------*/
+
+void pid_scheduler_init(PidScheduler* sched,
+                        const PidSchedulerConfig* configs,
+                        int num_channels,
+                        int64_t now_us) {
+    assert(num_channels > 0 && num_channels <= PID_SCHEDULER_MAX_CHANNELS);
+
+    sched->num_channels    = num_channels;
+    sched->rtt_us          = 0;
+    sched->window_start_us = now_us;
+
+    for (int i = 0; i < num_channels; i++) {
+        assert(configs[i].target_hz > 0.f);
+
+        PidSchedulerChannel* channel = &sched->channels[i];
+        channel->config              = configs[i];
+        channel->period_us           = 1000000.f / configs[i].target_hz;
+        channel->next_due_us         = now_us;
+        channel->num_received        = 0;
+        channel->achieved_hz         = 0.f;
+    }
+}
+
+int pid_scheduler_next_batch(PidScheduler* sched,
+                             int64_t now_us,
+                             int* dst,
+                             int max_channels) {
+    /*
+     * Any channel that will be due before the next request could complete is
+     * a candidate for this one, since it couldn't be polled any sooner.
+     */
+    const int64_t horizon_us = now_us + sched->rtt_us;
+
+    int candidates[PID_SCHEDULER_MAX_CHANNELS];
+    float scores[PID_SCHEDULER_MAX_CHANNELS];
+    int num_candidates = 0;
+
+    for (int i = 0; i < sched->num_channels; i++) {
+        if (sched->channels[i].next_due_us > horizon_us)
+            continue;
+        candidates[num_candidates] = i;
+        scores[num_candidates]     = channel_score(&sched->channels[i], now_us);
+        num_candidates++;
+    }
+
+    /*
+     * Select the candidates with the highest scores. There are very few
+     * channels, so a partial selection sort is good enough.
+     */
+    const int num_selected = MIN(num_candidates, max_channels);
+    for (int i = 0; i < num_selected; i++) {
+        int best = i;
+        for (int j = i + 1; j < num_candidates; j++)
+            if (scores[j] > scores[best])
+                best = j;
+
+        const int tmp_candidate = candidates[i];
+        const float tmp_score   = scores[i];
+        candidates[i]           = candidates[best];
+        scores[i]               = scores[best];
+        candidates[best]        = tmp_candidate;
+        scores[best]            = tmp_score;
+
+        dst[i] = candidates[i];
+    }
+
+    return num_selected;
+}
+
+bool pid_scheduler_complete(PidScheduler* sched,
+                            const int* channels,
+                            const bool* received,
+                            int num_channels,
+                            int64_t start_us,
+                            int64_t end_us) {
+    /* Update the moving average of the round-trip time */
+    const int64_t rtt_us = end_us - start_us;
+    if (sched->rtt_us == 0)
+        sched->rtt_us = rtt_us;
+    else
+        sched->rtt_us += (rtt_us - sched->rtt_us) / (1 << RTT_AVERAGE_SHIFT);
+
+    for (int i = 0; i < num_channels; i++) {
+        PidSchedulerChannel* channel = &sched->channels[channels[i]];
+        if (received[i])
+            channel->num_received++;
+
+        /*
+         * Advance the due time by one period, keeping the phase of the
+         * channel. If it fell behind, don't try to catch up with all the
+         * missed periods.
+         */
+        channel->next_due_us += channel->period_us;
+        if (channel->next_due_us < end_us)
+            channel->next_due_us = end_us;
+    }
+
+    /* Update the achieved rates if the current window is complete */
+    const int64_t window_us = end_us - sched->window_start_us;
+    if (window_us < PID_SCHEDULER_RATE_WINDOW_US)
+        return false;
+
+    for (int i = 0; i < sched->num_channels; i++) {
+        PidSchedulerChannel* channel = &sched->channels[i];
+        channel->achieved_hz  = channel->num_received * 1000000.f / window_us;
+        channel->num_received = 0;
+    }
+    sched->window_start_us = end_us;
+    return true;
+}
+
+int64_t pid_scheduler_time_until_due(const PidScheduler* sched,
+                                     int64_t now_us) {
+    int64_t min_wait_us = INT64_MAX;
+
+    for (int i = 0; i < sched->num_channels; i++) {
+        const int64_t wait_us = sched->channels[i].next_due_us - now_us;
+        if (wait_us < min_wait_us)
+            min_wait_us = wait_us;
+    }
+
+    return MAX(min_wait_us, 0);
+}
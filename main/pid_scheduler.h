@@ -0,0 +1,145 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PID_SCHEDULER_H_
+#define PID_SCHEDULER_H_ 1
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Maximum number of channels that can be scheduled.
+ */
+#define PID_SCHEDULER_MAX_CHANNELS 8
+
+/*
+ * Time window used for measuring the achieved rate of each channel, in
+ * microseconds.
+ */
+#define PID_SCHEDULER_RATE_WINDOW_US 5000000
+
+/*
+ * Configuration of a scheduled channel.
+ */
+typedef struct PidSchedulerConfig {
+    /* Mode 01 PID polled in this channel */
+    uint8_t pid;
+
+    /* Desired polling rate, in Hz */
+    float target_hz;
+
+    /*
+     * Priority of the channel. When not all due channels fit in a request,
+     * channels with higher priority are polled first.
+     */
+    int priority;
+} PidSchedulerConfig;
+
+/*
+ * State of a scheduled channel.
+ */
+typedef struct PidSchedulerChannel {
+    PidSchedulerConfig config;
+
+    /* Polling period, derived from the target rate */
+    int64_t period_us;
+
+    /* Time when the channel should be polled next */
+    int64_t next_due_us;
+
+    /* Number of values received in the current rate window */
+    unsigned num_received;
+
+    /* Rate achieved in the last complete rate window, in Hz */
+    float achieved_hz;
+} PidSchedulerChannel;
+
+/*
+ * Structure representing the context of a PID scheduler, which decides which
+ * channels should be polled in each request.
+ */
+typedef struct PidScheduler {
+    PidSchedulerChannel channels[PID_SCHEDULER_MAX_CHANNELS];
+    int num_channels;
+
+    /*
+     * Exponential moving average of the round-trip time of each request, or
+     * zero if no request has completed yet.
+     */
+    int64_t rtt_us;
+
+    /* Start of the current rate window */
+    int64_t window_start_us;
+} PidScheduler;
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Initialize the specified scheduler with 'num_channels' channels, using the
+ * specified configurations. All channels are initially due at 'now_us'.
+ */
+void pid_scheduler_init(PidScheduler* sched,
+                        const PidSchedulerConfig* configs,
+                        int num_channels,
+                        int64_t now_us);
+
+/*
+ * Select the channels that should be polled in the next request, and write up
+ * to 'max_channels' of their indexes to 'dst'. Returns the number of selected
+ * channels, which might be zero if no channel is due yet.
+ *
+ * Channels that will be due before the next request could complete (according
+ * to the measured round-trip time) are also selected, so they share a request
+ * with the ones that are already due. If there are more candidates than
+ * 'max_channels', they are sorted by their priority, increased by how many
+ * periods they are overdue so low-priority channels are never starved.
+ *
+ * This look-ahead horizon is the only adaptation to the round-trip time: a
+ * slower adapter makes more channels share each request, but the size of the
+ * requests is always limited by 'max_channels' alone.
+ */
+int pid_scheduler_next_batch(PidScheduler* sched,
+                             int64_t now_us,
+                             int* dst,
+                             int max_channels);
+
+/*
+ * Notify the scheduler that the request for the specified channels, returned
+ * by 'pid_scheduler_next_batch', was sent at 'start_us' and completed at
+ * 'end_us'. The 'received' array indicates whether the value of each channel
+ * was present in the response.
+ *
+ * Returns true if a rate window was completed, and therefore the achieved
+ * rates were updated.
+ */
+bool pid_scheduler_complete(PidScheduler* sched,
+                            const int* channels,
+                            const bool* received,
+                            int num_channels,
+                            int64_t start_us,
+                            int64_t end_us);
+
+/*
+ * Return the time until the next channel is due, in microseconds, or zero if
+ * a channel is already due.
+ */
+int64_t pid_scheduler_time_until_due(const PidScheduler* sched,
+                                     int64_t now_us);
+
+#endif /* PID_SCHEDULER_H_ */
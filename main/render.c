@@ -31,6 +31,8 @@
 #include "esp_lcd_ili9341.h"
 #include "esp_heap_caps.h" /* MALLOC_CAP_DMA, MALLOC_CAP_8BIT */
 
+#include "util.h"
+
 /*
  * Clamp the specified number N to a minimum and maximum value.
  */
@@ -50,6 +52,39 @@
 #define LCD_RST       -1        /* Reset pin (not used, -1 = disabled) */
 #define LCD_BL        21        /* Backlight control pin */
 
+/*
+ * ILI9341 commands for hardware scrolling, which are not exposed by the
+ * 'esp_lcd' driver.
+ */
+#define LCD_CMD_VSCRDEF  0x33 /* Vertical Scrolling Definition */
+#define LCD_CMD_VSCRSADD 0x37 /* Vertical Scrolling Start Address */
+
+/*
+ * The hardware scrolling of the ILI9341 works on the rows of its frame memory,
+ * which correspond to the horizontal axis of the display because of the
+ * 'esp_lcd_panel_swap_xy' call in 'render_init'. Because of the mirroring in
+ * that same function, the horizontal coordinates are reversed with respect to
+ * the memory rows. This must be changed if the mirroring is changed.
+ */
+#define LCD_SCROLL_REVERSED 1
+
+/*
+ * Percentage of the screen that must be dirty for 'render_flush' to transfer
+ * the whole framebuffer at once, instead of each dirty rectangle.
+ */
+#define FULL_FLUSH_PERCENT 50
+
+/*
+ * Number of full-width rows that fit in each staging buffer, and in the stripe
+ * buffer when rendering in stripes. Narrower areas are transferred or rendered
+ * in taller chunks of the same size.
+ */
+#define STAGING_HEIGHT 12
+
+#if configTASK_NOTIFICATION_ARRAY_ENTRIES <= RENDER_NOTIFY_INDEX
+#error "Not enough task notifications, see 'sdkconfig.defaults'"
+#endif
+
 /*----------------------------------------------------------------------------*/
 
 /*
@@ -76,86 +111,258 @@ static inline uint16_t rgb888_to_rgb565(uint32_t rgb888) {
  * This function is specified when creating the 'esp_lcd_panel_io_spi_config_t'
  * structure in 'render_init'.
  *
- * The callback only signals the semaphore if there are no pending asynchronous
- * transfers.
+ * Since transfers are completed in order, the callback just increases the
+ * number of completed transfers, and notifies the waiting task if its fence is
+ * done.
  */
 static bool on_lcd_transfer_done(esp_lcd_panel_io_handle_t panel_io,
                                  esp_lcd_panel_io_event_data_t* edata,
                                  void* user_ctx) {
     RenderCtx* ctx = user_ctx;
 
-    if (ctx->pending_async_transfers > 0) {
-        ctx->pending_async_transfers--;
+    atomic_fetch_add(&ctx->completed_fence, 1);
+
+    TaskHandle_t task = atomic_load(&ctx->waiting_task);
+    if (task == NULL ||
+        !render_fence_done(ctx, atomic_load(&ctx->waiting_fence)))
         return false;
-    }
 
     BaseType_t high_task_woken = pdFALSE;
-    xSemaphoreGiveFromISR(ctx->flush_done_semaphore, &high_task_woken);
+    vTaskNotifyGiveIndexedFromISR(task, RENDER_NOTIFY_INDEX, &high_task_woken);
     return high_task_woken == pdTRUE;
 }
 
 /*
  * Asynchronous wrapper for 'esp_lcd_panel_draw_bitmap'.
  *
- * Queues a DMA transfer and returns immediately. Does NOT signal the semaphore
- * on completion. The caller must ensure the data buffer remains valid until
- * the transfer completes.
+ * Queues a DMA transfer and returns its fence immediately. The caller must
+ * ensure the data buffer remains valid until the fence is done.
  */
-static void draw_bitmap_asynchronously(RenderCtx* ctx,
-                                       int x0,
-                                       int y0,
-                                       int x1,
-                                       int y1,
-                                       const void* data) {
-    /*
-     * Increment counter so callback knows to signal semaphore.
-     * Must happen BEFORE starting the transfer.
-     */
-    ctx->pending_async_transfers++;
-
-    /* Transfer counter stays at 0 - callback won't signal semaphore */
+static RenderFence draw_bitmap_asynchronously(RenderCtx* ctx,
+                                              int x0,
+                                              int y0,
+                                              int x1,
+                                              int y1,
+                                              const void* data) {
     esp_lcd_panel_draw_bitmap(ctx->lcd_panel, x0, y0, x1, y1, data);
+
+    ctx->queued_bytes += (x1 - x0) * (y1 - y0) * sizeof(uint16_t);
+    ctx->queued_transfers++;
+
+    return ++ctx->last_fence;
 }
 
 /*
- * Synchronous wrapper for 'esp_lcd_panel_draw_bitmap', which waits for
- * 'flush_done_semaphore' to be increased (signaled) from the
- * 'on_lcd_transfer_done' callback.
+ * Return a pointer to the pixel of the render target at the specified screen
+ * coordinates, which must be inside 'target_rect'.
  */
-static void draw_bitmap_synchronously(const RenderCtx* ctx,
-                                      int x0,
-                                      int y0,
-                                      int x1,
-                                      int y1,
-                                      const void* data) {
-    if (ctx->pending_async_transfers > 0) {
-        fprintf(stderr,
-                "Tried to make a synchronous draw, while another %d "
-                "asynchronous transfers were pending. Waiting for them to "
-                "finish...\n",
-                ctx->pending_async_transfers);
-        while (ctx->pending_async_transfers > 0)
-            vTaskDelay(10);
+static inline uint8_t* target_pixel(const RenderCtx* ctx, int x, int y) {
+    const RenderRect* rect = &ctx->target_rect;
+    return &ctx->target[(rect->x1 - rect->x0) * (y - rect->y0) +
+                        (x - rect->x0)];
+}
+
+static inline int rect_area(const RenderRect* rect) {
+    return (rect->x1 - rect->x0) * (rect->y1 - rect->y0);
+}
+
+static inline bool rect_is_empty(const RenderRect* rect) {
+    return rect->x0 >= rect->x1 || rect->y0 >= rect->y1;
+}
+
+static inline bool rect_equal(const RenderRect* a, const RenderRect* b) {
+    return a->x0 == b->x0 && a->y0 == b->y0 && a->x1 == b->x1 &&
+           a->y1 == b->y1;
+}
+
+static inline RenderRect rect_intersection(const RenderRect* a,
+                                           const RenderRect* b) {
+    const RenderRect result = {
+        .x0 = MAX(a->x0, b->x0),
+        .y0 = MAX(a->y0, b->y0),
+        .x1 = MIN(a->x1, b->x1),
+        .y1 = MIN(a->y1, b->y1),
+    };
+    return result;
+}
+
+static inline RenderRect rect_union(const RenderRect* a, const RenderRect* b) {
+    const RenderRect result = {
+        .x0 = MIN(a->x0, b->x0),
+        .y0 = MIN(a->y0, b->y0),
+        .x1 = MAX(a->x1, b->x1),
+        .y1 = MAX(a->y1, b->y1),
+    };
+    return result;
+}
+
+/*
+ * Mark the area from (x0, y0) to (x1, y1), exclusive, as modified since the
+ * last flush. The coordinates are clipped to the screen bounds.
+ *
+ * The new area is merged with the dirty rectangle whose area would grow the
+ * least. The merge is only done if it doesn't add any clean pixels (e.g. the
+ * rectangles overlap, or they are adjacent and aligned), or if there is no
+ * space for another rectangle.
+ *
+ * When rendering in stripes, each stripe is transferred as soon as it's drawn,
+ * so this function does nothing.
+ */
+static void mark_dirty(RenderCtx* ctx, int x0, int y0, int x1, int y1) {
+    if (ctx->framebuffer == NULL)
+        return;
+
+    const RenderRect area = {
+        .x0 = CLAMP(x0, 0, ctx->width),
+        .y0 = CLAMP(y0, 0, ctx->height),
+        .x1 = CLAMP(x1, 0, ctx->width),
+        .y1 = CLAMP(y1, 0, ctx->height),
+    };
+    if (rect_is_empty(&area))
+        return;
+
+    int best_rect = -1;
+    int best_cost = 0;
+    for (int i = 0; i < ctx->num_dirty_rects; i++) {
+        const RenderRect merged = rect_union(&ctx->dirty_rects[i], &area);
+        const int cost =
+          rect_area(&merged) - rect_area(&ctx->dirty_rects[i]) -
+          rect_area(&area);
+        if (best_rect < 0 || cost < best_cost) {
+            best_rect = i;
+            best_cost = cost;
+        }
     }
 
-    /* Start the asynchronous DMA transfer from the data buffer to the LCD */
-    esp_lcd_panel_draw_bitmap(ctx->lcd_panel, x0, y0, x1, y1, data);
+    if (best_rect >= 0 &&
+        (best_cost <= 0 || ctx->num_dirty_rects >= RENDER_MAX_DIRTY_RECTS)) {
+        ctx->dirty_rects[best_rect] =
+          rect_union(&ctx->dirty_rects[best_rect], &area);
+        return;
+    }
+
+    ctx->dirty_rects[ctx->num_dirty_rects++] = area;
+}
+
+/*
+ * Remember a span drawn at column 'x', from row 'y0' to 'y1', exclusive, so it
+ * can be erased by 'render_erase'.
+ */
+static inline void remember_span(RenderCtx* ctx, int x, int y0, int y1) {
+    if (ctx->spans == NULL)
+        return;
+
+    if (ctx->num_spans >= RENDER_MAX_SPANS) {
+        ctx->spans_overflowed = true;
+        return;
+    }
+
+    ctx->spans[ctx->num_spans++] = (RenderSpan){
+        .x  = x,
+        .y0 = y0,
+        .y1 = y1,
+    };
+}
+
+/*
+ * Convert the specified area of the render target to RGB565 through the
+ * palette, into the next staging buffer, and queue its transfer. The area must
+ * fit in a staging buffer.
+ */
+static void queue_target_area(RenderCtx* ctx, const RenderRect* area) {
+    const int buffer = ctx->next_staging_buffer;
+    ctx->next_staging_buffer =
+      (ctx->next_staging_buffer + 1) % LENGTH(ctx->staging_buffers);
+
+    /* The previous transfer from the buffer might still be in progress */
+    render_wait(ctx, ctx->staging_fences[buffer]);
+
+    uint16_t* dst        = ctx->staging_buffers[buffer];
+    const int area_width = area->x1 - area->x0;
+    for (int y = area->y0; y < area->y1; y++) {
+        const uint8_t* src = target_pixel(ctx, area->x0, y);
+        for (int x = 0; x < area_width; x++)
+            *dst++ = ctx->palette[src[x]];
+    }
+
+    ctx->staging_fences[buffer] =
+      draw_bitmap_asynchronously(ctx,
+                                 area->x0,
+                                 area->y0,
+                                 area->x1,
+                                 area->y1,
+                                 ctx->staging_buffers[buffer]);
+}
+
+/*
+ * Queue the transfers of the dirty rectangles of the framebuffer, resetting
+ * them. See 'render_flush_async'.
+ */
+static void queue_dirty_rects(RenderCtx* ctx) {
+    /*
+     * If a large part of the screen is dirty, transferring the whole
+     * framebuffer is cheaper than many smaller areas.
+     */
+    int dirty_area = 0;
+    for (int i = 0; i < ctx->num_dirty_rects; i++)
+        dirty_area += rect_area(&ctx->dirty_rects[i]);
+    if (dirty_area >= ctx->width * ctx->height * FULL_FLUSH_PERCENT / 100) {
+        ctx->num_dirty_rects = 0;
+        mark_dirty(ctx, 0, 0, ctx->width, ctx->height);
+    }
 
     /*
-     * Wait for the counter of the binary semaphore to increase. This counter
-     * will be increased from the 'on_lcd_transfer_done' callback.
+     * Queue the transfers of each dirty rectangle, in chunks of rows that fit
+     * in a staging buffer.
      */
-    xSemaphoreTake(ctx->flush_done_semaphore, portMAX_DELAY);
+    const int staging_capacity = ctx->width * STAGING_HEIGHT;
+    for (int i = 0; i < ctx->num_dirty_rects; i++) {
+        const RenderRect* rect = &ctx->dirty_rects[i];
+        const int chunk_height = staging_capacity / (rect->x1 - rect->x0);
+
+        for (int y = rect->y0; y < rect->y1; y += chunk_height) {
+            const RenderRect chunk = {
+                .x0 = rect->x0,
+                .y0 = y,
+                .x1 = rect->x1,
+                .y1 = MIN(y + chunk_height, rect->y1),
+            };
+            queue_target_area(ctx, &chunk);
+        }
+    }
+
+    ctx->num_dirty_rects = 0;
 }
 
 /*----------------------------------------------------------------------------*/
 
-void render_init(RenderCtx* ctx, size_t width, size_t height) {
-    ctx->width                   = width;
-    ctx->height                  = height;
-    ctx->lcd_panel               = NULL;
-    ctx->flush_done_semaphore    = xSemaphoreCreateBinary();
-    ctx->pending_async_transfers = 0;
+void render_init(RenderCtx* ctx,
+                 size_t width,
+                 size_t height,
+                 RenderBuffering buffering) {
+    ctx->width                     = width;
+    ctx->height                    = height;
+    ctx->lcd_io                    = NULL;
+    ctx->lcd_panel                 = NULL;
+    ctx->framebuffer               = NULL;
+    ctx->stripe                    = NULL;
+    ctx->staging_fences[0]         = 0;
+    ctx->staging_fences[1]         = 0;
+    ctx->next_staging_buffer       = 0;
+    ctx->last_fence                = 0;
+    ctx->num_dirty_rects           = 0;
+    ctx->queued_bytes              = 0;
+    ctx->queued_transfers          = 0;
+    ctx->last_flush_bytes          = 0;
+    ctx->last_flush_transfers      = 0;
+    ctx->spans                     = NULL;
+    ctx->num_spans                 = 0;
+    ctx->spans_overflowed          = true;
+    ctx->cleared_pixels            = 0;
+    ctx->last_flush_cleared_pixels = 0;
+    atomic_init(&ctx->completed_fence, 0);
+    atomic_init(&ctx->waiting_task, NULL);
+    atomic_init(&ctx->waiting_fence, 0);
 
     /*
      * Configure the backlight GPIO pin as output and turn it on.
@@ -174,7 +381,7 @@ void render_init(RenderCtx* ctx, size_t width, size_t height) {
         .sclk_io_num     = LCD_SCLK,
         .quadwp_io_num   = -1,
         .quadhd_io_num   = -1,
-        .max_transfer_sz = ctx->width * ctx->height * sizeof(uint16_t),
+        .max_transfer_sz = ctx->width * STAGING_HEIGHT * sizeof(uint16_t),
     };
     ESP_ERROR_CHECK(spi_bus_initialize(LCD_HOST, &buscfg, SPI_DMA_CH_AUTO));
 
@@ -227,17 +434,70 @@ void render_init(RenderCtx* ctx, size_t width, size_t height) {
     /* Turn on the display (enables output to the LCD panel) */
     ESP_ERROR_CHECK(esp_lcd_panel_disp_on_off(panel_handle, true));
 
+    /*
+     * Define the whole frame memory as the hardware scrolling area, without
+     * fixed areas. See 'render_scroll'.
+     */
+    const uint8_t scroll_definition[] = {
+        0x00, 0x00,                                     /* Top fixed area */
+        (ctx->width >> 8) & 0xFF, ctx->width & 0xFF,    /* Scrolling area */
+        0x00, 0x00,                                     /* Bottom fixed area */
+    };
+    ESP_ERROR_CHECK(esp_lcd_panel_io_tx_param(io_handle,
+                                              LCD_CMD_VSCRDEF,
+                                              scroll_definition,
+                                              sizeof(scroll_definition)));
+
+    ctx->lcd_io    = io_handle;
     ctx->lcd_panel = panel_handle;
 
+    /* All colors are black until they are set */
+    memset(ctx->palette, 0x00, sizeof(ctx->palette));
+
     /*
-     * Allocate framebuffer for off-screen rendering in DMA-capable memory.
-     * This allows all drawing operations to occur in RAM, then the entire
-     * frame can be transferred to the LCD in a single DMA transaction.
+     * Allocate the staging buffers in DMA-capable memory, since they are
+     * transferred to the LCD.
      */
-    const size_t fb_size = ctx->width * ctx->height * sizeof(uint16_t);
-    ctx->framebuffer =
-      heap_caps_malloc(fb_size, MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
+    const size_t staging_size = ctx->width * STAGING_HEIGHT * sizeof(uint16_t);
+    for (size_t i = 0; i < LENGTH(ctx->staging_buffers); i++) {
+        ctx->staging_buffers[i] =
+          heap_caps_malloc(staging_size, MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
+        if (ctx->staging_buffers[i] == NULL) {
+            fprintf(stderr,
+                    "Failed to allocate staging buffer (%zu bytes)\n",
+                    staging_size);
+            abort();
+        }
+    }
+
+    if (buffering == RENDER_STRIPES) {
+        /*
+         * Allocate the stripe buffer. The drawing functions don't have a
+         * target until 'render_area' is called.
+         */
+        const size_t stripe_size = ctx->width * STAGING_HEIGHT;
+        ctx->stripe              = malloc(stripe_size);
+        if (ctx->stripe == NULL) {
+            fprintf(stderr,
+                    "Failed to allocate stripe buffer (%zu bytes)\n",
+                    stripe_size);
+            abort();
+        }
+
+        ctx->target      = NULL;
+        ctx->target_rect = (RenderRect){ 0, 0, 0, 0 };
+        ctx->clip_rect   = ctx->target_rect;
+        return;
+    }
 
+    /*
+     * Allocate framebuffer for off-screen rendering. This allows all drawing
+     * operations to occur in RAM, and then the modified areas can be converted
+     * and transferred to the LCD. It doesn't need to be DMA-capable, since
+     * only the staging buffers are transferred.
+     */
+    const size_t fb_size = ctx->width * ctx->height;
+    ctx->framebuffer     = malloc(fb_size);
     if (ctx->framebuffer == NULL) {
         fprintf(stderr,
                 "Failed to allocate %zux%zu framebuffer (%zu bytes)\n",
@@ -247,8 +507,36 @@ void render_init(RenderCtx* ctx, size_t width, size_t height) {
         abort();
     }
 
-    /* Initialize framebuffer to black */
-    memset(ctx->framebuffer, 0x00, fb_size);
+    /* Initialize framebuffer to the background color */
+    memset(ctx->framebuffer, RENDER_COLOR_BACKGROUND, fb_size);
+
+    /* The drawing functions write to the whole framebuffer */
+    ctx->target      = ctx->framebuffer;
+    ctx->target_rect = (RenderRect){ 0, 0, ctx->width, ctx->height };
+    ctx->clip_rect   = ctx->target_rect;
+
+    /*
+     * Allocate the array of drawn spans, used for erasing them from the
+     * framebuffer. The first erase falls back to a clear, since nothing was
+     * tracked yet.
+     */
+    ctx->spans = malloc(RENDER_MAX_SPANS * sizeof(RenderSpan));
+    if (ctx->spans == NULL) {
+        fprintf(stderr,
+                "Failed to allocate span array (%zu bytes)\n",
+                RENDER_MAX_SPANS * sizeof(RenderSpan));
+        abort();
+    }
+}
+
+void render_set_palette_color(RenderCtx* ctx,
+                              uint8_t index,
+                              uint32_t rgb888) {
+    ctx->palette[index] = rgb888_to_rgb565(rgb888);
+
+    /* The pixels with this color might be anywhere in the framebuffer */
+    ctx->num_dirty_rects = 0;
+    mark_dirty(ctx, 0, 0, ctx->width, ctx->height);
 }
 
 void render_destroy(RenderCtx* ctx) {
@@ -257,29 +545,116 @@ void render_destroy(RenderCtx* ctx) {
         ctx->framebuffer = NULL;
     }
 
+    if (ctx->stripe != NULL) {
+        free(ctx->stripe);
+        ctx->stripe = NULL;
+    }
+
+    if (ctx->spans != NULL) {
+        free(ctx->spans);
+        ctx->spans = NULL;
+    }
+
+    for (size_t i = 0; i < LENGTH(ctx->staging_buffers); i++) {
+        if (ctx->staging_buffers[i] != NULL) {
+            free(ctx->staging_buffers[i]);
+            ctx->staging_buffers[i] = NULL;
+        }
+    }
+
     /* TODO: Call ESP-IDF functions for freeing LCD and SPI resources */
 }
 
-void render_clear(const RenderCtx* ctx) {
-    /* Clear the framebuffer to black. This is a fast in-memory operation. */
-    memset(ctx->framebuffer, 0x00, ctx->width * ctx->height * sizeof(uint16_t));
+void render_clear(RenderCtx* ctx) {
+    render_clear_area(ctx,
+                      ctx->clip_rect.x0,
+                      ctx->clip_rect.y0,
+                      ctx->clip_rect.x1,
+                      ctx->clip_rect.y1);
+
+    /* Nothing has been drawn since the clear, in this layout */
+    ctx->num_spans        = 0;
+    ctx->spans_overflowed = false;
+    ctx->spans_clip_rect  = ctx->clip_rect;
 }
 
-void render_draw_line(const RenderCtx* ctx,
+void render_erase(RenderCtx* ctx) {
+    if (ctx->spans == NULL || ctx->spans_overflowed ||
+        !rect_equal(&ctx->spans_clip_rect, &ctx->clip_rect)) {
+        render_clear(ctx);
+        return;
+    }
+
+    /*
+     * Overwrite each span with the background color. The erased area is
+     * marked as dirty at once, since it will usually be redrawn.
+     */
+    const int stride = ctx->target_rect.x1 - ctx->target_rect.x0;
+    RenderRect erased = { ctx->width, ctx->height, 0, 0 };
+    for (int i = 0; i < ctx->num_spans; i++) {
+        const RenderSpan* span = &ctx->spans[i];
+
+        uint8_t* pixel = target_pixel(ctx, span->x, span->y0);
+        for (int y = span->y0; y < span->y1; y++, pixel += stride)
+            *pixel = RENDER_COLOR_BACKGROUND;
+
+        erased.x0 = MIN(erased.x0, span->x);
+        erased.y0 = MIN(erased.y0, span->y0);
+        erased.x1 = MAX(erased.x1, span->x + 1);
+        erased.y1 = MAX(erased.y1, span->y1);
+        ctx->cleared_pixels += span->y1 - span->y0;
+    }
+
+    mark_dirty(ctx, erased.x0, erased.y0, erased.x1, erased.y1);
+    ctx->num_spans = 0;
+}
+
+void render_clear_area(RenderCtx* ctx, int x0, int y0, int x1, int y1) {
+    x0 = CLAMP(x0, ctx->clip_rect.x0, ctx->clip_rect.x1);
+    y0 = CLAMP(y0, ctx->clip_rect.y0, ctx->clip_rect.y1);
+    x1 = CLAMP(x1, ctx->clip_rect.x0, ctx->clip_rect.x1);
+    y1 = CLAMP(y1, ctx->clip_rect.y0, ctx->clip_rect.y1);
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    /* Clear the rows of the target. This is a fast in-memory operation. */
+    for (int y = y0; y < y1; y++)
+        memset(target_pixel(ctx, x0, y), RENDER_COLOR_BACKGROUND, x1 - x0);
+    ctx->cleared_pixels += (x1 - x0) * (y1 - y0);
+
+    mark_dirty(ctx, x0, y0, x1, y1);
+}
+
+void render_draw_line(RenderCtx* ctx,
                       int x0,
                       int y0,
                       int x1,
                       int y1,
-                      uint32_t color) {
-    /* Convert RGB888 to RGB565 color, used by the display */
-    const uint16_t rgb565_color = rgb888_to_rgb565(color);
-
+                      uint8_t color) {
     /* Clamp the coordinates, to ensure they are within screen bounds */
     x0 = CLAMP(x0, 0, ctx->width - 1);
     y0 = CLAMP(y0, 0, ctx->height - 1);
     x1 = CLAMP(x1, 0, ctx->width - 1);
     y1 = CLAMP(y1, 0, ctx->height - 1);
 
+    /*
+     * The line is contained in the rectangle between its endpoints. Skip it if
+     * that rectangle is outside of the clipping area.
+     */
+    const RenderRect bounds = {
+        .x0 = MIN(x0, x1),
+        .y0 = MIN(y0, y1),
+        .x1 = MAX(x0, x1) + 1,
+        .y1 = MAX(y0, y1) + 1,
+    };
+    const RenderRect clipped = rect_intersection(&bounds, &ctx->clip_rect);
+    if (rect_is_empty(&clipped))
+        return;
+    mark_dirty(ctx, clipped.x0, clipped.y0, clipped.x1, clipped.y1);
+
+    /* Lines are not tracked as spans, so they can't be erased */
+    ctx->spans_overflowed = true;
+
     /* Calculate absolute differences and step directions */
     const int dx = abs(x1 - x0);       /* Horizontal distance */
     const int dy = abs(y1 - y0);       /* Vertical distance */
@@ -288,8 +663,14 @@ void render_draw_line(const RenderCtx* ctx,
     int err      = dx - dy;            /* Initial error term */
 
     for (;;) {
-        /* Write pixel directly to framebuffer */
-        ctx->framebuffer[ctx->width * y0 + x0] = rgb565_color;
+        /*
+         * Write pixel directly to the target, if it's inside the clipping
+         * area. The line is always traced from the same endpoints, so the
+         * pixels are the same regardless of the clipping area.
+         */
+        if (x0 >= clipped.x0 && x0 < clipped.x1 && y0 >= clipped.y0 &&
+            y0 < clipped.y1)
+            *target_pixel(ctx, x0, y0) = color;
 
         /* Check if we've reached the endpoint */
         if (x0 == x1 && y0 == y1)
@@ -312,12 +693,165 @@ void render_draw_line(const RenderCtx* ctx,
     }
 }
 
-void render_flush(const RenderCtx* ctx) {
-    /* Transfer our framebuffer to the LCD, using our synchronous wrapper */
-    draw_bitmap_synchronously(ctx,
-                              0,
-                              0,
-                              ctx->width,
-                              ctx->height,
-                              ctx->framebuffer);
+void render_draw_trace(RenderCtx* ctx,
+                       int x0,
+                       const int16_t* ys,
+                       int num_points,
+                       uint8_t color) {
+    render_draw_envelope(ctx, x0, ys, ys, num_points, color);
+}
+
+void render_draw_envelope(RenderCtx* ctx,
+                          int x0,
+                          const int16_t* tops,
+                          const int16_t* bottoms,
+                          int num_columns,
+                          uint8_t color) {
+    const RenderRect* clip = &ctx->clip_rect;
+
+    /* Only the columns inside the clipping area are drawn */
+    const int first_column = MAX(1, clip->x0 - x0);
+    const int end_column   = MIN(num_columns, clip->x1 - x0);
+    if (first_column >= end_column)
+        return;
+
+    const int stride = ctx->target_rect.x1 - ctx->target_rect.x0;
+    int dirty_y0     = clip->y1;
+    int dirty_y1     = clip->y0;
+
+    for (int i = first_column; i < end_column; i++) {
+        /*
+         * Extend the range of the column up to the range of the previous one,
+         * and clip the span to the clipping area, which is always inside the
+         * screen bounds.
+         */
+        const int y0 = MAX(MIN(tops[i], bottoms[i - 1]), clip->y0);
+        const int y1 = MIN(MAX(bottoms[i], tops[i - 1]), clip->y1 - 1);
+        if (y0 > y1)
+            continue;
+
+        uint8_t* pixel = target_pixel(ctx, x0 + i, y0);
+        for (int y = y0; y <= y1; y++, pixel += stride)
+            *pixel = color;
+        remember_span(ctx, x0 + i, y0, y1 + 1);
+
+        dirty_y0 = MIN(dirty_y0, y0);
+        dirty_y1 = MAX(dirty_y1, y1 + 1);
+    }
+
+    mark_dirty(ctx, x0 + first_column, dirty_y0, x0 + end_column, dirty_y1);
+}
+
+void render_wait(RenderCtx* ctx, RenderFence fence) {
+    if (render_fence_done(ctx, fence))
+        return;
+
+    /*
+     * Register the task before checking the fence again, since the transfer
+     * might be completed in the meantime, and the DMA callback would not know
+     * that it has to notify the task. A notification might also be left from
+     * a previous wait, so the fence is checked after each one.
+     */
+    atomic_store(&ctx->waiting_fence, fence);
+    atomic_store(&ctx->waiting_task, xTaskGetCurrentTaskHandle());
+    while (!render_fence_done(ctx, fence))
+        ulTaskNotifyTakeIndexed(RENDER_NOTIFY_INDEX, pdTRUE, portMAX_DELAY);
+    atomic_store(&ctx->waiting_task, NULL);
+}
+
+RenderFence render_flush_async(RenderCtx* ctx) {
+    /* Stripes are transferred by 'render_area' */
+    if (ctx->framebuffer != NULL && ctx->num_dirty_rects > 0)
+        queue_dirty_rects(ctx);
+
+    ctx->last_flush_bytes          = ctx->queued_bytes;
+    ctx->last_flush_transfers      = ctx->queued_transfers;
+    ctx->last_flush_cleared_pixels = ctx->cleared_pixels;
+    ctx->queued_bytes              = 0;
+    ctx->queued_transfers          = 0;
+    ctx->cleared_pixels            = 0;
+    return ctx->last_fence;
+}
+
+void render_flush(RenderCtx* ctx) {
+    render_wait(ctx, render_flush_async(ctx));
+}
+
+void render_area(RenderCtx* ctx,
+                 int x0,
+                 int y0,
+                 int x1,
+                 int y1,
+                 RenderDrawFunc draw,
+                 void* arg) {
+    const RenderRect area = {
+        .x0 = CLAMP(x0, 0, ctx->width),
+        .y0 = CLAMP(y0, 0, ctx->height),
+        .x1 = CLAMP(x1, 0, ctx->width),
+        .y1 = CLAMP(y1, 0, ctx->height),
+    };
+    if (rect_is_empty(&area))
+        return;
+
+    /*
+     * When using a framebuffer, just restrict the drawing functions to the
+     * area. Its dirty rectangles will be transferred by 'render_flush'.
+     */
+    if (ctx->framebuffer != NULL) {
+        const RenderRect old_clip_rect = ctx->clip_rect;
+        ctx->clip_rect                 = area;
+        draw(ctx, arg);
+        ctx->clip_rect = old_clip_rect;
+        return;
+    }
+
+    /*
+     * Draw the area in stripes as tall as the stripe buffer allows. Each stripe
+     * is converted into a staging buffer and queued as soon as it's drawn, so
+     * the stripe buffer can be reused immediately.
+     */
+    const int stripe_capacity = ctx->width * STAGING_HEIGHT;
+    const int stripe_height   = stripe_capacity / (area.x1 - area.x0);
+
+    for (int y = area.y0; y < area.y1; y += stripe_height) {
+        ctx->target      = ctx->stripe;
+        ctx->target_rect = (RenderRect){
+            .x0 = area.x0,
+            .y0 = y,
+            .x1 = area.x1,
+            .y1 = MIN(y + stripe_height, area.y1),
+        };
+        ctx->clip_rect = ctx->target_rect;
+
+        draw(ctx, arg);
+        queue_target_area(ctx, &ctx->target_rect);
+    }
+
+    ctx->target      = NULL;
+    ctx->target_rect = (RenderRect){ 0, 0, 0, 0 };
+    ctx->clip_rect   = ctx->target_rect;
+}
+
+void render_scroll(const RenderCtx* ctx, int offset) {
+    /*
+     * Convert the offset into the first frame memory row of the scrolling
+     * area. See 'LCD_SCROLL_REVERSED'.
+     */
+    offset %= (int)ctx->width;
+    if (offset < 0)
+        offset += ctx->width;
+#if LCD_SCROLL_REVERSED
+    const int start_row = (ctx->width - offset) % ctx->width;
+#else
+    const int start_row = offset;
+#endif
+
+    const uint8_t start_address[] = {
+        (start_row >> 8) & 0xFF,
+        start_row & 0xFF,
+    };
+    ESP_ERROR_CHECK(esp_lcd_panel_io_tx_param(ctx->lcd_io,
+                                              LCD_CMD_VSCRSADD,
+                                              start_address,
+                                              sizeof(start_address)));
 }
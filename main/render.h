@@ -19,48 +19,220 @@
 #ifndef RENDER_H_
 #define RENDER_H_ 1
 
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <stdint.h>
 
-#include "freertos/FreeRTOS.h" /* SemaphoreHandle_t */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"    /* TaskHandle_t */
+#include "esp_lcd_panel_io.h" /* esp_lcd_panel_io_handle_t */
 #include "esp_lcd_panel_ops.h" /* esp_lcd_panel_handle_t */
 
+/*
+ * Maximum number of dirty rectangles tracked between flushes. Once this limit
+ * is reached, new areas are merged with the existing rectangles.
+ */
+#define RENDER_MAX_DIRTY_RECTS 8
+
+/*
+ * Maximum number of drawn spans remembered for 'render_erase'. If more spans
+ * are drawn, the next erase clears the whole area instead.
+ */
+#define RENDER_MAX_SPANS 1536
+
+/* Rectangle from (x0, y0) to (x1, y1), exclusive */
+typedef struct RenderRect {
+    int x0, y0, x1, y1;
+} RenderRect;
+
+/* Vertical span at column 'x', from row 'y0' to 'y1', exclusive */
+typedef struct RenderSpan {
+    int16_t x, y0, y1;
+} RenderSpan;
+
+/*
+ * Index of the task notification used for signaling completed transfers to the
+ * task waiting for them. The index 0 is left for the application.
+ */
+#define RENDER_NOTIFY_INDEX 1
+
+/*
+ * Identifier of a queued DMA transfer to the LCD. Transfers are numbered
+ * consecutively, starting at one, and they are completed in the same order, so
+ * a fence is done once the number of completed transfers reaches it. The fence
+ * zero is always done.
+ */
+typedef uint32_t RenderFence;
+
+/*
+ * Number of colors in the palette of a render context. The pixels of the
+ * framebuffer are indices into the palette, which is used for converting them
+ * to RGB565 when they are transferred.
+ */
+#define RENDER_PALETTE_SIZE 256
+
+/*
+ * Palette index used by the clearing functions. It's black unless changed with
+ * 'render_set_palette_color'.
+ */
+#define RENDER_COLOR_BACKGROUND 0
+
+/*
+ * Buffers used for rendering, specified when calling 'render_init'.
+ *
+ * With 'RENDER_FRAMEBUFFER', the whole screen is kept in a framebuffer, which
+ * can be modified at any time, and is transferred with 'render_flush'.
+ *
+ * With 'RENDER_STRIPES', there is no framebuffer. Instead, 'render_area' draws
+ * the scene once per horizontal stripe of the screen into a small buffer, which
+ * is then converted into one of the staging buffers and transferred while the
+ * next stripe is drawn. This uses about 20 times less memory, but drawing is
+ * only possible from a 'render_area' callback.
+ */
+typedef enum RenderBuffering {
+    RENDER_FRAMEBUFFER,
+    RENDER_STRIPES,
+} RenderBuffering;
+
 typedef struct RenderCtx {
     /* Resolution of the LCD */
     size_t width, height;
 
+    /*
+     * LCD panel IO handle, used for sending commands that are not supported by
+     * the panel driver.
+     */
+    esp_lcd_panel_io_handle_t lcd_io;
+
     /* LCD panel handle used to call 'esp_lcd_panel_*' functions */
     esp_lcd_panel_handle_t lcd_panel;
 
-    /* Framebuffer for off-screen rendering (RGB565 format) */
-    uint16_t* framebuffer;
+    /*
+     * Framebuffer for off-screen rendering (palette indices), or NULL when
+     * rendering in stripes.
+     */
+    uint8_t* framebuffer;
+
+    /*
+     * Buffer for rendering a single stripe (palette indices), or NULL when
+     * using a framebuffer. See 'RENDER_STRIPES'.
+     */
+    uint8_t* stripe;
+
+    /*
+     * Buffer that the drawing functions write to, and the area of the screen
+     * that it holds. This is either the framebuffer, holding the whole screen,
+     * or the stripe buffer, holding the stripe that is currently being drawn.
+     */
+    uint8_t* target;
+    RenderRect target_rect;
+
+    /*
+     * Area of the screen that the drawing functions are allowed to modify. It's
+     * always contained in 'target_rect'.
+     */
+    RenderRect clip_rect;
+
+    /*
+     * RGB565 color of each palette index, with the byte order expected by the
+     * LCD. See 'render_set_palette_color'.
+     */
+    uint16_t palette[RENDER_PALETTE_SIZE];
+
+    /*
+     * DMA-capable buffers (RGB565 format) used for transferring areas of the
+     * target, after converting them through the palette. They are used
+     * alternately, so one of them is filled while the other one is being
+     * transferred.
+     */
+    uint16_t* staging_buffers[2];
+
+    /*
+     * Fence of the last transfer from each staging buffer, and index of the
+     * buffer that will be filled next.
+     */
+    RenderFence staging_fences[2];
+    int next_staging_buffer;
+
+    /*
+     * Fence of the last queued transfer, and number of completed transfers,
+     * which is increased from the DMA callback.
+     */
+    RenderFence last_fence;
+    atomic_uint_least32_t completed_fence;
+
+    /*
+     * Task waiting in 'render_wait', if any, and the fence it's waiting for.
+     * The DMA callback notifies the task once the fence is done.
+     */
+    _Atomic(TaskHandle_t) waiting_task;
+    atomic_uint_least32_t waiting_fence;
+
+    /*
+     * Areas of the framebuffer that have been modified since the last flush,
+     * and therefore need to be transferred to the LCD.
+     */
+    RenderRect dirty_rects[RENDER_MAX_DIRTY_RECTS];
+    int num_dirty_rects;
+
+    /*
+     * Array of 'RENDER_MAX_SPANS' spans drawn since the last 'render_clear' or
+     * 'render_erase', or NULL when rendering in stripes. If the drawn pixels
+     * couldn't be tracked, 'spans_overflowed' is set. The clipping area at the
+     * time of the last clear is also stored, since the next erase can only use
+     * the spans if the layout didn't change.
+     */
+    RenderSpan* spans;
+    int num_spans;
+    bool spans_overflowed;
+    RenderRect spans_clip_rect;
 
     /*
-     * Binary semaphore used to notify 'render_flush' that the LCD drawing is
-     * complete. This semaphore will be decreased (waited) from 'render_flush',
-     * and increased (signaled) from the DMA callback.
+     * Number of bytes and DMA transfers queued since the last flush, and the
+     * same numbers at the time of the last flush. When rendering in stripes,
+     * these include the stripes transferred by 'render_area'.
      */
-    SemaphoreHandle_t flush_done_semaphore;
+    size_t queued_bytes;
+    int queued_transfers;
+    size_t last_flush_bytes;
+    int last_flush_transfers;
 
     /*
-     * Counter tracking pending asynchronous transfers. The DMA callback only
-     * signals the semaphore if this counter is > 0, allowing async transfers
-     * to complete without affecting the semaphore.
+     * Number of pixels cleared or erased since the last flush, and the same
+     * number at the time of the last flush.
      */
-    volatile int pending_async_transfers;
+    size_t cleared_pixels;
+    size_t last_flush_cleared_pixels;
 } RenderCtx;
 
 /*----------------------------------------------------------------------------*/
 
 /*
  * Initialize a 'RenderCtx' structure for an LCD with the specified width and
- * height.
+ * height, rendering through the specified buffers.
  *
  * This function will:
  *   1. Initialize the LCD backlight GPIO.
  *   2. Initialize the SPI bus for communicating with the LCD.
  *   3. Initialize the ESP LCD panel handle.
+ *   4. Allocate the framebuffer or the stripe buffer, and the staging buffers.
+ */
+void render_init(RenderCtx* ctx,
+                 size_t width,
+                 size_t height,
+                 RenderBuffering buffering);
+
+/*
+ * Set the color of the specified palette index, in RGB888 format.
+ *
+ * Pixels that were already drawn with that index also change color, so when
+ * using a framebuffer, the whole screen is marked as modified, and the next
+ * flush transfers it with the new colors without redrawing anything. When
+ * rendering in stripes, the scene must be redrawn with 'render_area'.
  */
-void render_init(RenderCtx* ctx, size_t width, size_t height);
+void render_set_palette_color(RenderCtx* ctx,
+                              uint8_t index,
+                              uint32_t rgb888);
 
 /*
  * Deinitialize the specified render context, freeing all its necessary
@@ -70,15 +242,38 @@ void render_destroy(RenderCtx* ctx);
 
 /*
  * Clear the framebuffer associated to the specified render context, resetting
- * all pixels to black.
+ * all pixels to 'RENDER_COLOR_BACKGROUND'. Only the pixels inside the area
+ * being drawn by 'render_area', if any, are cleared.
+ *
+ * This does not update the physical display; the caller should use
+ * 'render_flush' to transfer the framebuffer to the LCD.
+ */
+void render_clear(RenderCtx* ctx);
+
+/*
+ * Erase the pixels drawn since the last call to 'render_clear' or
+ * 'render_erase', resetting them to 'RENDER_COLOR_BACKGROUND'. This is much
+ * cheaper than clearing the whole framebuffer when only a few pixels are drawn
+ * on each frame, like the traces of a chart.
+ *
+ * Only the spans drawn by 'render_draw_trace' and 'render_draw_envelope' are
+ * tracked. If any other drawing function was used, if too many spans were
+ * drawn, or if the clipping area changed since the last clear (i.e. the layout
+ * changed), this function falls back to 'render_clear'.
+ */
+void render_erase(RenderCtx* ctx);
+
+/*
+ * Clear the area of the framebuffer from (x0, y0) to (x1, y1), exclusive,
+ * resetting its pixels to 'RENDER_COLOR_BACKGROUND'.
  *
  * This does not update the physical display; the caller should use
  * 'render_flush' to transfer the framebuffer to the LCD.
  */
-void render_clear(const RenderCtx* ctx);
+void render_clear_area(RenderCtx* ctx, int x0, int y0, int x1, int y1);
 
 /*
- * Draw a line of the specified RGB888 color from (x0, y0) to (x1, y1) in the
+ * Draw a line of the specified palette color from (x0, y0) to (x1, y1) in the
  * framebuffer associated to the specified render context.
  *
  * The line is drawn using Bresenham's line algorithm, which is an efficient
@@ -89,21 +284,134 @@ void render_clear(const RenderCtx* ctx);
  * This does not update the physical display; the caller should use
  * 'render_flush' to transfer the framebuffer to the LCD.
  */
-void render_draw_line(const RenderCtx* ctx,
+void render_draw_line(RenderCtx* ctx,
                       int x0,
                       int y0,
                       int x1,
                       int y1,
-                      uint32_t color);
+                      uint8_t color);
+
+/*
+ * Draw a chart trace of the specified palette color, from an array of Y
+ * coordinates for consecutive columns, starting at column 'x0'.
+ *
+ * Each column after the first one is filled with a vertical span that connects
+ * its Y coordinate to the one of the previous column. Therefore, the first
+ * column is only used as the starting point of the trace, and is not drawn.
+ *
+ * This is much faster than drawing a line for each pair of points, since each
+ * span is filled by stepping a pointer through the rows of the target.
+ *
+ * This does not update the physical display; the caller should use
+ * 'render_flush' to transfer the framebuffer to the LCD.
+ */
+void render_draw_trace(RenderCtx* ctx,
+                       int x0,
+                       const int16_t* ys,
+                       int num_points,
+                       uint8_t color);
+
+/*
+ * Draw a filled chart envelope of the specified palette color, from arrays of
+ * top and bottom Y coordinates (inclusive) for consecutive columns, starting at
+ * column 'x0'. This is used for drawing columns that summarize more than one
+ * value, so their extremes remain visible.
+ *
+ * Like in 'render_draw_trace', each column after the first one is filled with
+ * a vertical span, which covers the range of the column and connects it to the
+ * range of the previous column. A trace is an envelope where the top and
+ * bottom of each column are the same.
+ *
+ * This does not update the physical display; the caller should use
+ * 'render_flush' to transfer the framebuffer to the LCD.
+ */
+void render_draw_envelope(RenderCtx* ctx,
+                          int x0,
+                          const int16_t* tops,
+                          const int16_t* bottoms,
+                          int num_columns,
+                          uint8_t color);
+
+/*
+ * Check if the transfers up to the specified fence have been completed.
+ */
+static inline bool render_fence_done(const RenderCtx* ctx,
+                                     RenderFence fence) {
+    /* The subtraction handles the wrap-around of the fence numbers */
+    const RenderFence completed = atomic_load(&ctx->completed_fence);
+    return (int32_t)(completed - fence) >= 0;
+}
+
+/*
+ * Block the calling task until the transfers up to the specified fence have
+ * been completed. The task is woken up by the DMA callback through its
+ * 'RENDER_NOTIFY_INDEX' notification.
+ */
+void render_wait(RenderCtx* ctx, RenderFence fence);
+
+/*
+ * Asynchronously flush the modified areas of the framebuffer to the physical
+ * LCD, returning the fence of the last queued transfer, which can be used with
+ * 'render_wait'.
+ *
+ * The transfers are done from the staging buffers, so the framebuffer can be
+ * modified again immediately, and the caller can do any other work in the
+ * meantime. When rendering in stripes, this function just returns the fence of
+ * the last stripe transferred by 'render_area'.
+ */
+RenderFence render_flush_async(RenderCtx* ctx);
+
+/*
+ * Synchronously flush the modified areas of the framebuffer to the physical
+ * LCD.
+ *
+ * Every drawing function marks the area it modified as dirty, and this function
+ * only transfers the dirty rectangles, which are reset afterwards. If most of
+ * the screen is dirty, the entire framebuffer is transferred as a single
+ * rectangle instead, in chunks of full-width rows that fit in a staging buffer.
+ *
+ * The function waits for the DMA callback of the last transfer, therefore
+ * ensuring the caller can't modify/free data that is being processed through
+ * DMA. When rendering in stripes, this function just waits for the stripes
+ * transferred by 'render_area'.
+ */
+void render_flush(RenderCtx* ctx);
+
+/*
+ * Function that draws a scene using the drawing functions, called from
+ * 'render_area' with its 'arg' parameter.
+ */
+typedef void (*RenderDrawFunc)(RenderCtx* ctx, void* arg);
+
+/*
+ * Redraw the area of the screen from (x0, y0) to (x1, y1), exclusive, by
+ * calling the specified function, which should draw the whole scene. Pixels
+ * outside of the area are not modified.
+ *
+ * When using a framebuffer, the function is called once, and the area is
+ * transferred by the next 'render_flush' call. When rendering in stripes, the
+ * function is called once for each stripe of the area, and each stripe is
+ * transferred as soon as it's drawn, while the next one is being drawn. In both
+ * cases, the result on the LCD is the same.
+ */
+void render_area(RenderCtx* ctx,
+                 int x0,
+                 int y0,
+                 int x1,
+                 int y1,
+                 RenderDrawFunc draw,
+                 void* arg);
 
 /*
- * Synchronously flush the framebuffer to the physical LCD.
+ * Set the hardware scrolling offset of the LCD, so the framebuffer column
+ * 'offset' is displayed on the left edge of the screen, and the columns before
+ * it wrap around to the right edge. In other words, a framebuffer column 'x'
+ * is displayed at '(x - offset) mod width'.
  *
- * Transfers the entire framebuffer to the LCD in a single DMA transaction,
- * while also waiting for the DMA callback, therefore ensuring the caller can't
- * modify/free data that is being processed through DMA.
+ * This only changes which part of the LCD memory is displayed, so it's almost
+ * free. Coordinates used for drawing and flushing are not affected.
  */
-void render_flush(const RenderCtx* ctx);
+void render_scroll(const RenderCtx* ctx, int offset);
 
 /*
  * Get the width of the specified render context.
@@ -0,0 +1,415 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "sample_log.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> /* memcpy, memset */
+
+#include "util.h"
+
+/*
+ * Number of 32-bit words of each block. The last one is never written, so
+ * reads that cross a word boundary don't have to be checked.
+ */
+#define WORDS_PER_BLOCK (SAMPLE_LOG_BLOCK_SIZE / sizeof(uint32_t))
+#define BITS_PER_BLOCK  ((WORDS_PER_BLOCK - 1) * 32)
+
+/*
+ * Number of bits used by each class of timestamp delta-of-delta, after its
+ * prefix. The classes are wider than the ones in the Gorilla paper, since the
+ * timestamps are in microseconds instead of seconds. Deltas-of-deltas that
+ * don't fit in the last class start a new block.
+ */
+static const int timestamp_class_bits[] = { 8, 14, 20, 32 };
+
+/*
+ * Maximum number of bits used by an encoded timestamp and value, including
+ * their prefixes.
+ */
+#define MAX_TIMESTAMP_BITS (4 + 32)
+#define MAX_VALUE_BITS     (2 + 5 + 5 + 32)
+
+/*----------------------------------------------------------------------------*/
+
+static inline uint32_t float_to_bits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static inline float bits_to_float(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/*
+ * Write the lowest 'num_bits' bits of 'bits' (between 1 and 32) at the
+ * specified bit position of a stream, most significant bit first, advancing
+ * the position. The written bits of the stream must be zero.
+ */
+static inline void write_bits(uint32_t* words,
+                              int* pos,
+                              uint32_t bits,
+                              int num_bits) {
+    const int word   = *pos / 32;
+    const int offset = *pos % 32;
+
+    const uint64_t shifted = (uint64_t)(bits & (UINT32_MAX >> (32 - num_bits)))
+                             << (64 - offset - num_bits);
+    words[word] |= shifted >> 32;
+    if (offset + num_bits > 32)
+        words[word + 1] |= (uint32_t)shifted;
+
+    *pos += num_bits;
+}
+
+/*
+ * Read 'num_bits' bits (between 1 and 32) from the specified bit position of a
+ * stream, advancing the position.
+ */
+static inline uint32_t read_bits(const uint32_t* words,
+                                 int* pos,
+                                 int num_bits) {
+    const int word   = *pos / 32;
+    const int offset = *pos % 32;
+
+    const uint64_t pair = ((uint64_t)words[word] << 32) | words[word + 1];
+    *pos += num_bits;
+    return (pair << offset) >> (64 - num_bits);
+}
+
+static inline bool fits_in_bits(int64_t value, int num_bits) {
+    const int64_t limit = (int64_t)1 << (num_bits - 1);
+    return value >= -limit && value < limit;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Encode a timestamp delta-of-delta, which must fit in the last class. Zero is
+ * stored as a single '0' bit. Otherwise, the index of its class is stored as a
+ * prefix of ones, terminated by a zero unless it's the last class.
+ */
+static void encode_timestamp(uint32_t* words, int* pos, int64_t dod) {
+    if (dod == 0) {
+        write_bits(words, pos, 0, 1);
+        return;
+    }
+
+    const int num_classes = LENGTH(timestamp_class_bits);
+    for (int i = 0; i < num_classes; i++) {
+        if (!fits_in_bits(dod, timestamp_class_bits[i]))
+            continue;
+
+        const bool is_last    = (i == num_classes - 1);
+        const int prefix_size = is_last ? num_classes : i + 2;
+        const uint32_t prefix = is_last ? UINT32_MAX : (UINT32_MAX - 1);
+        write_bits(words, pos, prefix, prefix_size);
+        write_bits(words, pos, dod, timestamp_class_bits[i]);
+        return;
+    }
+
+    assert(false);
+}
+
+static int64_t decode_timestamp(const uint32_t* words, int* pos) {
+    int class = 0;
+    while (class < (int)LENGTH(timestamp_class_bits) &&
+           read_bits(words, pos, 1) != 0)
+        class++;
+    if (class == 0)
+        return 0;
+
+    /* Sign-extend the stored bits */
+    const int num_bits  = timestamp_class_bits[class - 1];
+    const uint32_t bits = read_bits(words, pos, num_bits) << (32 - num_bits);
+    return (int32_t)bits >> (32 - num_bits);
+}
+
+/*
+ * Encode a value of the specified channel, updating its state. If it's equal
+ * to the previous value, it's stored as a single '0' bit. Otherwise, the
+ * meaningful bits of the XOR with the previous value are stored after a '1'
+ * bit. If they fit in the position of the previous meaningful bits, they are
+ * stored there after a '0' bit. Otherwise, they are stored after a '1' bit,
+ * the number of leading zeros (5 bits) and the number of meaningful bits minus
+ * one (5 bits).
+ */
+static void encode_value(SampleLogState* state,
+                         int channel,
+                         uint32_t* words,
+                         int* pos,
+                         uint32_t value) {
+    const uint32_t xor     = value ^ state->values[channel];
+    state->values[channel] = value;
+    if (xor == 0) {
+        write_bits(words, pos, 0, 1);
+        return;
+    }
+
+    const int leading_zeros  = __builtin_clz(xor);
+    const int trailing_zeros = __builtin_ctz(xor);
+
+    const int prev_leading_zeros  = state->leading_zeros[channel];
+    const int prev_num_bits       = state->num_meaningful_bits[channel];
+    const int prev_trailing_zeros = 32 - prev_leading_zeros - prev_num_bits;
+    if (prev_num_bits > 0 && leading_zeros >= prev_leading_zeros &&
+        trailing_zeros >= prev_trailing_zeros) {
+        write_bits(words, pos, 0x2, 2);
+        write_bits(words, pos, xor >> prev_trailing_zeros, prev_num_bits);
+        return;
+    }
+
+    const int num_bits = 32 - leading_zeros - trailing_zeros;
+    write_bits(words, pos, 0x3, 2);
+    write_bits(words, pos, leading_zeros, 5);
+    write_bits(words, pos, num_bits - 1, 5);
+    write_bits(words, pos, xor >> trailing_zeros, num_bits);
+
+    state->leading_zeros[channel]       = leading_zeros;
+    state->num_meaningful_bits[channel] = num_bits;
+}
+
+static uint32_t decode_value(SampleLogState* state,
+                             int channel,
+                             const uint32_t* words,
+                             int* pos) {
+    if (read_bits(words, pos, 1) == 0)
+        return state->values[channel];
+
+    if (read_bits(words, pos, 1) != 0) {
+        state->leading_zeros[channel]       = read_bits(words, pos, 5);
+        state->num_meaningful_bits[channel] = read_bits(words, pos, 5) + 1;
+    }
+
+    const int leading_zeros  = state->leading_zeros[channel];
+    const int num_bits       = state->num_meaningful_bits[channel];
+    const int trailing_zeros = 32 - leading_zeros - num_bits;
+
+    state->values[channel] ^= read_bits(words, pos, num_bits)
+                              << trailing_zeros;
+    return state->values[channel];
+}
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Get the block with the specified index, starting from the oldest one, and
+ * its bit stream.
+ */
+static inline int get_block_pos(const SampleLog* log, int index) {
+    return (log->first_block + index) % log->num_blocks;
+}
+
+static inline uint32_t* get_block_words(const SampleLog* log, int block_pos) {
+    return &log->words[WORDS_PER_BLOCK * block_pos];
+}
+
+/*
+ * Start a new block with the specified sample, which is stored uncompressed,
+ * discarding the oldest block if necessary.
+ */
+static void start_block(SampleLog* log,
+                        int64_t timestamp,
+                        const float* values) {
+    if (log->num_used_blocks == log->num_blocks) {
+        log->num_samples -= log->blocks[log->first_block].num_samples;
+        log->first_block = get_block_pos(log, 1);
+        log->num_used_blocks--;
+    }
+
+    const int block_pos   = get_block_pos(log, log->num_used_blocks);
+    SampleLogBlock* block = &log->blocks[block_pos];
+    uint32_t* words       = get_block_words(log, block_pos);
+    log->num_used_blocks++;
+
+    memset(words, 0, SAMPLE_LOG_BLOCK_SIZE);
+    block->first_timestamp = timestamp;
+    block->num_samples     = 0;
+    block->num_bits        = 0;
+
+    SampleLogState* state = &log->state;
+    state->timestamp      = timestamp;
+    state->delta          = 0;
+    for (int i = 0; i < log->num_channels; i++) {
+        state->values[i]              = float_to_bits(values[i]);
+        state->leading_zeros[i]       = 0;
+        state->num_meaningful_bits[i] = 0;
+        write_bits(words, &block->num_bits, state->values[i], 32);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+void sample_log_init(SampleLog* log, int num_channels, size_t num_bytes) {
+    assert(num_channels > 0 && num_channels <= SAMPLE_LOG_MAX_CHANNELS);
+
+    /* A sample must always fit in an empty block */
+    assert(32 * num_channels <= BITS_PER_BLOCK);
+    assert(MAX_TIMESTAMP_BITS + num_channels * MAX_VALUE_BITS <=
+           BITS_PER_BLOCK);
+
+    /* The budget includes the summaries of the blocks */
+    const size_t block_bytes = SAMPLE_LOG_BLOCK_SIZE + sizeof(SampleLogBlock);
+
+    log->num_channels    = num_channels;
+    log->num_blocks      = MAX(1, num_bytes / block_bytes);
+    log->first_block     = 0;
+    log->num_used_blocks = 0;
+    log->num_samples     = 0;
+
+    /* The first sample always starts a block, which resets the state */
+    log->state.timestamp = 0;
+    log->state.delta     = 0;
+
+    log->words  = malloc(log->num_blocks * SAMPLE_LOG_BLOCK_SIZE);
+    log->blocks = malloc(log->num_blocks * sizeof(SampleLogBlock));
+    if (log->words == NULL || log->blocks == NULL) {
+        fprintf(stderr,
+                "Failed to allocate sample log (%d blocks of %d bytes)\n",
+                log->num_blocks,
+                SAMPLE_LOG_BLOCK_SIZE);
+        abort();
+    }
+}
+
+void sample_log_destroy(SampleLog* log) {
+    free(log->words);
+    free(log->blocks);
+    log->words      = NULL;
+    log->blocks     = NULL;
+    log->num_blocks = 0;
+}
+
+void sample_log_append(SampleLog* log, int64_t timestamp, const float* values) {
+    SampleLogState* state = &log->state;
+    const int64_t delta   = timestamp - state->timestamp;
+    const int64_t dod     = delta - state->delta;
+
+    const int last_class_bits =
+      timestamp_class_bits[LENGTH(timestamp_class_bits) - 1];
+    const int max_sample_bits =
+      MAX_TIMESTAMP_BITS + log->num_channels * MAX_VALUE_BITS;
+
+    SampleLogBlock* block =
+      (log->num_used_blocks > 0)
+        ? &log->blocks[get_block_pos(log, log->num_used_blocks - 1)]
+        : NULL;
+    if (block == NULL || block->num_bits + max_sample_bits > BITS_PER_BLOCK ||
+        !fits_in_bits(dod, last_class_bits)) {
+        start_block(log, timestamp, values);
+        block = &log->blocks[get_block_pos(log, log->num_used_blocks - 1)];
+    } else {
+        uint32_t* words =
+          get_block_words(log, get_block_pos(log, log->num_used_blocks - 1));
+
+        encode_timestamp(words, &block->num_bits, dod);
+        for (int i = 0; i < log->num_channels; i++)
+            encode_value(state,
+                         i,
+                         words,
+                         &block->num_bits,
+                         float_to_bits(values[i]));
+
+        state->timestamp = timestamp;
+        state->delta     = delta;
+    }
+
+    block->last_timestamp = timestamp;
+    block->num_samples++;
+    log->num_samples++;
+}
+
+size_t sample_log_get_num_bytes(const SampleLog* log) {
+    return log->num_blocks * (SAMPLE_LOG_BLOCK_SIZE + sizeof(SampleLogBlock));
+}
+
+void sample_log_seek(SampleLogReader* reader,
+                     const SampleLog* log,
+                     int64_t sample_index) {
+    reader->log              = log;
+    reader->num_read_blocks  = 0;
+    reader->num_read_samples = 0;
+    reader->num_read_bits    = 0;
+
+    /* Skip whole blocks, and decode the remaining samples of the last one */
+    while (reader->num_read_blocks < log->num_used_blocks) {
+        const SampleLogBlock* block =
+          &log->blocks[get_block_pos(log, reader->num_read_blocks)];
+        if (sample_index < block->num_samples)
+            break;
+
+        sample_index -= block->num_samples;
+        reader->num_read_blocks++;
+    }
+
+    int64_t timestamp;
+    float values[SAMPLE_LOG_MAX_CHANNELS];
+    for (int64_t i = 0; i < sample_index; i++)
+        if (!sample_log_read(reader, &timestamp, values))
+            break;
+}
+
+bool sample_log_read(SampleLogReader* reader,
+                     int64_t* timestamp,
+                     float* values) {
+    const SampleLog* log = reader->log;
+    if (reader->num_read_blocks >= log->num_used_blocks)
+        return false;
+
+    int block_pos = get_block_pos(log, reader->num_read_blocks);
+    if (reader->num_read_samples >= log->blocks[block_pos].num_samples) {
+        reader->num_read_blocks++;
+        reader->num_read_samples = 0;
+        reader->num_read_bits    = 0;
+        if (reader->num_read_blocks >= log->num_used_blocks)
+            return false;
+
+        block_pos = get_block_pos(log, reader->num_read_blocks);
+    }
+
+    const SampleLogBlock* block = &log->blocks[block_pos];
+    const uint32_t* words       = get_block_words(log, block_pos);
+    SampleLogState* state       = &reader->state;
+    int* pos                    = &reader->num_read_bits;
+
+    if (reader->num_read_samples == 0) {
+        /* The first sample of each block is stored uncompressed */
+        state->timestamp = block->first_timestamp;
+        state->delta     = 0;
+        for (int i = 0; i < log->num_channels; i++) {
+            state->values[i]              = read_bits(words, pos, 32);
+            state->leading_zeros[i]       = 0;
+            state->num_meaningful_bits[i] = 0;
+            values[i]                     = bits_to_float(state->values[i]);
+        }
+    } else {
+        state->delta += decode_timestamp(words, pos);
+        state->timestamp += state->delta;
+        for (int i = 0; i < log->num_channels; i++)
+            values[i] = bits_to_float(decode_value(state, i, words, pos));
+    }
+
+    reader->num_read_samples++;
+    *timestamp = state->timestamp;
+    return true;
+}
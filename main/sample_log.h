@@ -0,0 +1,159 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SAMPLE_LOG_H_
+#define SAMPLE_LOG_H_ 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Maximum number of channels of the samples stored in a log.
+ */
+#define SAMPLE_LOG_MAX_CHANNELS 8
+
+/*
+ * Size in bytes of each block of a log, which is the granularity in which old
+ * samples are discarded.
+ */
+#define SAMPLE_LOG_BLOCK_SIZE 512
+
+/*
+ * State shared by the encoder and the decoder of a log: the previous sample,
+ * and the bits of the previous value of each channel that were stored (see
+ * 'SampleLog').
+ */
+typedef struct SampleLogState {
+    int64_t timestamp;
+    int64_t delta;
+    uint32_t values[SAMPLE_LOG_MAX_CHANNELS];
+    uint8_t leading_zeros[SAMPLE_LOG_MAX_CHANNELS];
+    uint8_t num_meaningful_bits[SAMPLE_LOG_MAX_CHANNELS];
+} SampleLogState;
+
+/*
+ * Summary of a block of a log.
+ */
+typedef struct SampleLogBlock {
+    /* Timestamps of the first and last samples of the block */
+    int64_t first_timestamp;
+    int64_t last_timestamp;
+
+    /* Number of samples in the block, and number of bits they use */
+    int num_samples;
+    int num_bits;
+} SampleLogBlock;
+
+/*
+ * Compressed log of timestamped samples, using the encoding of the Gorilla
+ * time series database.
+ *
+ * The samples are stored in a circular buffer of fixed-size blocks, and the
+ * oldest block is discarded when a new one is needed and the buffer is full.
+ * Each block is independent: the first sample is stored uncompressed, and the
+ * rest are encoded with respect to the previous sample, as a bit stream.
+ *
+ * Each timestamp is stored as the difference between its delta and the
+ * previous one, with a variable-length prefix, so samples received at a
+ * constant rate only take a bit. Each value is XORed with the previous value of
+ * its channel, so unchanged values only take a bit, and the meaningful bits of
+ * the result are stored, reusing the position of the previous ones if
+ * possible. Slowly changing signals take a few bits per value.
+ */
+typedef struct SampleLog {
+    int num_channels;
+
+    /* Bit streams of the blocks, each with 'SAMPLE_LOG_BLOCK_SIZE' bytes */
+    uint32_t* words;
+    SampleLogBlock* blocks;
+    int num_blocks;
+
+    /* Position of the oldest block, and number of blocks in use */
+    int first_block;
+    int num_used_blocks;
+
+    /* Number of samples in all the blocks in use */
+    int64_t num_samples;
+
+    /* State of the encoder after the last sample */
+    SampleLogState state;
+} SampleLog;
+
+/*
+ * Position of a reader in a log, and state of its decoder.
+ */
+typedef struct SampleLogReader {
+    const SampleLog* log;
+
+    /* Number of blocks that were read, starting from the oldest one */
+    int num_read_blocks;
+
+    /* Number of samples read from the current block, and their total bits */
+    int num_read_samples;
+    int num_read_bits;
+
+    SampleLogState state;
+} SampleLogReader;
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Initialize the specified log, allocating as many blocks as fit in
+ * 'num_bytes' along with their summaries (at least one). Each sample will have
+ * 'num_channels' values.
+ */
+void sample_log_init(SampleLog* log, int num_channels, size_t num_bytes);
+
+/*
+ * Deinitialize a log, freeing its necessary members. This function does not
+ * free the 'SampleLog' structure itself.
+ */
+void sample_log_destroy(SampleLog* log);
+
+/*
+ * Append a sample to the log, with the specified timestamp and one value per
+ * channel. The timestamps should not decrease.
+ */
+void sample_log_append(SampleLog* log, int64_t timestamp, const float* values);
+
+/*
+ * Get the number of bytes used by the blocks of the log, along with the
+ * memory overhead of their summaries.
+ */
+size_t sample_log_get_num_bytes(const SampleLog* log);
+
+/*
+ * Initialize a reader of the specified log, positioned at the sample with the
+ * specified index, counting from the oldest one. The log must not be modified
+ * while the reader is used.
+ */
+void sample_log_seek(SampleLogReader* reader,
+                     const SampleLog* log,
+                     int64_t sample_index);
+
+/*
+ * Read the next sample from the specified reader, storing its timestamp and
+ * its values, one per channel. Returns false if there are no more samples.
+ */
+bool sample_log_read(SampleLogReader* reader,
+                     int64_t* timestamp,
+                     float* values);
+
+#endif /* SAMPLE_LOG_H_ */
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "sample_queue.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+void sample_queue_init(SampleQueue* queue, size_t capacity) {
+    /* The capacity must be a power of two, so positions can be masked */
+    assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+
+    queue->capacity = capacity;
+    atomic_init(&queue->write_pos, 0);
+    atomic_init(&queue->read_pos, 0);
+    atomic_init(&queue->dropped, 0);
+
+    queue->samples = malloc(capacity * sizeof(Sample));
+    if (queue->samples == NULL) {
+        fprintf(stderr,
+                "Failed to allocate sample queue (%zu samples; %zu bytes)\n",
+                capacity,
+                capacity * sizeof(Sample));
+        abort();
+    }
+}
+
+void sample_queue_destroy(SampleQueue* queue) {
+    if (queue->samples != NULL) {
+        free(queue->samples);
+        queue->samples = NULL;
+    }
+}
+
+bool sample_queue_push(SampleQueue* queue, const Sample* sample) {
+    /*
+     * Only the producer writes 'write_pos', so it can be read relaxed. The
+     * acquire on 'read_pos' ensures the consumer is done reading a slot before
+     * we overwrite it.
+     */
+    const size_t write_pos =
+      atomic_load_explicit(&queue->write_pos, memory_order_relaxed);
+    const size_t read_pos =
+      atomic_load_explicit(&queue->read_pos, memory_order_acquire);
+
+    if (write_pos - read_pos >= queue->capacity) {
+        atomic_fetch_add_explicit(&queue->dropped, 1, memory_order_relaxed);
+        return false;
+    }
+
+    queue->samples[write_pos & (queue->capacity - 1)] = *sample;
+
+    /* Publish the sample; the release pairs with the consumer's acquire */
+    atomic_store_explicit(&queue->write_pos,
+                          write_pos + 1,
+                          memory_order_release);
+    return true;
+}
+
+size_t sample_queue_pop(SampleQueue* queue, Sample* dst, size_t max_samples) {
+    const size_t read_pos =
+      atomic_load_explicit(&queue->read_pos, memory_order_relaxed);
+    const size_t write_pos =
+      atomic_load_explicit(&queue->write_pos, memory_order_acquire);
+
+    size_t count = write_pos - read_pos;
+    if (count > max_samples)
+        count = max_samples;
+
+    for (size_t i = 0; i < count; i++)
+        dst[i] = queue->samples[(read_pos + i) & (queue->capacity - 1)];
+
+    /* Release the slots, so the producer can reuse them */
+    atomic_store_explicit(&queue->read_pos,
+                          read_pos + count,
+                          memory_order_release);
+    return count;
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SAMPLE_QUEUE_H_
+#define SAMPLE_QUEUE_H_ 1
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Maximum number of channels in a single sample.
+ */
+#define SAMPLE_MAX_CHANNELS 8
+
+/*
+ * Structure representing a set of values received at the same time, one per
+ * chart channel.
+ */
+typedef struct Sample {
+    /* Time when the sample was received, in microseconds since boot */
+    int64_t timestamp_us;
+
+    /* Value of each channel */
+    float values[SAMPLE_MAX_CHANNELS];
+} Sample;
+
+/*
+ * Lock-free single-producer, single-consumer queue of samples.
+ *
+ * One task (the producer) may push samples while another task (the consumer)
+ * pops them, without any locks. The producer only writes 'write_pos', and the
+ * consumer only writes 'read_pos'. Both positions are free-running, and are
+ * only wrapped when indexing the 'samples' array.
+ */
+typedef struct SampleQueue {
+    Sample* samples;
+    size_t capacity;
+
+    atomic_size_t write_pos;
+    atomic_size_t read_pos;
+
+    /* Number of samples that were dropped because the queue was full */
+    atomic_uint dropped;
+} SampleQueue;
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Initialize the specified sample queue, allocating space for 'capacity'
+ * samples. The capacity must be a power of two.
+ */
+void sample_queue_init(SampleQueue* queue, size_t capacity);
+
+/*
+ * Deinitialize a sample queue, freeing its necessary members. This function
+ * does not free the 'SampleQueue' structure itself.
+ */
+void sample_queue_destroy(SampleQueue* queue);
+
+/*
+ * Push a copy of the specified sample to the queue. Returns true on success, or
+ * false if the queue was full, in which case the sample is dropped. Must only
+ * be called from the producer.
+ */
+bool sample_queue_push(SampleQueue* queue, const Sample* sample);
+
+/*
+ * Pop up to 'max_samples' samples from the queue, in the same order they were
+ * pushed, and copy them to 'dst'. Returns the number of popped samples, which
+ * is zero if the queue was empty. Must only be called from the consumer.
+ */
+size_t sample_queue_pop(SampleQueue* queue, Sample* dst, size_t max_samples);
+
+#endif /* SAMPLE_QUEUE_H_ */
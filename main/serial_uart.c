@@ -17,12 +17,16 @@
  */
 
 #include "serial_uart.h"
-#include <errno.h>
-#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
 #include <ctype.h>
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 #include "driver/uart.h"
 
+#include "decimal.h"
+#include "frame.h"
 #include "util.h"
 
 /*
@@ -35,7 +39,234 @@
 #define SERIAL_UART_BAUD_RATE     115200
 #define SERIAL_UART_BUF_SIZE      1024
 #define SERIAL_UART_RX_BUF_SIZE   (SERIAL_UART_BUF_SIZE * 2)
-#define SERIAL_UART_RX_TIMEOUT_MS 20
+
+/*
+ * Size of the event queue of the UART driver, and of its queue of detected
+ * newline positions.
+ */
+#define SERIAL_UART_EVENT_QUEUE_SIZE   20
+#define SERIAL_UART_PATTERN_QUEUE_SIZE 20
+
+/*
+ * Size of the local ring buffer where received bytes are drained in bulk from
+ * the UART driver. Must be a power of two, so positions can be wrapped with a
+ * mask.
+ */
+#define SERIAL_UART_RING_SIZE 512
+#define SERIAL_UART_RING_MASK (SERIAL_UART_RING_SIZE - 1)
+
+/*
+ * Maximum number of fields that can be read from a single record.
+ */
+#define SERIAL_UART_MAX_FIELDS 16
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Local ring buffer of received bytes. The read and write positions are
+ * free-running, and are only wrapped when indexing the 'data' array, so the
+ * number of buffered bytes is always 'write_pos - read_pos'.
+ */
+static struct {
+    uint8_t data[SERIAL_UART_RING_SIZE];
+    size_t read_pos;
+    size_t write_pos;
+} g_ring;
+
+/* Queue where the UART driver sends its events */
+static QueueHandle_t g_event_queue;
+
+/* Statistics about the received data, returned by 'serial_uart_get_stats' */
+static SerialUartStats g_stats;
+
+/*
+ * Format of the received records. The mode is detected automatically from the
+ * received data; see 'serial_uart_read_record'. Until a binary frame or a valid
+ * ASCII record is received, the format is unknown, and records are parsed as
+ * ASCII.
+ */
+static enum {
+    SERIAL_MODE_UNKNOWN,
+    SERIAL_MODE_ASCII,
+    SERIAL_MODE_BINARY,
+} g_mode = SERIAL_MODE_UNKNOWN;
+
+/* Sequence number of the last valid binary frame, for detecting lost frames */
+static uint16_t g_last_sequence;
+static bool g_has_last_sequence = false;
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Handle the specified event from the UART driver, updating the statistics if
+ * necessary. Returns true if the received data is worth reading, that is, if a
+ * complete record might be available.
+ */
+static bool handle_uart_event(const uart_event_t* event) {
+    switch (event->type) {
+        case UART_PATTERN_DET:
+            /*
+             * A newline was received. The positions of the detected patterns
+             * are not used, but they must be popped so the driver's pattern
+             * queue doesn't fill up.
+             */
+            uart_pattern_pop_pos(SERIAL_UART_NUM);
+            return true;
+
+        case UART_DATA: {
+            /*
+             * Binary frames are not newline-terminated, so any data is worth
+             * reading unless the sender is known to use ASCII records, since
+             * it might contain a frame. Once it is, we only wake up for
+             * incomplete records if they would fill the ring buffer.
+             */
+            if (g_mode != SERIAL_MODE_ASCII)
+                return true;
+
+            size_t available = 0;
+            uart_get_buffered_data_len(SERIAL_UART_NUM, &available);
+            return available >= SERIAL_UART_RING_SIZE;
+        }
+
+        case UART_FIFO_OVF:
+        case UART_BUFFER_FULL:
+            /*
+             * Data was lost because it wasn't read fast enough. Discard
+             * everything that was buffered, so we resynchronize at the next
+             * record, and reset the queue to drop stale events.
+             */
+            if (event->type == UART_FIFO_OVF)
+                g_stats.fifo_overflows++;
+            else
+                g_stats.buffer_overflows++;
+            uart_flush_input(SERIAL_UART_NUM);
+            xQueueReset(g_event_queue);
+            return false;
+
+        case UART_FRAME_ERR:
+            g_stats.frame_errors++;
+            return false;
+
+        default:
+            return false;
+    }
+}
+
+/*
+ * Drain as many bytes as possible from the UART driver into the local ring
+ * buffer, using a single 'uart_read_bytes' call. If the driver has no buffered
+ * data, sleep until it reports that a complete record might be available.
+ */
+static void ring_fill(void) {
+    const size_t used  = g_ring.write_pos - g_ring.read_pos;
+    const size_t space = SERIAL_UART_RING_SIZE - used;
+    if (space == 0)
+        return;
+
+    /* Only fill up to the end of the array, so a single read is enough */
+    const size_t write_idx  = g_ring.write_pos & SERIAL_UART_RING_MASK;
+    const size_t contiguous = MIN(space, SERIAL_UART_RING_SIZE - write_idx);
+
+    for (;;) {
+        /*
+         * Handle pending events before reading, so any data loss is accounted
+         * to the record that is currently being received.
+         */
+        uart_event_t event;
+        while (xQueueReceive(g_event_queue, &event, 0) == pdTRUE)
+            handle_uart_event(&event);
+
+        size_t available = 0;
+        uart_get_buffered_data_len(SERIAL_UART_NUM, &available);
+        if (available > 0) {
+            const int len = uart_read_bytes(SERIAL_UART_NUM,
+                                            &g_ring.data[write_idx],
+                                            MIN(available, contiguous),
+                                            0);
+            if (len > 0) {
+                g_ring.write_pos += len;
+                return;
+            }
+        }
+
+        /* Nothing to read, block until the driver has something for us */
+        do {
+            xQueueReceive(g_event_queue, &event, portMAX_DELAY);
+        } while (!handle_uart_event(&event));
+    }
+}
+
+/*
+ * Get the next received byte from the local ring buffer, refilling it from the
+ * UART driver if it's empty.
+ */
+static inline uint8_t ring_get_byte(void) {
+    if (g_ring.read_pos == g_ring.write_pos)
+        ring_fill();
+
+    return g_ring.data[g_ring.read_pos++ & SERIAL_UART_RING_MASK];
+}
+
+/*
+ * Is the specified character a field separator in a record?
+ */
+static inline bool is_field_separator(char c) {
+    return c == ',' || isspace((unsigned char)c);
+}
+
+/*
+ * Parse the fields of the specified null-terminated record, storing up to
+ * 'max_fields' values in 'dst'. Returns the number of fields in the record, or
+ * -1 if any of them is not a valid number. Note that the returned count might
+ * be greater than 'max_fields', in which case the extra fields are not stored.
+ */
+static int parse_record(const char* record, float* dst, int max_fields) {
+    int num_fields = 0;
+
+    for (;;) {
+        /* Skip separators before the field */
+        while (is_field_separator(*record))
+            record++;
+        if (*record == '\0')
+            break;
+
+        /* Convert the field, which must end at a separator */
+        const char* endptr;
+        float result;
+        if (!decimal_parse(record, &endptr, &result) ||
+            (*endptr != '\0' && !is_field_separator(*endptr)))
+            return -1;
+
+        if (num_fields < max_fields)
+            dst[num_fields] = result;
+        num_fields++;
+
+        record = endptr;
+    }
+
+    return num_fields;
+}
+
+/*
+ * Decode the specified COBS-encoded binary frame, storing its 'num_values'
+ * values in 'dst'. Returns true on success, or false if the frame is invalid.
+ * The sequence number of the frame is used for counting lost frames.
+ */
+static bool parse_frame(const uint8_t* encoded,
+                        size_t encoded_size,
+                        float* dst,
+                        int num_values) {
+    uint16_t sequence;
+    if (!frame_decode_sample(encoded, encoded_size, dst, num_values, &sequence))
+        return false;
+
+    if (g_has_last_sequence)
+        g_stats.frames_lost += (uint16_t)(sequence - g_last_sequence - 1);
+
+    g_last_sequence     = sequence;
+    g_has_last_sequence = true;
+    return true;
+}
 
 /*----------------------------------------------------------------------------*/
 
@@ -58,66 +289,126 @@ void serial_uart_init(void) {
     uart_driver_install(SERIAL_UART_NUM,
                         SERIAL_UART_RX_BUF_SIZE,
                         0,
-                        0,
-                        NULL,
+                        SERIAL_UART_EVENT_QUEUE_SIZE,
+                        &g_event_queue,
                         0);
+
+    /*
+     * Detect single newline characters, so the driver sends an event once a
+     * complete ASCII record has been received.
+     */
+    uart_enable_pattern_det_baud_intr(SERIAL_UART_NUM, '\n', 1, 9, 0, 0);
+    uart_pattern_queue_reset(SERIAL_UART_NUM, SERIAL_UART_PATTERN_QUEUE_SIZE);
 }
 
-bool serial_uart_read_value(float* dst) {
-    /* Buffer used to store digits of the input string */
-    static char digit_buffer[64];
-    size_t digit_buffer_pos = 0;
+bool serial_uart_read_record(float* dst, int num_values) {
+    /* Buffer used to store the bytes of the current record */
+    static uint8_t record_buffer[256];
+    size_t record_buffer_pos = 0;
+    bool record_overflowed   = false;
+
+    assert(num_values > 0 && num_values <= SERIAL_UART_MAX_FIELDS);
 
-    const int uart_timeout_ticks =
-      SERIAL_UART_RX_TIMEOUT_MS / portTICK_PERIOD_MS;
+    /*
+     * Number of data loss events before receiving this record. If it changes,
+     * part of the record was lost, so it must be rejected.
+     */
+    const unsigned overflows_before =
+      g_stats.fifo_overflows + g_stats.buffer_overflows;
 
     for (;;) {
         /*
-         * Read data from UART, one byte at a time, with a maximum timeout.
-         *
-         * TODO: Is the timeout even needed, if we just 'continue' on failure?
+         * Get the next byte from the local ring buffer, which is refilled in
+         * bulk from the UART driver when necessary.
          */
-        uint8_t byte;
-        const int len =
-          uart_read_bytes(SERIAL_UART_NUM, &byte, 1, uart_timeout_ticks);
-        if (len <= 0)
-            continue;
+        const uint8_t byte = ring_get_byte();
 
         /*
-         * Check if we reached a value delimiter (space, newline, etc.). If they
-         * appear before the value, ignore them and keep reading. If they appear
-         * after the value, we are done.
+         * A zero byte never appears in ASCII records, but it delimits every
+         * binary frame, so receiving one switches to binary mode. Whatever was
+         * received before the first delimiter is discarded.
          */
-        if (isspace(byte)) {
-            if (digit_buffer_pos == 0)
+        if (byte == FRAME_DELIMITER) {
+            if (g_mode != SERIAL_MODE_BINARY) {
+                g_mode            = SERIAL_MODE_BINARY;
+                record_buffer_pos = 0;
+                record_overflowed = false;
                 continue;
-            else
-                break;
+            }
+
+            if (record_buffer_pos == 0 && !record_overflowed)
+                continue;
+            break;
         }
 
         /*
-         * If we are still trying to read a value, but there is no space left on
-         * the buffer, abort.
+         * Outside of binary mode, a newline terminates the record. Empty lines
+         * are not considered records, so they are ignored.
          */
-        if (digit_buffer_pos >= LENGTH(digit_buffer) - 1)
-            return false;
+        if (g_mode != SERIAL_MODE_BINARY && byte == '\n') {
+            if (record_buffer_pos == 0 && !record_overflowed)
+                continue;
+            break;
+        }
+
+        /*
+         * If the record doesn't fit in the buffer, keep consuming bytes until
+         * its delimiter, so the next record starts at the right position.
+         *
+         * In binary mode, no frame is this large, so the sender probably
+         * switched back to ASCII records, which never contain the delimiter.
+         * In that case, go back to parsing ASCII records, although the format
+         * is unknown until one of them is valid; the rest of the current line
+         * will be rejected as a single malformed record.
+         */
+        if (record_buffer_pos >= LENGTH(record_buffer) - 1) {
+            record_overflowed = true;
+            if (g_mode == SERIAL_MODE_BINARY) {
+                g_mode            = SERIAL_MODE_UNKNOWN;
+                record_buffer_pos = 0;
+            }
+            continue;
+        }
 
-        /* Store the current digit in the buffer */
-        digit_buffer[digit_buffer_pos++] = byte;
+        record_buffer[record_buffer_pos++] = byte;
     }
 
-    /* Null-terminate the read number */
-    digit_buffer[digit_buffer_pos] = '\0';
+    /*
+     * Parse into a temporary array, so 'dst' is only modified if the whole
+     * record is valid.
+     */
+    float fields[SERIAL_UART_MAX_FIELDS];
+    bool valid = !record_overflowed &&
+                 g_stats.fifo_overflows + g_stats.buffer_overflows ==
+                   overflows_before;
+    if (valid && g_mode == SERIAL_MODE_BINARY) {
+        valid = parse_frame(record_buffer,
+                            record_buffer_pos,
+                            fields,
+                            num_values);
+    } else if (valid) {
+        /* Null-terminate the read record */
+        record_buffer[record_buffer_pos] = '\0';
+        valid = parse_record((const char*)record_buffer, fields, num_values) ==
+                num_values;
 
-    /* Convert the string to a double */
-    errno = 0;
-    char* endptr;
-    const float result = strtod(digit_buffer, &endptr);
+        /* A valid ASCII record confirms the format of the sender */
+        if (valid)
+            g_mode = SERIAL_MODE_ASCII;
+    }
 
-    /* Check if the type conversion failed */
-    if (endptr == digit_buffer || errno == ERANGE)
+    if (!valid) {
+        g_stats.records_rejected++;
         return false;
+    }
 
-    *dst = result;
+    for (int i = 0; i < num_values; i++)
+        dst[i] = fields[i];
+
+    g_stats.records_accepted++;
     return true;
 }
+
+void serial_uart_get_stats(SerialUartStats* dst) {
+    *dst = g_stats;
+}
@@ -21,6 +21,35 @@
 
 #include <stdbool.h>
 
+/*
+ * Statistics about the data received through the serial port.
+ */
+typedef struct SerialUartStats {
+    /* Number of records that were parsed successfully */
+    unsigned records_accepted;
+
+    /* Number of malformed records that were discarded */
+    unsigned records_rejected;
+
+    /*
+     * Number of binary frames that never arrived, according to the gaps in
+     * their sequence numbers.
+     */
+    unsigned frames_lost;
+
+    /*
+     * Number of times received data was lost because the hardware FIFO or the
+     * driver's ring buffer overflowed, respectively.
+     */
+    unsigned fifo_overflows;
+    unsigned buffer_overflows;
+
+    /* Number of bytes received with framing errors */
+    unsigned frame_errors;
+} SerialUartStats;
+
+/*----------------------------------------------------------------------------*/
+
 /*
  * Initialize UART zero of the ESP for data communication.
  *
@@ -30,13 +59,31 @@
 void serial_uart_init(void);
 
 /*
- * Read a whitespace-separated float value from the previously-initialized UART,
- * and write it to 'dst'. This function returns true on success, or false on
- * failure.
+ * Read a complete record from the previously-initialized UART, and write its
+ * 'num_values' fields to 'dst'.
  *
- * Any whitespace is considered a value separator, as matched by the 'isspace'
+ * Records can either be newline-terminated ASCII lines, or binary frames as
+ * described in 'frame.h'. The format is detected automatically: the zero byte
+ * that delimits binary frames switches to binary mode, and receiving more data
+ * than fits in a frame switches back to ASCII mode. In ASCII records, fields
+ * can be separated by commas or whitespace, as matched by the 'isspace'
  * function from the 'ctype.h' header.
+ *
+ * This function sleeps until the UART driver reports that a record might be
+ * available, so it doesn't consume CPU time while waiting.
+ *
+ * Records are accepted or rejected as a single unit: if the record doesn't
+ * contain exactly 'num_values' valid numbers, or if part of it was lost
+ * because the receive buffers overflowed, this function returns false and
+ * 'dst' is left untouched. Otherwise, it returns true. Since a malformed record
+ * is always consumed up to its delimiter, a corrupted field can't shift the
+ * values of the following records into the wrong channels.
+ */
+bool serial_uart_read_record(float* dst, int num_values);
+
+/*
+ * Get a copy of the current statistics of the serial communication.
  */
-bool serial_uart_read_value(float* dst);
+void serial_uart_get_stats(SerialUartStats* dst);
 
 #endif /* SERIAL_UART_H_ */
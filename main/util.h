@@ -24,4 +24,17 @@
  */
 #define LENGTH(ARR) (sizeof(ARR) / sizeof((ARR)[0]))
 
+/*
+ * Return the smallest or largest of two values. Note that the arguments might
+ * be evaluated more than once.
+ */
+#define MIN(A, B) (((A) < (B)) ? (A) : (B))
+#define MAX(A, B) (((A) > (B)) ? (A) : (B))
+
+/*
+ * Divide two non-negative integers, rounding up. Note that the divisor is
+ * evaluated twice.
+ */
+#define DIV_CEIL(A, B) (((A) + (B) - 1) / (B))
+
 #endif /* UTIL_H_ */
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Cost of finding the extremes of the chart history after each push: the
+ * monotonic deques updated by 'chart_push', against scanning every column, for
+ * several history sizes. Both include the cost of 'chart_push' itself.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "chart.h"
+#include "test.h"
+#include "util.h"
+
+#define NUM_CHANNELS 4
+#define NUM_PUSHES   100000
+
+#define DISPLAY_HEIGHT 240
+#define SHRINK_DWELL   10
+
+/*----------------------------------------------------------------------------*/
+
+static void make_values(int i, uint64_t* state, float* values) {
+    values[0] = 3000.f + 2000.f * sinf(i * 0.003f);
+    values[1] = 60.f + (float)(test_random(state) % 40);
+    values[2] = 90.f + 0.01f * (i % 1000);
+    values[3] = (float)(test_random(state) % 100);
+}
+
+/*
+ * Scan every column of each channel for its extremes, like the chart did
+ * before the deques. Returns their sum, so the scan is not optimized out.
+ */
+static float scan_extremes(const ChartCtx* ctx) {
+    float sum = 0.f;
+    for (int channel = 0; channel < ctx->num_channels; channel++) {
+        const float* mins = &ctx->mins[ctx->history_size * channel];
+        const float* maxs = &ctx->maxs[ctx->history_size * channel];
+
+        float min = INFINITY;
+        float max = -INFINITY;
+        for (int pos = 0; pos < ctx->history_size; pos++) {
+            min = fminf(min, mins[pos]);
+            max = fmaxf(max, maxs[pos]);
+        }
+        sum += min + max;
+    }
+    return sum;
+}
+
+/*
+ * Push the same values into a chart of the specified history size, finding
+ * the extremes with the deques or by scanning. Returns the time per push, in
+ * nanoseconds.
+ */
+static double bench_extremes(int history_size, bool scan) {
+    ChartCtx ctx;
+    chart_init(&ctx,
+               NUM_CHANNELS,
+               history_size,
+               DISPLAY_HEIGHT,
+               SHRINK_DWELL,
+               1,
+               NULL);
+
+    uint64_t state = 1;
+    float values[NUM_CHANNELS];
+    volatile float sink = 0.f;
+
+    const double start = test_get_time();
+    for (int i = 0; i < NUM_PUSHES; i++) {
+        make_values(i, &state, values);
+        chart_push(&ctx, i, values, NUM_CHANNELS);
+        if (scan)
+            sink += scan_extremes(&ctx);
+        else
+            chart_update_minmax(&ctx);
+    }
+    const double elapsed = test_get_time() - start;
+    (void)sink;
+
+    chart_destroy(&ctx);
+    return elapsed / NUM_PUSHES * 1e9;
+}
+
+int main(void) {
+    static const int history_sizes[] = { 320, 1280, 5120, 20480 };
+
+    printf("%8s %14s %14s\n", "History", "Deques", "Scan");
+    for (size_t i = 0; i < LENGTH(history_sizes); i++)
+        printf("%8d %11.0f ns %11.0f ns\n",
+               history_sizes[i],
+               bench_extremes(history_sizes[i], false),
+               bench_extremes(history_sizes[i], true));
+    return 0;
+}
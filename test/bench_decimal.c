@@ -0,0 +1,76 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Microbenchmark of 'decimal_parse' against 'strtof', with the error checks
+ * that the serial reader used to do, on fields like the ones sent through the
+ * serial port.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "decimal.h"
+#include "test.h"
+#include "util.h"
+
+#define NUM_ROUNDS 2000000
+
+int main(void) {
+    static const char* const fields[] = {
+        "812.25", "2500", "-40", "87", "13.9", "0.5", "100.0", "-273.15",
+        "6000.75", "42",
+    };
+
+    /* Sum the results, so the compiler can't drop the calls */
+    double strtof_sum = 0;
+    double start      = test_get_time();
+    for (int i = 0; i < NUM_ROUNDS; i++) {
+        for (size_t j = 0; j < LENGTH(fields); j++) {
+            errno = 0;
+            char* end;
+            const float value = strtof(fields[j], &end);
+            if (end != fields[j] && errno != ERANGE)
+                strtof_sum += value;
+        }
+    }
+    const double strtof_time = test_get_time() - start;
+
+    double decimal_sum = 0;
+    start              = test_get_time();
+    for (int i = 0; i < NUM_ROUNDS; i++) {
+        for (size_t j = 0; j < LENGTH(fields); j++) {
+            const char* end;
+            float value;
+            if (decimal_parse(fields[j], &end, &value))
+                decimal_sum += value;
+        }
+    }
+    const double decimal_time = test_get_time() - start;
+
+    CHECK(strtof_sum == decimal_sum);
+
+    const double num_values = (double)NUM_ROUNDS * LENGTH(fields);
+    printf("strtof:        %6.2f ns per value\n",
+           strtof_time / num_values * 1e9);
+    printf("decimal_parse: %6.2f ns per value\n",
+           decimal_time / num_values * 1e9);
+    printf("Speedup: %.1fx\n", strtof_time / decimal_time);
+    return 0;
+}
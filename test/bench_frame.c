@@ -0,0 +1,145 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Throughput of the serial record formats: the same OBD-like samples are sent
+ * as ASCII records, float frames and integer frames. For each format, report
+ * the bytes per sample, the samples per second that fit in the baud rate, and
+ * how fast 'serial_uart_read_record' reads them through the fake UART driver.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "serial_uart.h"
+#include "fake_uart.h"
+#include "frame_encoder.h"
+#include "test.h"
+
+#define NUM_CHANNELS 4
+#define NUM_SAMPLES  200000
+
+/*
+ * Baud rate of the serial port, and bits sent for each byte (with a start and
+ * a stop bit).
+ */
+#define BAUD_RATE     115200
+#define BITS_PER_BYTE 10
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Format of the benchmarked stream.
+ */
+enum Format {
+    FORMAT_ASCII,
+    FORMAT_F32,
+    FORMAT_I16,
+};
+
+/*
+ * Write the 'NUM_SAMPLES' samples in the specified format to a new buffer, and
+ * store its size in 'size'. The values have a decimal, like vehicle speed,
+ * coolant temperature, throttle position and battery voltage.
+ */
+static uint8_t* generate_stream(enum Format format, size_t* size) {
+    const size_t capacity = (size_t)NUM_SAMPLES * 64;
+    uint8_t* stream       = malloc(capacity);
+    CHECK(stream != NULL);
+
+    uint64_t state = 1;
+    size_t pos     = 0;
+    if (format != FORMAT_ASCII)
+        stream[pos++] = 0;
+
+    for (int i = 0; i < NUM_SAMPLES; i++) {
+        const double t = i * 0.01;
+        const int16_t raw[NUM_CHANNELS] = {
+            (int16_t)(600 + 400 * sin(t * 0.3)),
+            (int16_t)(850 + test_random(&state) % 30),
+            (int16_t)(300 + 250 * sin(t)),
+            (int16_t)(138 + test_random(&state) % 5),
+        };
+
+        float values[NUM_CHANNELS];
+        for (int j = 0; j < NUM_CHANNELS; j++)
+            values[j] = raw[j] / 10.f;
+
+        switch (format) {
+            case FORMAT_ASCII:
+                pos += snprintf((char*)&stream[pos],
+                                capacity - pos,
+                                "%.1f %.1f %.1f %.1f\n",
+                                values[0],
+                                values[1],
+                                values[2],
+                                values[3]);
+                break;
+
+            case FORMAT_F32:
+                pos += frame_encode_f32(values, NUM_CHANNELS, i, &stream[pos]);
+                break;
+
+            case FORMAT_I16:
+                pos += frame_encode_i16(raw,
+                                        NUM_CHANNELS,
+                                        -1,
+                                        i,
+                                        &stream[pos]);
+                break;
+        }
+    }
+
+    *size = pos;
+    return stream;
+}
+
+static void bench_format(enum Format format, const char* name) {
+    size_t size;
+    uint8_t* stream = generate_stream(format, &size);
+
+    fake_uart_set_input(stream, size, 120);
+    const double start = test_get_time();
+    for (int i = 0; i < NUM_SAMPLES; i++) {
+        float values[NUM_CHANNELS];
+        CHECK(serial_uart_read_record(values, NUM_CHANNELS));
+    }
+    const double elapsed = test_get_time() - start;
+
+    const double bytes_per_sample = (double)size / NUM_SAMPLES;
+    printf("%-14s %5.1f bytes per sample, %6.0f samples/s at %d baud, "
+           "read at %5.2f M samples/s\n",
+           name,
+           bytes_per_sample,
+           BAUD_RATE / (BITS_PER_BYTE * bytes_per_sample),
+           BAUD_RATE,
+           NUM_SAMPLES / elapsed * 1e-6);
+
+    free(stream);
+}
+
+int main(void) {
+    serial_uart_init();
+
+    bench_format(FORMAT_ASCII, "ASCII records");
+    bench_format(FORMAT_F32, "Float frames");
+    bench_format(FORMAT_I16, "Integer frames");
+    return 0;
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Memory traffic of preparing the framebuffer for each frame of a scrolling
+ * chart: clearing it with 'render_clear', against erasing the spans of the
+ * previous frame with 'render_erase'. For each, report the cleared pixels (one
+ * byte each) and the time of drawing a frame, including the clearing. The
+ * frames of both must be identical.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "chart.h"
+#include "render.h"
+#include "fake_lcd.h"
+#include "test.h"
+
+#define WIDTH        FAKE_LCD_WIDTH
+#define HEIGHT       FAKE_LCD_HEIGHT
+#define NUM_CHANNELS 4
+#define NUM_FRAMES   3000
+
+/*----------------------------------------------------------------------------*/
+
+typedef struct BenchCtx {
+    ChartCtx chart;
+    bool erase;
+} BenchCtx;
+
+/*
+ * Prepare the framebuffer and draw the chart, as a 'RenderDrawFunc'.
+ */
+static void draw_chart(RenderCtx* render_ctx, void* arg) {
+    const BenchCtx* ctx = arg;
+    if (ctx->erase)
+        render_erase(render_ctx);
+    else
+        render_clear(render_ctx);
+    chart_render(&ctx->chart, render_ctx);
+}
+
+static uint64_t hash_framebuffer(const RenderCtx* ctx) {
+    uint64_t hash = UINT64_C(14695981039346656037);
+    for (size_t i = 0; i < ctx->width * ctx->height; i++)
+        hash = (hash ^ ctx->framebuffer[i]) * UINT64_C(1099511628211);
+    return hash;
+}
+
+/*
+ * Render 'NUM_FRAMES' frames of a chart with a new sample each, storing the
+ * hash of each frame in 'hashes'. Prints the average cleared pixels and
+ * drawing time per frame.
+ */
+static void bench_frames(bool erase, uint64_t* hashes) {
+    RenderCtx render_ctx;
+    render_init(&render_ctx, WIDTH, HEIGHT, RENDER_FRAMEBUFFER);
+    chart_set_colors(&render_ctx, 1.f);
+
+    BenchCtx ctx = { .erase = erase };
+    chart_init(&ctx.chart, NUM_CHANNELS, WIDTH, HEIGHT, 100, 1, NULL);
+
+    uint64_t state        = 1;
+    double elapsed        = 0.0;
+    size_t cleared_pixels = 0;
+    for (int i = 0; i < NUM_FRAMES; i++) {
+        float values[NUM_CHANNELS];
+        for (int j = 0; j < NUM_CHANNELS; j++)
+            values[j] = 100.f * sinf(i * 0.05f * (j + 1)) + j * 50.f +
+                        (float)(test_random(&state) % 40);
+        chart_push(&ctx.chart, i, values, NUM_CHANNELS);
+        chart_update_minmax(&ctx.chart);
+
+        const double start = test_get_time();
+        render_area(&render_ctx, 0, 0, WIDTH, HEIGHT, draw_chart, &ctx);
+        elapsed += test_get_time() - start;
+
+        render_flush(&render_ctx);
+        cleared_pixels += render_ctx.last_flush_cleared_pixels;
+        hashes[i] = hash_framebuffer(&render_ctx);
+    }
+
+    printf("%-6s %6zu pixels cleared per frame (%5.1f%% of the screen), "
+           "%5.1f us per frame\n",
+           erase ? "Erase:" : "Clear:",
+           cleared_pixels / NUM_FRAMES,
+           100.0 * cleared_pixels / NUM_FRAMES / (WIDTH * HEIGHT),
+           elapsed / NUM_FRAMES * 1e6);
+
+    chart_destroy(&ctx.chart);
+    render_destroy(&render_ctx);
+}
+
+int main(void) {
+    static uint64_t clear_hashes[NUM_FRAMES];
+    static uint64_t erase_hashes[NUM_FRAMES];
+    bench_frames(false, clear_hashes);
+    bench_frames(true, erase_hashes);
+
+    for (int i = 0; i < NUM_FRAMES; i++)
+        CHECK(erase_hashes[i] == clear_hashes[i]);
+    return 0;
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Speed of drawing chart traces into the framebuffer: a 'render_draw_line'
+ * call for each pair of consecutive points, against a single
+ * 'render_draw_trace' call per channel, which fills a vertical span per
+ * column. Both are timed for a smooth signal, whose spans are short, and for a
+ * noisy one, whose spans are tall.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "render.h"
+#include "fake_lcd.h"
+#include "test.h"
+
+#define WIDTH        FAKE_LCD_WIDTH
+#define HEIGHT       FAKE_LCD_HEIGHT
+#define NUM_CHANNELS 4
+#define NUM_FRAMES   5000
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Fill the Y coordinates of each channel, for a smooth or a noisy signal.
+ */
+static void make_ys(int16_t ys[NUM_CHANNELS][WIDTH], bool noisy) {
+    uint64_t state = 1;
+    for (int i = 0; i < NUM_CHANNELS; i++) {
+        for (int x = 0; x < WIDTH; x++) {
+            const float center = HEIGHT / 2.f + 80.f * sinf(x * 0.02f + i);
+            const float noise =
+              noisy ? (float)(test_random(&state) % 120) - 60.f : 0.f;
+            ys[i][x] = (int16_t)fmaxf(0.f, fminf(HEIGHT - 1, center + noise));
+        }
+    }
+}
+
+/*
+ * Draw the traces of each channel for 'NUM_FRAMES' frames, clearing the
+ * framebuffer before each one. Returns the drawing time per frame, without
+ * the clearing, in microseconds.
+ */
+static double bench_traces(RenderCtx* ctx,
+                           int16_t ys[NUM_CHANNELS][WIDTH],
+                           bool use_lines) {
+    double elapsed = 0.0;
+    for (int frame = 0; frame < NUM_FRAMES; frame++) {
+        render_clear(ctx);
+
+        const double start = test_get_time();
+        for (int i = 0; i < NUM_CHANNELS; i++) {
+            const uint8_t color = 1 + i;
+            if (use_lines) {
+                for (int x = 1; x < WIDTH; x++)
+                    render_draw_line(ctx,
+                                     x - 1,
+                                     ys[i][x - 1],
+                                     x,
+                                     ys[i][x],
+                                     color);
+            } else {
+                render_draw_trace(ctx, 0, ys[i], WIDTH, color);
+            }
+        }
+        elapsed += test_get_time() - start;
+    }
+
+    /* Both paths go through every point of the last channel */
+    for (int x = 1; x < WIDTH; x++)
+        CHECK(ctx->framebuffer[ys[NUM_CHANNELS - 1][x] * WIDTH + x] ==
+              NUM_CHANNELS);
+
+    return elapsed / NUM_FRAMES * 1e6;
+}
+
+int main(void) {
+    RenderCtx ctx;
+    render_init(&ctx, WIDTH, HEIGHT, RENDER_FRAMEBUFFER);
+
+    static int16_t ys[NUM_CHANNELS][WIDTH];
+    for (int noisy = 0; noisy <= 1; noisy++) {
+        make_ys(ys, noisy);
+        const double lines_us = bench_traces(&ctx, ys, true);
+        const double trace_us = bench_traces(&ctx, ys, false);
+        printf("%-6s signal: lines %6.1f us/frame, traces %6.1f us/frame "
+               "(%.1fx)\n",
+               noisy ? "Noisy" : "Smooth",
+               lines_us,
+               trace_us,
+               lines_us / trace_us);
+    }
+
+    render_destroy(&ctx);
+    return 0;
+}
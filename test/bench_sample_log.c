@@ -0,0 +1,319 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Compression ratio and decoding speed of 'SampleLog', on a synthetic drive of
+ * OBD-II signals sampled at 20 Hz, or on a recorded log:
+ *
+ *   ./bench_sample_log
+ *   ./bench_sample_log records.txt
+ *
+ * A recorded log has a sample per line, with values separated by spaces or
+ * commas, like the ASCII records of the serial input. Its samples are
+ * timestamped at 20 Hz.
+ *
+ * Each signal is logged alone, and then all of them together, with steady
+ * timestamps and with a jitter of up to 1 ms. The ratio is against storing
+ * each sample as a 64-bit timestamp and 32-bit floats, and the size includes
+ * the unused end of each block and the block summaries.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sample_log.h"
+#include "elm327.h"
+#include "test.h"
+#include "util.h"
+
+#define NUM_SYNTHETIC_SAMPLES 100000
+
+/*
+ * Sampling period and maximum jitter of the timestamps, in microseconds.
+ */
+#define SAMPLE_PERIOD_US 50000
+#define MAX_JITTER_US    1000
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Signals of the synthetic drive, decoded with the format of their PID.
+ */
+enum Signal {
+    SIGNAL_COOLANT,
+    SIGNAL_FUEL,
+    SIGNAL_INTAKE,
+    SIGNAL_SPEED,
+    SIGNAL_RPM,
+    SIGNAL_THROTTLE,
+    NUM_SIGNALS,
+};
+
+static const struct {
+    const char* name;
+    uint8_t pid;
+} signals[NUM_SIGNALS] = {
+    [SIGNAL_COOLANT]  = { "Coolant",     ELM327_PID_COOLANT_TEMP },
+    [SIGNAL_FUEL]     = { "Fuel level",  ELM327_PID_FUEL_LEVEL },
+    [SIGNAL_INTAKE]   = { "Intake temp", ELM327_PID_INTAKE_TEMP },
+    [SIGNAL_SPEED]    = { "Speed",       ELM327_PID_VEHICLE_SPEED },
+    [SIGNAL_RPM]      = { "RPM",         ELM327_PID_ENGINE_RPM },
+    [SIGNAL_THROTTLE] = { "Throttle",    ELM327_PID_THROTTLE },
+};
+
+/*
+ * Samples being benchmarked, with their values in sample-major order.
+ */
+typedef struct Samples {
+    int num_channels;
+    int num_samples;
+    int64_t* timestamps;
+    float* values;
+} Samples;
+
+/*
+ * Sum of the decoded values, so the decoding is not optimized out.
+ */
+static volatile float g_sink;
+
+/*----------------------------------------------------------------------------*/
+
+static void samples_alloc(Samples* samples, int num_channels, int num_samples) {
+    const size_t num_values = (size_t)num_samples * num_channels;
+    samples->num_channels   = num_channels;
+    samples->num_samples    = num_samples;
+    samples->timestamps     = malloc(num_samples * sizeof(int64_t));
+    samples->values         = malloc(num_values * sizeof(float));
+    CHECK(samples->timestamps != NULL && samples->values != NULL);
+}
+
+static void samples_free(Samples* samples) {
+    free(samples->timestamps);
+    free(samples->values);
+}
+
+/*
+ * Set the timestamps of the samples at 'SAMPLE_PERIOD_US', with a random
+ * jitter of up to the specified one.
+ */
+static void set_timestamps(Samples* samples, int jitter_us, uint64_t* state) {
+    for (int i = 0; i < samples->num_samples; i++) {
+        samples->timestamps[i] = (int64_t)i * SAMPLE_PERIOD_US;
+        if (jitter_us > 0)
+            samples->timestamps[i] +=
+              (int64_t)(test_random(state) % (2 * jitter_us + 1)) - jitter_us;
+    }
+}
+
+/*
+ * Generate the raw OBD values of a drive: the engine warms up, and the car
+ * drives at varying speeds, with stops.
+ */
+static void generate_raw(int i, uint64_t* state, int32_t* raw) {
+    const uint64_t noise = test_random(state);
+    const double t       = i * (SAMPLE_PERIOD_US * 1e-6);
+    const double cruise  = 60 + 40 * sin(t / 300);
+    const double accel   = sin(t / 20);
+    const bool stopped   = fmod(t, 600) < 40;
+    const double speed   = stopped ? 0 : fmax(0, cruise + 15 * accel);
+    const double rpm     = stopped ? 800 : 900 + speed * 28 + 300 * accel;
+    const double pedal   = stopped ? 0 : 40 + 60 * accel + (noise >> 40) % 6;
+
+    raw[SIGNAL_COOLANT]  = 40 + (int)fmin(90, 20 + t / 8) + (noise % 97 == 0);
+    raw[SIGNAL_FUEL]     = 200 - (int)(t / 90) + (noise % 211 == 0);
+    raw[SIGNAL_INTAKE]   = 70 + (int)(5 * sin(t / 900)) + (noise % 53 == 0);
+    raw[SIGNAL_SPEED]    = (int)speed;
+    raw[SIGNAL_RPM]      = 4 * (int)rpm + (int)((noise >> 32) % 8);
+    raw[SIGNAL_THROTTLE] = (int)fmax(0, fmin(255, pedal));
+}
+
+/*
+ * Generate the synthetic drive, with a channel per signal.
+ */
+static void generate_drive(Samples* samples) {
+    samples_alloc(samples, NUM_SIGNALS, NUM_SYNTHETIC_SAMPLES);
+
+    float scales[NUM_SIGNALS], offsets[NUM_SIGNALS];
+    for (int j = 0; j < NUM_SIGNALS; j++)
+        CHECK(elm327_get_pid_format(signals[j].pid, &scales[j], &offsets[j]));
+
+    uint64_t state = 1;
+    for (int i = 0; i < samples->num_samples; i++) {
+        int32_t raw[NUM_SIGNALS];
+        generate_raw(i, &state, raw);
+        for (int j = 0; j < NUM_SIGNALS; j++)
+            samples->values[i * NUM_SIGNALS + j] =
+              (uint32_t)raw[j] * scales[j] + offsets[j];
+    }
+}
+
+/*
+ * Read a recorded log with a sample per line. The number of channels is the
+ * number of values of the first line, and lines with a different number of
+ * values are skipped.
+ */
+static void read_recorded(Samples* samples, const char* path) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+
+    int capacity = 1024;
+    samples_alloc(samples, SAMPLE_LOG_MAX_CHANNELS, capacity);
+    samples->num_channels = 0;
+    samples->num_samples  = 0;
+
+    char line[1024];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        float values[SAMPLE_LOG_MAX_CHANNELS];
+        int num_values = 0;
+        for (char* field = strtok(line, ", \t\r\n");
+             field != NULL && num_values < SAMPLE_LOG_MAX_CHANNELS;
+             field = strtok(NULL, ", \t\r\n"))
+            values[num_values++] = strtof(field, NULL);
+        if (num_values == 0)
+            continue;
+        if (samples->num_channels == 0)
+            samples->num_channels = num_values;
+        if (num_values != samples->num_channels)
+            continue;
+
+        if (samples->num_samples == capacity) {
+            capacity *= 2;
+            const size_t values_size =
+              (size_t)capacity * SAMPLE_LOG_MAX_CHANNELS * sizeof(float);
+            samples->values = realloc(samples->values, values_size);
+            samples->timestamps =
+              realloc(samples->timestamps, capacity * sizeof(int64_t));
+            CHECK(samples->values != NULL && samples->timestamps != NULL);
+        }
+
+        memcpy(&samples->values[samples->num_samples * num_values],
+               values,
+               num_values * sizeof(float));
+        samples->num_samples++;
+    }
+
+    fclose(file);
+    CHECK(samples->num_samples > 0);
+}
+
+/*
+ * Copy a channel of the specified samples, with their timestamps.
+ */
+static void extract_channel(const Samples* src, int channel, Samples* dst) {
+    samples_alloc(dst, 1, src->num_samples);
+    for (int i = 0; i < src->num_samples; i++) {
+        dst->timestamps[i] = src->timestamps[i];
+        dst->values[i]     = src->values[i * src->num_channels + channel];
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Log the specified samples into a log that holds all of them, and print the
+ * compression ratio and the decoding speed.
+ */
+static void bench_log(const char* name, const Samples* samples) {
+    const int num_channels = samples->num_channels;
+    const int num_samples  = samples->num_samples;
+    const size_t raw_bytes =
+      (size_t)num_samples * (sizeof(int64_t) + num_channels * sizeof(float));
+
+    SampleLog log;
+    sample_log_init(&log, num_channels, 2 * raw_bytes);
+    for (int i = 0; i < num_samples; i++)
+        sample_log_append(&log,
+                          samples->timestamps[i],
+                          &samples->values[i * num_channels]);
+    CHECK(log.num_samples == num_samples);
+
+    int64_t num_bits = 0;
+    for (int i = 0; i < log.num_used_blocks; i++)
+        num_bits += log.blocks[i].num_bits;
+    const size_t used_bytes =
+      log.num_used_blocks * (SAMPLE_LOG_BLOCK_SIZE + sizeof(SampleLogBlock));
+
+    /* Decode everything, checking it on a separate pass */
+    SampleLogReader reader;
+    sample_log_seek(&reader, &log, 0);
+    int64_t timestamp;
+    float values[SAMPLE_LOG_MAX_CHANNELS];
+    const double start = test_get_time();
+    while (sample_log_read(&reader, &timestamp, values))
+        g_sink += values[0];
+    const double elapsed = test_get_time() - start;
+
+    sample_log_seek(&reader, &log, 0);
+    for (int i = 0; i < num_samples; i++) {
+        CHECK(sample_log_read(&reader, &timestamp, values));
+        CHECK(timestamp == samples->timestamps[i]);
+        CHECK(memcmp(values,
+                     &samples->values[i * num_channels],
+                     num_channels * sizeof(float)) == 0);
+    }
+
+    printf("%-28s %6.1f bits per sample, %5.1fx smaller, %6.0f samples per "
+           "KiB, decoded in %5.1f ns per sample\n",
+           name,
+           (double)num_bits / num_samples,
+           (double)raw_bytes / used_bytes,
+           num_samples / (used_bytes / 1024.0),
+           elapsed / num_samples * 1e9);
+
+    sample_log_destroy(&log);
+}
+
+int main(int argc, char** argv) {
+    Samples samples;
+    if (argc > 1)
+        read_recorded(&samples, argv[1]);
+    else
+        generate_drive(&samples);
+
+    uint64_t state = 1;
+    set_timestamps(&samples, 0, &state);
+    printf("%d samples of %d channels\n",
+           samples.num_samples,
+           samples.num_channels);
+
+    for (int i = 0; i < samples.num_channels; i++) {
+        Samples channel;
+        extract_channel(&samples, i, &channel);
+
+        char name[64];
+        if (argc > 1)
+            snprintf(name, sizeof(name), "Channel %d", i);
+        else
+            snprintf(name, sizeof(name), "%s", signals[i].name);
+        bench_log(name, &channel);
+        samples_free(&channel);
+    }
+
+    bench_log("All channels", &samples);
+    set_timestamps(&samples, MAX_JITTER_US, &state);
+    bench_log("All channels, with jitter", &samples);
+
+    samples_free(&samples);
+    return 0;
+}
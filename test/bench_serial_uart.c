@@ -0,0 +1,171 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Benchmark of the serial ingestion: a stream of ASCII records is read through
+ * the fake UART driver, with the original reader (one 'uart_read_bytes' call
+ * per byte, and 'strtod' for each value), and with 'serial_uart_read_record'.
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "driver/uart.h"
+
+#include "serial_uart.h"
+#include "fake_uart.h"
+#include "test.h"
+#include "util.h"
+
+#define NUM_CHANNELS 4
+#define NUM_RECORDS  200000
+
+/*
+ * Number of bytes that arrive at once, the default threshold of the UART
+ * hardware FIFO.
+ */
+#define CHUNK_SIZE 120
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Original reader of 'serial_uart.c', before the local ring buffer: read a
+ * single whitespace-delimited value, one byte at a time.
+ */
+static bool original_read_value(float* dst) {
+    static char digit_buffer[64];
+    size_t digit_buffer_pos = 0;
+
+    const int uart_timeout_ticks = 20 / portTICK_PERIOD_MS;
+
+    for (;;) {
+        uint8_t byte;
+        const int len =
+          uart_read_bytes(UART_NUM_0, &byte, 1, uart_timeout_ticks);
+        if (len <= 0)
+            continue;
+
+        if (isspace(byte)) {
+            if (digit_buffer_pos == 0)
+                continue;
+            else
+                break;
+        }
+
+        if (digit_buffer_pos >= LENGTH(digit_buffer) - 1)
+            return false;
+
+        digit_buffer[digit_buffer_pos++] = byte;
+    }
+
+    digit_buffer[digit_buffer_pos] = '\0';
+
+    errno = 0;
+    char* endptr;
+    const float result = strtod(digit_buffer, &endptr);
+    if (endptr == digit_buffer || errno == ERANGE)
+        return false;
+
+    *dst = result;
+    return true;
+}
+
+/*
+ * Write a stream of records resembling OBD data (engine speed, vehicle speed,
+ * coolant temperature and throttle position) to a new buffer, and store its
+ * size in 'size'.
+ */
+static char* generate_stream(size_t* size) {
+    const size_t capacity = NUM_RECORDS * 32;
+    char* stream          = malloc(capacity);
+    CHECK(stream != NULL);
+
+    uint64_t state = 1;
+    size_t pos     = 0;
+    for (int i = 0; i < NUM_RECORDS; i++) {
+        const double t        = i * 0.01;
+        const double rpm      = 2500 + 1500 * sin(t) + test_random(&state) % 64;
+        const int speed       = (int)(60 + 40 * sin(t * 0.3));
+        const int coolant     = 85 + (int)(test_random(&state) % 3);
+        const double throttle = (test_random(&state) % 1000) / 10.0;
+        pos += snprintf(&stream[pos],
+                        capacity - pos,
+                        "%.2f %d %d %.1f\n",
+                        floor(rpm * 4) / 4,
+                        speed,
+                        coolant,
+                        throttle);
+    }
+
+    *size = pos;
+    return stream;
+}
+
+int main(void) {
+    size_t stream_size;
+    char* stream = generate_stream(&stream_size);
+    printf("Stream: %d records, %zu bytes (%.1f bytes per value)\n",
+           NUM_RECORDS,
+           stream_size,
+           (double)stream_size / (NUM_RECORDS * NUM_CHANNELS));
+
+    serial_uart_init();
+
+    /* Both readers must return the same values, so compare their sums */
+    double original_sum = 0;
+    fake_uart_set_input(stream, stream_size, CHUNK_SIZE);
+    double start = test_get_time();
+    for (int i = 0; i < NUM_RECORDS * NUM_CHANNELS; i++) {
+        float value;
+        CHECK(original_read_value(&value));
+        original_sum += value;
+    }
+    const double original_time  = test_get_time() - start;
+    const size_t original_reads = fake_uart_get_num_reads();
+
+    double record_sum = 0;
+    fake_uart_set_input(stream, stream_size, CHUNK_SIZE);
+    start = test_get_time();
+    for (int i = 0; i < NUM_RECORDS; i++) {
+        float values[NUM_CHANNELS];
+        CHECK(serial_uart_read_record(values, NUM_CHANNELS));
+        for (int j = 0; j < NUM_CHANNELS; j++)
+            record_sum += values[j];
+    }
+    const double record_time  = test_get_time() - start;
+    const size_t record_reads = fake_uart_get_num_reads();
+
+    CHECK(original_sum == record_sum);
+
+    const double num_values = NUM_RECORDS * NUM_CHANNELS;
+    printf("Original reader:    %6.2f M values/s, %5.2f reads per value\n",
+           num_values / original_time * 1e-6,
+           original_reads / num_values);
+    printf("Ring buffer reader: %6.2f M values/s, %5.2f reads per value\n",
+           num_values / record_time * 1e-6,
+           record_reads / num_values);
+    printf("Speedup: %.1fx\n", original_time / record_time);
+
+    free(stream);
+    return 0;
+}
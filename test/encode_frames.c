@@ -0,0 +1,97 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Convert ASCII records, one per line, into binary sample frames. For example:
+ *
+ *   ./encode_frames < records.txt > /dev/ttyUSB0
+ *   ./encode_frames -e -2 < records.txt > /dev/ttyUSB0
+ *
+ * By default, 'FRAME_TYPE_F32' frames are written. With '-e EXPONENT',
+ * 'FRAME_TYPE_I16' frames are written instead, with each value rounded to a
+ * multiple of 10^EXPONENT.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h> /* getopt */
+
+#include "frame_encoder.h"
+
+#define MAX_VALUES 62
+
+int main(int argc, char** argv) {
+    bool use_i16 = false;
+    int exponent = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "e:")) != -1) {
+        if (opt != 'e') {
+            fprintf(stderr, "Usage: %s [-e EXPONENT] < INPUT\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+        use_i16  = true;
+        exponent = atoi(optarg);
+    }
+
+    uint16_t sequence = 0;
+    char line[1024];
+    while (fgets(line, sizeof(line), stdin) != NULL) {
+        float values[MAX_VALUES];
+        int num_values = 0;
+        for (char* field = strtok(line, ", \t\r\n");
+             field != NULL && num_values < MAX_VALUES;
+             field = strtok(NULL, ", \t\r\n"))
+            values[num_values++] = strtof(field, NULL);
+        if (num_values == 0)
+            continue;
+
+        uint8_t encoded[FRAME_ENCODER_MAX_SIZE];
+        size_t size;
+        if (use_i16) {
+            int16_t raw[MAX_VALUES];
+            for (int i = 0; i < num_values; i++) {
+                const double scaled = round(values[i] * pow(10, -exponent));
+                raw[i] = (int16_t)fmax(INT16_MIN, fmin(INT16_MAX, scaled));
+            }
+            size = frame_encode_i16(raw,
+                                    num_values,
+                                    exponent,
+                                    sequence,
+                                    encoded);
+        } else {
+            size = frame_encode_f32(values, num_values, sequence, encoded);
+        }
+
+        /*
+         * The receiver discards whatever it received before the first
+         * delimiter, so start with one.
+         */
+        if (sequence == 0)
+            fputc(0, stdout);
+
+        fwrite(encoded, 1, size, stdout);
+        sequence++;
+    }
+
+    return 0;
+}
@@ -0,0 +1,233 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "fake_lcd.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/gpio.h"
+#include "driver/spi_master.h"
+#include "esp_heap_caps.h"
+#include "esp_lcd_panel_io.h"
+#include "esp_lcd_panel_ops.h"
+#include "esp_lcd_ili9341.h"
+
+#include "test.h"
+
+/*
+ * Maximum capacity of the transfer queue.
+ */
+#define FAKE_LCD_MAX_QUEUE_DEPTH 64
+
+typedef struct Transfer {
+    int x0, y0, x1, y1;
+    const uint16_t* data;
+} Transfer;
+
+/* Pixels of the panel */
+static uint16_t g_pixels[FAKE_LCD_HEIGHT][FAKE_LCD_WIDTH];
+
+/* Queued transfers, and capacity of the queue set by the panel IO */
+static Transfer g_queue[FAKE_LCD_MAX_QUEUE_DEPTH];
+static size_t g_queue_read_pos = 0;
+static size_t g_queue_len      = 0;
+static size_t g_queue_depth    = 1;
+
+/* Completion callback of the panel IO */
+static esp_lcd_panel_io_color_trans_done_cb_t g_callback;
+static void* g_callback_ctx;
+
+/* Pending task notifications, and transfer statistics */
+static uint32_t g_notifications = 0;
+static size_t g_num_transfers   = 0;
+static size_t g_num_bytes       = 0;
+
+/* Any non-null pointer works as the handle of the only task and panel */
+static int g_handle;
+
+/*----------------------------------------------------------------------------*/
+
+static void complete_transfer(void) {
+    CHECK(g_queue_len > 0);
+    const Transfer* transfer = &g_queue[g_queue_read_pos];
+    g_queue_read_pos++;
+    if (g_queue_read_pos >= FAKE_LCD_MAX_QUEUE_DEPTH)
+        g_queue_read_pos = 0;
+    g_queue_len--;
+
+    const int width = transfer->x1 - transfer->x0;
+    for (int y = transfer->y0; y < transfer->y1; y++)
+        memcpy(&g_pixels[y][transfer->x0],
+               &transfer->data[(y - transfer->y0) * width],
+               width * sizeof(uint16_t));
+
+    g_num_transfers++;
+    g_num_bytes += width * (transfer->y1 - transfer->y0) * sizeof(uint16_t);
+    g_callback(NULL, NULL, g_callback_ctx);
+}
+
+void fake_lcd_complete_transfers(void) {
+    while (g_queue_len > 0)
+        complete_transfer();
+}
+
+uint16_t fake_lcd_get_pixel(int x, int y) {
+    return g_pixels[y][x];
+}
+
+size_t fake_lcd_get_num_transfers(void) {
+    return g_num_transfers;
+}
+
+size_t fake_lcd_get_num_bytes(void) {
+    return g_num_bytes;
+}
+
+/*----------------------------------------------------------------------------*/
+
+esp_err_t esp_lcd_panel_draw_bitmap(esp_lcd_panel_handle_t panel,
+                                    int x_start,
+                                    int y_start,
+                                    int x_end,
+                                    int y_end,
+                                    const void* color_data) {
+    CHECK(x_start >= 0 && x_start < x_end && x_end <= FAKE_LCD_WIDTH);
+    CHECK(y_start >= 0 && y_start < y_end && y_end <= FAKE_LCD_HEIGHT);
+
+    /* Like the SPI driver, block until there is room in the queue */
+    while (g_queue_len >= g_queue_depth)
+        complete_transfer();
+
+    const size_t pos = (g_queue_read_pos + g_queue_len) %
+                       FAKE_LCD_MAX_QUEUE_DEPTH;
+    g_queue[pos] = (Transfer){ x_start, y_start, x_end, y_end, color_data };
+    g_queue_len++;
+    return ESP_OK;
+}
+
+esp_err_t esp_lcd_new_panel_io_spi(esp_lcd_spi_bus_handle_t bus,
+                                   const esp_lcd_panel_io_spi_config_t* config,
+                                   esp_lcd_panel_io_handle_t* ret_io) {
+    CHECK(config->trans_queue_depth > 0 &&
+          config->trans_queue_depth <= FAKE_LCD_MAX_QUEUE_DEPTH);
+    g_queue_depth  = config->trans_queue_depth;
+    g_callback     = config->on_color_trans_done;
+    g_callback_ctx = config->user_ctx;
+    *ret_io        = (esp_lcd_panel_io_handle_t)&g_handle;
+    return ESP_OK;
+}
+
+esp_err_t esp_lcd_new_panel_ili9341(
+  const esp_lcd_panel_io_handle_t io,
+  const esp_lcd_panel_dev_config_t* panel_dev_config,
+  esp_lcd_panel_handle_t* ret_panel) {
+    *ret_panel = (esp_lcd_panel_handle_t)&g_handle;
+    return ESP_OK;
+}
+
+esp_err_t esp_lcd_panel_io_tx_param(esp_lcd_panel_io_handle_t io,
+                                    int lcd_cmd,
+                                    const void* param,
+                                    size_t param_size) {
+    return ESP_OK;
+}
+
+esp_err_t esp_lcd_panel_reset(esp_lcd_panel_handle_t panel) {
+    return ESP_OK;
+}
+
+esp_err_t esp_lcd_panel_init(esp_lcd_panel_handle_t panel) {
+    return ESP_OK;
+}
+
+esp_err_t esp_lcd_panel_mirror(esp_lcd_panel_handle_t panel,
+                               bool mirror_x,
+                               bool mirror_y) {
+    return ESP_OK;
+}
+
+esp_err_t esp_lcd_panel_swap_xy(esp_lcd_panel_handle_t panel, bool swap_axes) {
+    return ESP_OK;
+}
+
+esp_err_t esp_lcd_panel_invert_color(esp_lcd_panel_handle_t panel,
+                                     bool invert_color_data) {
+    return ESP_OK;
+}
+
+esp_err_t esp_lcd_panel_disp_on_off(esp_lcd_panel_handle_t panel, bool on_off) {
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_initialize(spi_host_device_t host_id,
+                             const spi_bus_config_t* bus_config,
+                             spi_dma_chan_t dma_chan) {
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode) {
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level) {
+    return ESP_OK;
+}
+
+void* heap_caps_malloc(size_t size, uint32_t caps) {
+    return malloc(size);
+}
+
+/*----------------------------------------------------------------------------*/
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return (TaskHandle_t)&g_handle;
+}
+
+void vTaskNotifyGiveIndexedFromISR(TaskHandle_t task_to_notify,
+                                   UBaseType_t index_to_notify,
+                                   BaseType_t* higher_priority_task_woken) {
+    CHECK(task_to_notify == (TaskHandle_t)&g_handle);
+    CHECK(index_to_notify < configTASK_NOTIFICATION_ARRAY_ENTRIES);
+    g_notifications++;
+}
+
+/*
+ * There is a single task, so instead of blocking, complete the queued
+ * transfers until one of them notifies it. Waiting when nothing is queued is
+ * an error of the caller, since it would block forever.
+ */
+uint32_t ulTaskNotifyTakeIndexed(UBaseType_t index_to_wait_on,
+                                 BaseType_t clear_count_on_exit,
+                                 TickType_t ticks_to_wait) {
+    while (g_notifications == 0) {
+        if (g_queue_len == 0) {
+            fprintf(stderr, "Waiting for a notification that never arrives\n");
+            exit(EXIT_FAILURE);
+        }
+        complete_transfer();
+    }
+
+    const uint32_t notifications = g_notifications;
+    g_notifications = clear_count_on_exit ? 0 : notifications - 1;
+    return notifications;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef FAKE_LCD_H_
+#define FAKE_LCD_H_ 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Fake LCD panel for the host tests of 'render.c' and the modules that draw
+ * through it, implementing the functions of the 'esp_lcd' and SPI stubs, and
+ * the FreeRTOS task notifications used for waiting for transfers.
+ *
+ * Like the SPI driver, the bitmap transfers are queued, and they are completed
+ * in order when the queue is full, or when the task waits for a notification.
+ * Each completed transfer is copied into the pixels of the panel, and the
+ * completion callback is called, like from the DMA interrupt.
+ */
+
+/*
+ * Maximum size of the panel, in pixels.
+ */
+#define FAKE_LCD_WIDTH  320
+#define FAKE_LCD_HEIGHT 240
+
+/*
+ * Complete all the queued transfers.
+ */
+void fake_lcd_complete_transfers(void);
+
+/*
+ * Get the pixel of the panel at the specified coordinates, in the RGB565
+ * format sent by 'render.c', after the completed transfers.
+ */
+uint16_t fake_lcd_get_pixel(int x, int y);
+
+/*
+ * Get the number of transfers and transferred bytes since the start of the
+ * program.
+ */
+size_t fake_lcd_get_num_transfers(void);
+size_t fake_lcd_get_num_bytes(void);
+
+#endif /* FAKE_LCD_H_ */
@@ -0,0 +1,222 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "fake_uart.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "driver/uart.h"
+
+#include "util.h"
+
+/*
+ * Maximum size of the driver's ring buffer, and capacity of its event queue.
+ */
+#define FAKE_UART_MAX_RX_SIZE 4096
+#define FAKE_UART_QUEUE_SIZE  64
+
+/*----------------------------------------------------------------------------*/
+
+/* Input stream, and position of the next byte that will arrive */
+static const uint8_t* g_input;
+static size_t g_input_size;
+static size_t g_input_pos;
+static size_t g_chunk_size;
+
+/* Bytes that arrived but were not read yet, like the driver's ring buffer */
+static uint8_t g_rx[FAKE_UART_MAX_RX_SIZE];
+static size_t g_rx_size     = FAKE_UART_MAX_RX_SIZE;
+static size_t g_rx_read_pos = 0;
+static size_t g_rx_len      = 0;
+
+/* Pending events, and number of detected newline positions */
+static uart_event_t g_events[FAKE_UART_QUEUE_SIZE];
+static size_t g_events_read_pos = 0;
+static size_t g_events_len      = 0;
+static int g_num_patterns       = 0;
+
+/* Lock taken by every driver call, and number of reads */
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static size_t g_num_reads     = 0;
+
+/* Any non-null pointer works as the handle of the only queue */
+static int g_queue_handle;
+
+/*----------------------------------------------------------------------------*/
+
+static void push_event(uart_event_type_t type, size_t size) {
+    if (g_events_len >= FAKE_UART_QUEUE_SIZE)
+        return; /* The real driver drops events when the queue is full */
+
+    const size_t pos =
+      (g_events_read_pos + g_events_len) % FAKE_UART_QUEUE_SIZE;
+    g_events[pos] = (uart_event_t){ .type = type, .size = size };
+    g_events_len++;
+}
+
+/*
+ * Receive the next chunk of the input stream, as if the reader had been
+ * blocked until it arrived.
+ */
+static void receive_chunk(void) {
+    if (g_input_pos >= g_input_size) {
+        fprintf(stderr, "Fake UART blocked after its input was exhausted\n");
+        exit(EXIT_FAILURE);
+    }
+
+    size_t size = MIN(g_chunk_size, g_input_size - g_input_pos);
+    size        = MIN(size, g_rx_size - g_rx_len);
+
+    for (size_t i = 0; i < size; i++) {
+        const uint8_t byte = g_input[g_input_pos + i];
+        g_rx[(g_rx_read_pos + g_rx_len + i) % g_rx_size] = byte;
+        if (byte == '\n') {
+            g_num_patterns++;
+            push_event(UART_PATTERN_DET, 0);
+        }
+    }
+
+    g_input_pos += size;
+    g_rx_len += size;
+    push_event(UART_DATA, size);
+}
+
+/*----------------------------------------------------------------------------*/
+
+void fake_uart_set_input(const void* data, size_t size, size_t chunk_size) {
+    g_input      = data;
+    g_input_size = size;
+    g_input_pos  = 0;
+    g_chunk_size = chunk_size;
+    g_num_reads  = 0;
+}
+
+size_t fake_uart_get_num_reads(void) {
+    return g_num_reads;
+}
+
+/*----------------------------------------------------------------------------*/
+
+esp_err_t uart_param_config(uart_port_t uart_num,
+                            const uart_config_t* uart_config) {
+    return ESP_OK;
+}
+
+esp_err_t uart_set_pin(uart_port_t uart_num,
+                       int tx_io_num,
+                       int rx_io_num,
+                       int rts_io_num,
+                       int cts_io_num) {
+    return ESP_OK;
+}
+
+esp_err_t uart_driver_install(uart_port_t uart_num,
+                              int rx_buffer_size,
+                              int tx_buffer_size,
+                              int queue_size,
+                              QueueHandle_t* uart_queue,
+                              int intr_alloc_flags) {
+    g_rx_size = MIN((size_t)rx_buffer_size, FAKE_UART_MAX_RX_SIZE);
+    if (uart_queue != NULL)
+        *uart_queue = (QueueHandle_t)&g_queue_handle;
+    return ESP_OK;
+}
+
+esp_err_t uart_enable_pattern_det_baud_intr(uart_port_t uart_num,
+                                            char pattern_chr,
+                                            uint8_t chr_num,
+                                            int chr_tout,
+                                            int post_idle,
+                                            int pre_idle) {
+    return ESP_OK;
+}
+
+esp_err_t uart_pattern_queue_reset(uart_port_t uart_num, int queue_length) {
+    g_num_patterns = 0;
+    return ESP_OK;
+}
+
+int uart_pattern_pop_pos(uart_port_t uart_num) {
+    if (g_num_patterns == 0)
+        return -1;
+
+    /* The positions are not used by the tested code */
+    g_num_patterns--;
+    return 0;
+}
+
+esp_err_t uart_get_buffered_data_len(uart_port_t uart_num, size_t* size) {
+    pthread_mutex_lock(&g_lock);
+    *size = g_rx_len;
+    pthread_mutex_unlock(&g_lock);
+    return ESP_OK;
+}
+
+int uart_read_bytes(uart_port_t uart_num,
+                    void* buf,
+                    uint32_t length,
+                    TickType_t ticks_to_wait) {
+    pthread_mutex_lock(&g_lock);
+    g_num_reads++;
+
+    if (g_rx_len == 0 && ticks_to_wait > 0)
+        receive_chunk();
+
+    uint8_t* dst      = buf;
+    const size_t size = MIN((size_t)length, g_rx_len);
+    for (size_t i = 0; i < size; i++)
+        dst[i] = g_rx[(g_rx_read_pos + i) % g_rx_size];
+
+    g_rx_read_pos = (g_rx_read_pos + size) % g_rx_size;
+    g_rx_len -= size;
+
+    pthread_mutex_unlock(&g_lock);
+    return (int)size;
+}
+
+esp_err_t uart_flush_input(uart_port_t uart_num) {
+    g_rx_read_pos = 0;
+    g_rx_len      = 0;
+    return ESP_OK;
+}
+
+/*----------------------------------------------------------------------------*/
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* dst, TickType_t ticks) {
+    if (g_events_len == 0) {
+        if (ticks == 0)
+            return pdFALSE;
+        receive_chunk();
+    }
+
+    *(uart_event_t*)dst = g_events[g_events_read_pos];
+    g_events_read_pos   = (g_events_read_pos + 1) % FAKE_UART_QUEUE_SIZE;
+    g_events_len--;
+    return pdTRUE;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    g_events_read_pos = 0;
+    g_events_len      = 0;
+    return pdTRUE;
+}
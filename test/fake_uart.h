@@ -0,0 +1,50 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef FAKE_UART_H_
+#define FAKE_UART_H_ 1
+
+#include <stddef.h>
+
+/*
+ * Fake UART driver for the host tests of 'serial_uart.c', implementing the
+ * functions of the 'driver/uart.h' stub and the FreeRTOS queue functions used
+ * for its events.
+ *
+ * The received bytes are taken from an input stream, and they arrive in chunks
+ * whenever the reader is about to block, like from a sender that is always
+ * faster than the reader. For each chunk, the fake posts a 'UART_DATA' event,
+ * and a 'UART_PATTERN_DET' event for each newline in it. Like the real driver,
+ * each call to 'uart_read_bytes' or 'uart_get_buffered_data_len' takes a lock.
+ *
+ * Blocking after the input was exhausted is an error of the test, so the
+ * process exits with a failure status.
+ */
+
+/*
+ * Set the input stream of the fake UART, which arrives in chunks of up to
+ * 'chunk_size' bytes, and reset its counters. The data is not copied.
+ */
+void fake_uart_set_input(const void* data, size_t size, size_t chunk_size);
+
+/*
+ * Get the number of calls to 'uart_read_bytes' since the input was set.
+ */
+size_t fake_uart_get_num_reads(void);
+
+#endif /* FAKE_UART_H_ */
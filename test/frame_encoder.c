@@ -0,0 +1,136 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "frame_encoder.h"
+#include <string.h> /* memcpy */
+
+#include "frame.h"
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Table-driven CRC-16/CCITT-FALSE, unlike the bitwise one of the decoder.
+ */
+static uint16_t crc16(const uint8_t* data, size_t size) {
+    static uint16_t table[256];
+    static int table_ready = 0;
+    if (!table_ready) {
+        for (int i = 0; i < 256; i++) {
+            uint16_t crc = (uint16_t)(i << 8);
+            for (int bit = 0; bit < 8; bit++)
+                crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+            table[i] = crc;
+        }
+        table_ready = 1;
+    }
+
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < size; i++)
+        crc = (crc << 8) ^ table[(crc >> 8) ^ data[i]];
+    return crc;
+}
+
+/*
+ * Encode the specified data with COBS into 'dst', followed by the delimiter.
+ * Returns the number of bytes written.
+ */
+static size_t cobs_encode(const uint8_t* src, size_t src_size, uint8_t* dst) {
+    size_t code_pos = 0;
+    size_t dst_pos  = 1;
+    uint8_t code    = 1;
+
+    for (size_t i = 0; i < src_size; i++) {
+        if (src[i] != 0) {
+            dst[dst_pos++] = src[i];
+            code++;
+        }
+
+        /* Close the block at each zero, and after 254 non-zero bytes */
+        if (src[i] == 0 || code == 0xFF) {
+            dst[code_pos] = code;
+            code_pos      = dst_pos++;
+            code          = 1;
+        }
+    }
+
+    dst[code_pos]  = code;
+    dst[dst_pos++] = FRAME_DELIMITER;
+    return dst_pos;
+}
+
+static inline void write_u16_le(uint8_t* dst, uint16_t value) {
+    dst[0] = value & 0xFF;
+    dst[1] = value >> 8;
+}
+
+/*
+ * Append the CRC to the specified frame, and encode it into 'dst'.
+ */
+static size_t finish_frame(uint8_t* frame, size_t size, uint8_t* dst) {
+    write_u16_le(&frame[size], crc16(frame, size));
+    return cobs_encode(frame, size + 2, dst);
+}
+
+/*----------------------------------------------------------------------------*/
+
+size_t frame_encode_f32(const float* values,
+                        int num_values,
+                        uint16_t sequence,
+                        uint8_t* dst) {
+    if (num_values < 0 || 4 + num_values * 4 + 2 > FRAME_MAX_SIZE)
+        return 0;
+
+    uint8_t frame[FRAME_MAX_SIZE];
+    frame[0] = FRAME_TYPE_F32;
+    frame[1] = num_values;
+    write_u16_le(&frame[2], sequence);
+
+    size_t size = 4;
+    for (int i = 0; i < num_values; i++) {
+        uint32_t bits;
+        memcpy(&bits, &values[i], sizeof(bits));
+        write_u16_le(&frame[size], bits & 0xFFFF);
+        write_u16_le(&frame[size + 2], bits >> 16);
+        size += 4;
+    }
+
+    return finish_frame(frame, size, dst);
+}
+
+size_t frame_encode_i16(const int16_t* raw,
+                        int num_values,
+                        int exponent,
+                        uint16_t sequence,
+                        uint8_t* dst) {
+    if (num_values < 0 || 5 + num_values * 2 + 2 > FRAME_MAX_SIZE)
+        return 0;
+
+    uint8_t frame[FRAME_MAX_SIZE];
+    frame[0] = FRAME_TYPE_I16;
+    frame[1] = num_values;
+    write_u16_le(&frame[2], sequence);
+    frame[4] = (uint8_t)(int8_t)exponent;
+
+    size_t size = 5;
+    for (int i = 0; i < num_values; i++) {
+        write_u16_le(&frame[size], (uint16_t)raw[i]);
+        size += 2;
+    }
+
+    return finish_frame(frame, size, dst);
+}
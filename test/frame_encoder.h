@@ -0,0 +1,58 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef FRAME_ENCODER_H_
+#define FRAME_ENCODER_H_ 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Maximum size of an encoded frame, including the COBS overhead and the
+ * delimiter.
+ */
+#define FRAME_ENCODER_MAX_SIZE 260
+
+/*
+ * Host-side encoder of the binary sample frames described in 'frame.h', for
+ * senders and tests. It's written independently of the decoder in 'frame.c',
+ * so the tests don't share its mistakes.
+ */
+
+/*
+ * Encode a 'FRAME_TYPE_F32' frame with the specified values and sequence
+ * number, followed by its delimiter, into 'dst', which must be able to hold
+ * 'FRAME_ENCODER_MAX_SIZE' bytes. Returns the number of bytes written, or zero
+ * if there are too many values for a frame.
+ */
+size_t frame_encode_f32(const float* values,
+                        int num_values,
+                        uint16_t sequence,
+                        uint8_t* dst);
+
+/*
+ * Encode a 'FRAME_TYPE_I16' frame, whose values are 'raw[i] * 10^exponent',
+ * like 'frame_encode_f32'.
+ */
+size_t frame_encode_i16(const int16_t* raw,
+                        int num_values,
+                        int exponent,
+                        uint16_t sequence,
+                        uint8_t* dst);
+
+#endif /* FRAME_ENCODER_H_ */
@@ -0,0 +1,168 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE /* posix_openpt, cfmakeraw */
+
+#include "pty_uart.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/uart.h"
+
+#include "test.h"
+
+/* Terminal device used by the firmware, and state of the driver */
+static int g_fd           = -1;
+static bool g_installed   = false;
+static int g_num_installs = 0;
+
+/*----------------------------------------------------------------------------*/
+
+int pty_uart_open(void) {
+    const int master_fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master_fd < 0 || grantpt(master_fd) != 0 ||
+        unlockpt(master_fd) != 0) {
+        perror("Can't open pseudo-terminal");
+        exit(EXIT_FAILURE);
+    }
+
+    g_fd = open(ptsname(master_fd), O_RDWR | O_NOCTTY);
+    if (g_fd < 0) {
+        perror("Can't open terminal device");
+        exit(EXIT_FAILURE);
+    }
+
+    struct termios attrs;
+    CHECK(tcgetattr(g_fd, &attrs) == 0);
+    cfmakeraw(&attrs);
+    CHECK(tcsetattr(g_fd, TCSANOW, &attrs) == 0);
+
+    return master_fd;
+}
+
+int pty_uart_get_num_installs(void) {
+    return g_num_installs;
+}
+
+/*----------------------------------------------------------------------------*/
+
+TickType_t xTaskGetTickCount(void) {
+    return (TickType_t)(test_get_time() * 1000 / portTICK_PERIOD_MS);
+}
+
+void vTaskDelay(TickType_t ticks) {
+    const struct timespec ts = {
+        .tv_sec  = ticks * portTICK_PERIOD_MS / 1000,
+        .tv_nsec = ticks * portTICK_PERIOD_MS % 1000 * 1000000L,
+    };
+    nanosleep(&ts, NULL);
+}
+
+/*----------------------------------------------------------------------------*/
+
+esp_err_t uart_param_config(uart_port_t uart_num,
+                            const uart_config_t* uart_config) {
+    return ESP_OK;
+}
+
+esp_err_t uart_set_pin(uart_port_t uart_num,
+                       int tx_io_num,
+                       int rx_io_num,
+                       int rts_io_num,
+                       int cts_io_num) {
+    return ESP_OK;
+}
+
+esp_err_t uart_driver_install(uart_port_t uart_num,
+                              int rx_buffer_size,
+                              int tx_buffer_size,
+                              int queue_size,
+                              QueueHandle_t* uart_queue,
+                              int intr_alloc_flags) {
+    g_num_installs++;
+
+    /* Like the real driver, fail if it was already installed */
+    if (g_installed)
+        return ESP_FAIL;
+
+    g_installed = true;
+    return ESP_OK;
+}
+
+esp_err_t uart_driver_delete(uart_port_t uart_num) {
+    g_installed = false;
+    return ESP_OK;
+}
+
+bool uart_is_driver_installed(uart_port_t uart_num) {
+    return g_installed;
+}
+
+esp_err_t uart_get_buffered_data_len(uart_port_t uart_num, size_t* size) {
+    int available = 0;
+    CHECK(ioctl(g_fd, FIONREAD, &available) == 0);
+    *size = available;
+    return ESP_OK;
+}
+
+/*
+ * Like the real driver, wait until 'length' bytes were read or the timeout
+ * expires, and return the number of bytes that were read.
+ */
+int uart_read_bytes(uart_port_t uart_num,
+                    void* buf,
+                    uint32_t length,
+                    TickType_t ticks_to_wait) {
+    const double deadline =
+      test_get_time() + ticks_to_wait * portTICK_PERIOD_MS * 1e-3;
+
+    uint32_t pos = 0;
+    while (pos < length) {
+        const int timeout_ms = (int)((deadline - test_get_time()) * 1e3);
+        struct pollfd pfd    = { .fd = g_fd, .events = POLLIN };
+        if (timeout_ms <= 0 || poll(&pfd, 1, timeout_ms) <= 0)
+            break;
+
+        const ssize_t len = read(g_fd, (uint8_t*)buf + pos, length - pos);
+        CHECK(len > 0);
+        pos += len;
+    }
+
+    return pos;
+}
+
+int uart_write_bytes(uart_port_t uart_num, const void* src, size_t size) {
+    CHECK(write(g_fd, src, size) == (ssize_t)size);
+    return size;
+}
+
+esp_err_t uart_flush_input(uart_port_t uart_num) {
+    tcflush(g_fd, TCIFLUSH);
+    return ESP_OK;
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PTY_UART_H_
+#define PTY_UART_H_ 1
+
+/*
+ * Fake UART driver for the host tests of 'elm327.c', implementing the
+ * functions of the 'driver/uart.h' stub on top of a Linux pseudo-terminal, and
+ * the FreeRTOS tick functions on top of the monotonic clock.
+ *
+ * The firmware reads and writes the terminal device of the pseudo-terminal, and
+ * the test talks to it through the other end, like a device on the other end of
+ * the serial port. The terminal is in raw mode, so bytes are not translated in
+ * either direction.
+ */
+
+/*
+ * Open the pseudo-terminal used by the driver. Returns the file descriptor of
+ * the end used by the test, or exits with a failure status on error.
+ */
+int pty_uart_open(void);
+
+/*
+ * Get the number of calls to 'uart_driver_install'.
+ */
+int pty_uart_get_num_installs(void);
+
+#endif /* PTY_UART_H_ */
@@ -0,0 +1,39 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Host stand-in for the ESP-IDF header of the same name, with the subset used
+ * by the modules that are built for the host tests.
+ */
+
+#ifndef ESP_ERR_H_
+#define ESP_ERR_H_ 1
+
+typedef int esp_err_t;
+
+#define ESP_OK                0
+#define ESP_FAIL              (-1)
+#define ESP_ERR_INVALID_STATE 0x103
+
+#define ESP_ERROR_CHECK(X)                                                     \
+    do {                                                                       \
+        esp_err_t err_ = (X);                                                  \
+        (void)err_;                                                            \
+    } while (0)
+
+#endif /* ESP_ERR_H_ */
@@ -0,0 +1,35 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Host stand-in for the ESP-IDF header of the same name, with the subset used
+ * by the modules that are built for the host tests. The functions are
+ * implemented by the fake drivers of each test.
+ */
+
+#ifndef ESP_LCD_ILI9341_H_
+#define ESP_LCD_ILI9341_H_ 1
+
+#include "esp_lcd_panel_vendor.h"
+
+esp_err_t esp_lcd_new_panel_ili9341(
+  const esp_lcd_panel_io_handle_t io,
+  const esp_lcd_panel_dev_config_t* panel_dev_config,
+  esp_lcd_panel_handle_t* ret_panel);
+
+#endif /* ESP_LCD_ILI9341_H_ */
@@ -0,0 +1,38 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Host stand-in for the ESP-IDF header of the same name, with the subset used
+ * by the modules that are built for the host tests.
+ */
+
+#ifndef ESP_LCD_PANEL_VENDOR_H_
+#define ESP_LCD_PANEL_VENDOR_H_ 1
+
+#include "esp_lcd_panel_io.h"
+#include "esp_lcd_panel_ops.h"
+
+typedef enum { LCD_RGB_ENDIAN_RGB = 0 } lcd_rgb_endian_t;
+
+typedef struct {
+    int reset_gpio_num;
+    lcd_rgb_endian_t rgb_endian;
+    unsigned int bits_per_pixel;
+} esp_lcd_panel_dev_config_t;
+
+#endif /* ESP_LCD_PANEL_VENDOR_H_ */
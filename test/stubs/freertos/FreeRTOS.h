@@ -0,0 +1,45 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Host stand-in for the FreeRTOS header of the same name, with the subset used
+ * by the modules that are built for the host tests.
+ */
+
+#ifndef FREERTOS_H_
+#define FREERTOS_H_ 1
+
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE  1
+#define pdFALSE 0
+
+#define portMAX_DELAY      ((TickType_t)0xFFFFFFFF)
+#define portTICK_PERIOD_MS 10
+#define pdMS_TO_TICKS(MS)  ((TickType_t)((MS) / portTICK_PERIOD_MS))
+
+/* Same as in 'sdkconfig.defaults' */
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES 2
+
+typedef struct QueueDefinition* QueueHandle_t;
+
+#endif /* FREERTOS_H_ */
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TEST_H_
+#define TEST_H_ 1
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+ * Check that the specified condition holds, or print it and exit with a
+ * failure status. Unlike 'assert', it's never disabled.
+ */
+#define CHECK(COND)                                                            \
+    do {                                                                       \
+        if (!(COND)) {                                                         \
+            fprintf(stderr,                                                    \
+                    "%s:%d: Check failed: %s\n",                               \
+                    __FILE__,                                                  \
+                    __LINE__,                                                  \
+                    #COND);                                                    \
+            exit(EXIT_FAILURE);                                                \
+        }                                                                      \
+    } while (0)
+
+/*
+ * Get the current time of a monotonic clock, in seconds.
+ */
+static inline double test_get_time(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Get the next number of a fast pseudo-random sequence (xorshift64*), whose
+ * state must not be zero. Unlike 'rand', it's the same on every platform, so
+ * failures can be reproduced from the seed.
+ */
+static inline uint64_t test_random(uint64_t* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * UINT64_C(2685821657736338717);
+}
+
+#endif /* TEST_H_ */
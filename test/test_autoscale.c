@@ -0,0 +1,161 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Tests of the auto-scaling policy: the ranges are nice and fit the data, they
+ * expand immediately, and they only shrink after the dwell time.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "autoscale.h"
+#include "test.h"
+
+#define NUM_RANDOM_RANGES 100000
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Check that the current range of the specified policy contains the specified
+ * data, and that it's made of whole nice tick steps.
+ */
+static void check_range(const AutoScale* scale,
+                        float data_min,
+                        float data_max) {
+    CHECK(scale->min_value <= data_min && data_max <= scale->max_value);
+    CHECK(scale->min_value < scale->max_value);
+
+    /* The step is 1, 2 or 5 times a power of ten */
+    const float step      = scale->tick_step;
+    const float magnitude = powf(10.f, floorf(log10f(step)));
+    const float fraction  = step / magnitude;
+    CHECK(fabsf(fraction - 1.f) < 1e-3f || fabsf(fraction - 2.f) < 1e-3f ||
+          fabsf(fraction - 5.f) < 1e-3f || fabsf(fraction - 10.f) < 1e-3f);
+
+    /*
+     * The range has a whole number of intervals, close to the desired one.
+     * Its ends are rounded to floats, so the tolerance depends on their size
+     * relative to the step.
+     */
+    const float tolerance =
+      1e-3f +
+      (fabsf(scale->min_value) + fabsf(scale->max_value)) / step * 1e-6f;
+    const float intervals = (scale->max_value - scale->min_value) / step;
+    CHECK(fabsf(intervals - roundf(intervals)) < tolerance);
+    CHECK(roundf(intervals) >= 2 &&
+          roundf(intervals) <= AUTOSCALE_NUM_TICKS + 2);
+
+    const float min_steps = scale->min_value / step;
+    CHECK(fabsf(min_steps - roundf(min_steps)) < tolerance);
+}
+
+/*
+ * Check that random data of very different magnitudes is fitted in a single
+ * update, since the initial range is empty.
+ */
+static void test_random_ranges(void) {
+    uint64_t state = 1;
+    for (int i = 0; i < NUM_RANDOM_RANGES; i++) {
+        const float magnitude =
+          powf(10.f, (float)(test_random(&state) % 11) - 4.f);
+        const float center =
+          ((float)(test_random(&state) % 2001) - 1000.f) * magnitude;
+        const float range =
+          (float)(test_random(&state) % 1000 + 1) * magnitude * 0.01f;
+
+        AutoScale scale;
+        autoscale_init(&scale, 10);
+        CHECK(autoscale_update(&scale, center, center + range, 1));
+        check_range(&scale, center, center + range);
+    }
+}
+
+/*
+ * Check that the range expands as soon as the data leaves it, but that it
+ * only shrinks after the data needed a smaller one for the whole dwell time.
+ */
+static void test_hysteresis(void) {
+    AutoScale scale;
+    autoscale_init(&scale, 10);
+    CHECK(autoscale_update(&scale, 0.f, 100.f, 1));
+    check_range(&scale, 0.f, 100.f);
+
+    /* With the margin, 120 is split into 5 intervals of 24, rounded to 50 */
+    CHECK(scale.min_value == -50.f && scale.max_value == 150.f);
+    CHECK(scale.tick_step == 50.f);
+    const float wide_min = scale.min_value;
+    const float wide_max = scale.max_value;
+
+    /* Data that keeps needing the same range changes nothing */
+    CHECK(!autoscale_update(&scale, 0.f, 100.f, 5));
+    CHECK(!autoscale_update(&scale, 1.f, 99.f, 5));
+
+    /* Smaller data doesn't shrink the range until the dwell time is over */
+    for (int i = 0; i < 3; i++)
+        CHECK(!autoscale_update(&scale, 40.f, 60.f, 3));
+    CHECK(scale.min_value == wide_min && scale.max_value == wide_max);
+    CHECK(autoscale_update(&scale, 40.f, 60.f, 1));
+    check_range(&scale, 40.f, 60.f);
+    CHECK(scale.min_value == 35.f && scale.max_value == 65.f);
+    CHECK(scale.tick_step == 5.f);
+
+    /* Needing the current range again resets the dwell time */
+    const float narrow_max = scale.max_value;
+    CHECK(!autoscale_update(&scale, 45.f, 55.f, 9));
+    CHECK(!autoscale_update(&scale, 40.f, 60.f, 1));
+    CHECK(!autoscale_update(&scale, 45.f, 55.f, 9));
+    CHECK(scale.max_value == narrow_max);
+
+    /* Data outside of the range expands it immediately */
+    CHECK(autoscale_update(&scale, 40.f, 1000.f, 1));
+    check_range(&scale, 40.f, 1000.f);
+}
+
+/*
+ * Check constant and invalid data.
+ */
+static void test_special_data(void) {
+    AutoScale scale;
+    autoscale_init(&scale, 10);
+
+    /* Without valid data, there is no range */
+    CHECK(!autoscale_update(&scale, INFINITY, -INFINITY, 1));
+    CHECK(!autoscale_update(&scale, NAN, NAN, 1));
+    CHECK(scale.min_value > scale.max_value);
+
+    /* Constant data still gets a range around it */
+    CHECK(autoscale_update(&scale, 42.f, 42.f, 1));
+    check_range(&scale, 42.f, 42.f);
+
+    /* Invalid data keeps the current range */
+    const float min = scale.min_value;
+    CHECK(!autoscale_update(&scale, NAN, 1e9f, 100));
+    CHECK(scale.min_value == min);
+}
+
+int main(void) {
+    test_random_ranges();
+    test_hysteresis();
+    test_special_data();
+
+    printf("All auto-scaling tests passed\n");
+    return 0;
+}
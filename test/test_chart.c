@@ -0,0 +1,714 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Tests of the chart history: the extremes tracked by the monotonic deques are
+ * compared against a rescan of every column after each push, and zoomed-out
+ * views are checked to be drawn at the right edge of the display, and from the
+ * latest samples of the log. The transfers of the modified areas to the fake
+ * panel are also checked, and each display mode is checked to produce the same
+ * pixels on the panel when rendered in stripes as with a framebuffer.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "chart.h"
+#include "render.h"
+#include "fake_lcd.h"
+#include "test.h"
+#include "util.h"
+
+#define NUM_CHANNELS 3
+#define NUM_PUSHES   20000
+
+/*
+ * Chart height, and dwell of its axes, which don't matter for the extremes.
+ */
+#define DISPLAY_HEIGHT 240
+#define SHRINK_DWELL   10
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Get the minimum or maximum of a column, as compared by the deques: its code
+ * when quantized, or its value otherwise.
+ */
+static float column_min(const ChartCtx* ctx, int idx) {
+    return (ctx->quantizers != NULL) ? ctx->min_codes[idx] : ctx->mins[idx];
+}
+
+static float column_max(const ChartCtx* ctx, int idx) {
+    return (ctx->quantizers != NULL) ? ctx->max_codes[idx] : ctx->maxs[idx];
+}
+
+/*
+ * Check that the front of each deque is an extreme of all the columns with
+ * samples, found by scanning them.
+ */
+static void check_extremes(const ChartCtx* ctx) {
+    for (int channel = 0; channel < ctx->num_channels; channel++) {
+        const int first_idx = ctx->history_size * channel;
+
+        bool found = false;
+        float min  = 0.f;
+        float max  = 0.f;
+        for (int pos = 0; pos < ctx->history_size; pos++) {
+            if (ctx->empty_columns != NULL && ctx->empty_columns[pos])
+                continue;
+
+            const float column_min_value = column_min(ctx, first_idx + pos);
+            const float column_max_value = column_max(ctx, first_idx + pos);
+            if (!found || column_min_value < min)
+                min = column_min_value;
+            if (!found || column_max_value > max)
+                max = column_max_value;
+            found = true;
+        }
+
+        const ChartDeque* min_deque = &ctx->min_deques[channel];
+        const ChartDeque* max_deque = &ctx->max_deques[channel];
+        if (!found) {
+            CHECK(min_deque->size == 0 && max_deque->size == 0);
+            continue;
+        }
+
+        CHECK(min_deque->size > 0 && min_deque->size <= ctx->history_size);
+        CHECK(max_deque->size > 0 && max_deque->size <= ctx->history_size);
+        const int min_pos = min_deque->positions[min_deque->head];
+        const int max_pos = max_deque->positions[max_deque->head];
+        CHECK(column_min(ctx, first_idx + min_pos) == min);
+        CHECK(column_max(ctx, first_idx + max_pos) == max);
+    }
+}
+
+/*
+ * Generate the next value of a channel. Runs of increasing and decreasing
+ * values are the worst case of the deques, and repeated values check that ties
+ * are handled.
+ */
+static float next_value(uint64_t* state, float previous) {
+    switch (test_random(state) % 5) {
+        case 0:
+            return previous; /* Plateau */
+        case 1:
+            return previous + 1.f; /* Ramp up */
+        case 2:
+            return previous - 1.f; /* Ramp down */
+        case 3:
+            return (float)(test_random(state) % 1000); /* Jump */
+        default:
+            return previous + (float)(test_random(state) % 21) - 10.f;
+    }
+}
+
+/*
+ * Push random values into a chart with the specified configuration, checking
+ * its extremes after each push. If 'period_us' is not zero, the columns are
+ * started by time, and the timestamps sometimes skip periods.
+ */
+static void check_random_pushes(int history_size,
+                                int samples_per_column,
+                                bool quantized,
+                                int64_t period_us) {
+    static const ChartFormat formats[NUM_CHANNELS] = {
+        { 0.25f, 0.f },
+        { 1.f, -40.f },
+        { 0.5f, 500.f },
+    };
+
+    ChartCtx ctx;
+    chart_init(&ctx,
+               NUM_CHANNELS,
+               history_size,
+               DISPLAY_HEIGHT,
+               SHRINK_DWELL,
+               samples_per_column,
+               quantized ? formats : NULL);
+    if (period_us > 0)
+        chart_set_column_period(&ctx, period_us);
+    check_extremes(&ctx);
+
+    uint64_t state             = 1 + history_size * 4 + samples_per_column;
+    float values[NUM_CHANNELS] = { 0.f, 0.f, 0.f };
+    int64_t timestamp_us       = 0;
+    for (int i = 0; i < NUM_PUSHES; i++) {
+        for (int j = 0; j < NUM_CHANNELS; j++)
+            values[j] = next_value(&state, values[j]);
+
+        if (period_us > 0) {
+            const uint64_t r = test_random(&state) % 64;
+            if (r == 0)
+                timestamp_us += period_us * (history_size + 1);
+            else if (r < 8)
+                timestamp_us += period_us * (r % 4 + 1);
+            else
+                timestamp_us += period_us / 3;
+        }
+
+        chart_push(&ctx, timestamp_us, values, NUM_CHANNELS);
+        check_extremes(&ctx);
+
+        if (i % 16 == 0)
+            chart_update_minmax(&ctx);
+    }
+
+    chart_destroy(&ctx);
+}
+
+/*
+ * Get whether any pixel of the specified column of the framebuffer is set.
+ */
+static bool column_is_drawn(const RenderCtx* ctx, int x) {
+    for (int y = 0; y < ctx->height; y++)
+        if (ctx->framebuffer[y * ctx->width + x] != 0)
+            return true;
+    return false;
+}
+
+static void draw_history(RenderCtx* render_ctx, void* arg) {
+    ChartCtx* ctx = arg;
+    render_clear(render_ctx);
+    chart_render_history(ctx, render_ctx, 4 * ctx->history_size);
+}
+
+/*
+ * Check that a view of a tier that is not full yet ends at the right edge of
+ * the display, like the views of the columns of the chart, instead of starting
+ * at the left edge.
+ */
+static void test_partial_tier(void) {
+    const int width = 64;
+
+    RenderCtx render_ctx;
+    render_init(&render_ctx, width, DISPLAY_HEIGHT, RENDER_FRAMEBUFFER);
+    chart_set_colors(&render_ctx, 1.f);
+
+    ChartCtx ctx;
+    chart_init(&ctx,
+               NUM_CHANNELS,
+               width,
+               DISPLAY_HEIGHT,
+               SHRINK_DWELL,
+               1,
+               NULL);
+    const size_t budget = (width + 1) * NUM_CHANNELS * sizeof(ChartBucket);
+    chart_init_tiers(&ctx, &budget, 1);
+
+    /* A ramp, so no bucket is flat, and 50 buckets of the first tier */
+    for (int i = 0; i < 100; i++) {
+        const float values[NUM_CHANNELS] = { i, 2 * i, 3 * i };
+        chart_push(&ctx, i, values, NUM_CHANNELS);
+    }
+    CHECK(ctx.tiers[0].num_buckets == 50);
+
+    /* Like in 'render_draw_trace', the first column is only connected to */
+    render_area(&render_ctx, 0, 0, width, DISPLAY_HEIGHT, draw_history, &ctx);
+    for (int x = 0; x < width; x++)
+        CHECK(column_is_drawn(&render_ctx, x) == (x > width - 50));
+
+    chart_destroy(&ctx);
+    render_destroy(&render_ctx);
+}
+
+/*
+ * Push the specified range of samples of a ramp, so no column is flat.
+ */
+static void push_ramp(ChartCtx* ctx, int first, int last) {
+    for (int i = first; i < last; i++) {
+        const float values[NUM_CHANNELS] = { i, 2 * i, (i % 50) * 3 };
+        chart_push(ctx, i, values, NUM_CHANNELS);
+    }
+}
+
+/*
+ * Render a view of the log of the specified chart in stripes, and get a hash
+ * of the pixels of the panel.
+ */
+static uint64_t render_log_view(RenderCtx* render_ctx, ChartCtx* ctx) {
+    const int width = ctx->history_size;
+    render_area(render_ctx, 0, 0, width, DISPLAY_HEIGHT, draw_history, ctx);
+    fake_lcd_complete_transfers();
+    CHECK(ctx->log_view_samples == 4 * width);
+
+    uint64_t hash = UINT64_C(14695981039346656037);
+    for (int y = 0; y < DISPLAY_HEIGHT; y++)
+        for (int x = 0; x < width; x++)
+            hash = (hash ^ fake_lcd_get_pixel(x, y)) * UINT64_C(1099511628211);
+    return hash;
+}
+
+/*
+ * Check that the columns collapsed from the log, which are kept between the
+ * stripes of a frame, are decoded again after new samples are pushed: a view
+ * rendered after pushing more samples must match the same view of a chart
+ * that only rendered it once.
+ */
+static void test_log_view(void) {
+    const int width         = 64;
+    const size_t log_budget = 16 * 1024;
+
+    RenderCtx render_ctx;
+    render_init(&render_ctx, width, DISPLAY_HEIGHT, RENDER_STRIPES);
+    chart_set_colors(&render_ctx, 1.f);
+
+    ChartCtx updated, fresh;
+    chart_init(&updated,
+               NUM_CHANNELS,
+               width,
+               DISPLAY_HEIGHT,
+               SHRINK_DWELL,
+               1,
+               NULL);
+    chart_init(&fresh,
+               NUM_CHANNELS,
+               width,
+               DISPLAY_HEIGHT,
+               SHRINK_DWELL,
+               1,
+               NULL);
+    chart_init_log(&updated, log_budget);
+    chart_init_log(&fresh, log_budget);
+
+    push_ramp(&updated, 0, 300);
+    const uint64_t old_hash = render_log_view(&render_ctx, &updated);
+    push_ramp(&updated, 300, 350);
+    const uint64_t updated_hash = render_log_view(&render_ctx, &updated);
+
+    push_ramp(&fresh, 0, 350);
+    const uint64_t fresh_hash = render_log_view(&render_ctx, &fresh);
+    CHECK(updated_hash == fresh_hash);
+    CHECK(updated_hash != old_hash);
+
+    chart_destroy(&updated);
+    chart_destroy(&fresh);
+    render_destroy(&render_ctx);
+}
+
+/*
+ * Number of full-width rows transferred at once from a staging buffer. See
+ * 'STAGING_HEIGHT' in render.c.
+ */
+#define STAGING_HEIGHT 12
+
+/*
+ * Area of a readout drawn in the top-left corner of the display.
+ */
+#define READOUT_WIDTH  48
+#define READOUT_HEIGHT 16
+
+/*
+ * Redraw the newest column of the chart at the left edge of the area being
+ * drawn, like the display modes that update single columns.
+ */
+static void draw_newest_column(RenderCtx* render_ctx, void* arg) {
+    const ChartCtx* ctx = arg;
+    render_clear(render_ctx);
+    chart_render_column(ctx, render_ctx, render_ctx->clip_rect.x0, 0);
+}
+
+static void draw_readout(RenderCtx* render_ctx, void* arg) {
+    render_clear(render_ctx);
+    render_draw_line(render_ctx,
+                     0,
+                     0,
+                     READOUT_WIDTH - 1,
+                     READOUT_HEIGHT - 1,
+                     1);
+}
+
+/*
+ * Flush the framebuffer, and check the transfers counted by the render context
+ * for the flush, and the ones actually received by the panel.
+ */
+static void check_flush(RenderCtx* render_ctx,
+                        int num_transfers,
+                        size_t num_bytes) {
+    const size_t old_transfers = fake_lcd_get_num_transfers();
+    const size_t old_bytes     = fake_lcd_get_num_bytes();
+    render_flush(render_ctx);
+    fake_lcd_complete_transfers();
+
+    CHECK(render_ctx->last_flush_transfers == num_transfers);
+    CHECK(render_ctx->last_flush_bytes == num_bytes);
+    CHECK(fake_lcd_get_num_transfers() - old_transfers == num_transfers);
+    CHECK(fake_lcd_get_num_bytes() - old_bytes == num_bytes);
+}
+
+/*
+ * Check that a flush only transfers the dirty rectangles of the framebuffer,
+ * like a new column and a readout, unless most of the screen is dirty, in which
+ * case the whole screen is transferred as a single rectangle.
+ */
+static void test_dirty_flush(void) {
+    const int width = FAKE_LCD_WIDTH;
+
+    RenderCtx render_ctx;
+    render_init(&render_ctx, width, DISPLAY_HEIGHT, RENDER_FRAMEBUFFER);
+    chart_set_colors(&render_ctx, 1.f);
+
+    ChartCtx ctx;
+    chart_init(&ctx,
+               NUM_CHANNELS,
+               width,
+               DISPLAY_HEIGHT,
+               SHRINK_DWELL,
+               1,
+               NULL);
+    push_ramp(&ctx, 0, 2 * width);
+
+    /* Setting the palette marked the whole screen as dirty */
+    render_flush(&render_ctx);
+
+    /* Each area fits in a staging buffer, and they are too far to be merged */
+    const int x = width - 100;
+    render_area(&render_ctx,
+                x,
+                0,
+                x + 1,
+                DISPLAY_HEIGHT,
+                draw_newest_column,
+                &ctx);
+    render_area(&render_ctx,
+                0,
+                0,
+                READOUT_WIDTH,
+                READOUT_HEIGHT,
+                draw_readout,
+                NULL);
+    const size_t pixels = DISPLAY_HEIGHT + READOUT_WIDTH * READOUT_HEIGHT;
+    check_flush(&render_ctx, 2, pixels * sizeof(uint16_t));
+
+    /* Nothing was drawn since the last flush */
+    check_flush(&render_ctx, 0, 0);
+
+    /*
+     * Two separate areas covering more than half of the screen are transferred
+     * as the whole screen, in chunks of full-width rows, instead of in chunks
+     * of the height that fits each area.
+     */
+    render_area(&render_ctx, 0, 0, 100, DISPLAY_HEIGHT, draw_history, &ctx);
+    render_area(&render_ctx, 200, 0, 300, DISPLAY_HEIGHT, draw_history, &ctx);
+    check_flush(&render_ctx,
+                DIV_CEIL(DISPLAY_HEIGHT, STAGING_HEIGHT),
+                width * DISPLAY_HEIGHT * sizeof(uint16_t));
+
+    chart_destroy(&ctx);
+    render_destroy(&render_ctx);
+}
+
+/*
+ * Display modes of the firmware (see 'DISPLAY_MODE' in main.c), which is not
+ * built for the host, so their drawing is replicated here.
+ */
+typedef enum DisplayMode {
+    DISPLAY_REDRAW,
+    DISPLAY_SWEEP,
+    DISPLAY_HW_SCROLL,
+} DisplayMode;
+
+typedef struct Display {
+    DisplayMode mode;
+    ChartCtx chart;
+
+    /* Number of samples of the view drawn by 'DISPLAY_REDRAW' */
+    int view_samples;
+
+    /* Column after the newest one, for the other modes */
+    int cursor;
+} Display;
+
+/*
+ * Number of frames rendered for each display mode, and number of frames after
+ * which lines are drawn over part of the display.
+ */
+#define NUM_FRAMES  40
+#define LINE_PERIOD 8
+
+static int get_sweep_gap(const Display* display) {
+    return (display->mode == DISPLAY_SWEEP) ? 8 : 0;
+}
+
+/*
+ * Draw the whole chart, erasing the traces of the previous frame, like
+ * 'DISPLAY_REDRAW' does.
+ */
+static void draw_redraw(RenderCtx* render_ctx, void* arg) {
+    Display* display = arg;
+    render_erase(render_ctx);
+    chart_render_history(&display->chart, render_ctx, display->view_samples);
+}
+
+/*
+ * Draw the columns of the chart inside the clipping area, relative to the
+ * cursor, like 'DISPLAY_SWEEP' and 'DISPLAY_HW_SCROLL' do.
+ */
+static void draw_around_cursor(RenderCtx* render_ctx, void* arg) {
+    const Display* display = arg;
+    const int width        = render_get_width(render_ctx);
+    const int gap          = get_sweep_gap(display);
+
+    render_clear(render_ctx);
+    for (int x = render_ctx->clip_rect.x0; x < render_ctx->clip_rect.x1; x++) {
+        const int age = ((display->cursor - 1 - x) % width + width) % width;
+        if (age < width - gap)
+            chart_render_column(&display->chart, render_ctx, x, age);
+    }
+}
+
+static void redraw_columns(Display* display,
+                           RenderCtx* render_ctx,
+                           int x,
+                           int num_columns) {
+    const int width  = render_get_width(render_ctx);
+    const int height = render_get_height(render_ctx);
+
+    num_columns             = MIN(num_columns, width);
+    const int first_columns = MIN(num_columns, width - x);
+    render_area(render_ctx,
+                x,
+                0,
+                x + first_columns,
+                height,
+                draw_around_cursor,
+                display);
+    render_area(render_ctx,
+                0,
+                0,
+                num_columns - first_columns,
+                height,
+                draw_around_cursor,
+                display);
+}
+
+/*
+ * Draw lines with endpoints outside of the display, and steep enough to cross
+ * every stripe, over a cleared area.
+ */
+static void draw_lines(RenderCtx* render_ctx, void* arg) {
+    const int width  = render_get_width(render_ctx);
+    const int height = render_get_height(render_ctx);
+
+    render_clear(render_ctx);
+    render_draw_line(render_ctx,
+                     -40,
+                     -30,
+                     width + 50,
+                     height + 20,
+                     CHART_FIRST_COLOR);
+    render_draw_line(render_ctx,
+                     width / 3,
+                     height + 100,
+                     width / 3 + 7,
+                     -100,
+                     CHART_FIRST_COLOR + 1);
+    render_draw_line(render_ctx,
+                     0,
+                     height - 1,
+                     width - 1,
+                     0,
+                     CHART_FIRST_COLOR + 2);
+}
+
+/*
+ * Update the display after the specified number of new columns, like
+ * 'update_display' in main.c, and flush it.
+ */
+static void update_display(Display* display,
+                           RenderCtx* render_ctx,
+                           int num_new,
+                           bool scale_changed) {
+    const int width  = render_get_width(render_ctx);
+    const int height = render_get_height(render_ctx);
+
+    if (display->mode == DISPLAY_REDRAW) {
+        render_area(render_ctx, 0, 0, width, height, draw_redraw, display);
+        render_flush(render_ctx);
+        return;
+    }
+
+    const int gap         = get_sweep_gap(display);
+    const int num_updated = (display->chart.samples_per_column > 1) ? 1 : 0;
+    const int old_cursor  = display->cursor;
+    display->cursor       = (old_cursor + num_new) % width;
+    if (scale_changed || num_updated + num_new + gap >= width) {
+        redraw_columns(display, render_ctx, 0, width);
+    } else {
+        redraw_columns(display,
+                       render_ctx,
+                       (old_cursor - num_updated + width) % width,
+                       num_updated + num_new);
+        if (gap > 0)
+            redraw_columns(display,
+                           render_ctx,
+                           (old_cursor + gap) % width,
+                           num_new);
+    }
+
+    render_flush(render_ctx);
+    if (display->mode == DISPLAY_HW_SCROLL)
+        render_scroll(render_ctx, display->cursor);
+}
+
+/*
+ * Push the specified number of samples of sawtooth waves, so the scale of the
+ * chart settles, and so it has steep edges that cross many stripes.
+ */
+static int push_sawtooth(ChartCtx* ctx,
+                         uint64_t* state,
+                         int* num_pushed,
+                         int num_samples) {
+    int num_new = 0;
+    for (int i = 0; i < num_samples; i++) {
+        const int n                      = (*num_pushed)++;
+        const float noise                = (float)(test_random(state) % 9);
+        const float values[NUM_CHANNELS] = {
+            (n * 7) % 1000 + noise,
+            (n * 13 + 300) % 1000 + noise,
+            (n % 60 < 30) ? 100.f + noise : 900.f - noise,
+        };
+        num_new += chart_push(ctx, n, values, NUM_CHANNELS);
+    }
+    return num_new;
+}
+
+/*
+ * Render the frames of the specified display mode through the specified
+ * buffers, and store the pixels of the panel after each frame.
+ */
+static void render_frames(DisplayMode mode,
+                          int samples_per_column,
+                          bool tiered,
+                          RenderBuffering buffering,
+                          uint16_t* frames) {
+    const int width = FAKE_LCD_WIDTH;
+
+    RenderCtx render_ctx;
+    render_init(&render_ctx, width, DISPLAY_HEIGHT, buffering);
+    chart_set_colors(&render_ctx, 1.f);
+
+    Display display = {
+        .mode         = mode,
+        .view_samples = width * samples_per_column,
+        .cursor       = 0,
+    };
+    chart_init(&display.chart,
+               NUM_CHANNELS,
+               width,
+               DISPLAY_HEIGHT,
+               SHRINK_DWELL,
+               samples_per_column,
+               NULL);
+
+    /* The view spans more samples than the columns, so it's drawn from tiers */
+    if (tiered) {
+        const size_t budgets[] = {
+            (width + 1) * NUM_CHANNELS * sizeof(ChartBucket),
+            (width + 1) * NUM_CHANNELS * sizeof(ChartBucket),
+        };
+        chart_init_tiers(&display.chart, budgets, LENGTH(budgets));
+        display.view_samples *= 4;
+    }
+
+    uint64_t state = 1;
+    int num_pushed = 0;
+    int num_new    = push_sawtooth(&display.chart,
+                                   &state,
+                                   &num_pushed,
+                                   display.view_samples);
+
+    for (int frame = 0; frame < NUM_FRAMES; frame++) {
+        /* The whole display is drawn on the first frame */
+        const bool scale_changed =
+          chart_update_minmax(&display.chart) || frame == 0;
+        update_display(&display, &render_ctx, num_new, scale_changed);
+
+        /* An area that is not aligned to the stripes, nor to the display */
+        if (frame % LINE_PERIOD == LINE_PERIOD - 1) {
+            render_area(&render_ctx, 37, 5, 290, 229, draw_lines, NULL);
+            render_flush(&render_ctx);
+        }
+
+        fake_lcd_complete_transfers();
+        uint16_t* pixels = &frames[(size_t)frame * width * DISPLAY_HEIGHT];
+        for (int y = 0; y < DISPLAY_HEIGHT; y++)
+            for (int x = 0; x < width; x++)
+                *pixels++ = fake_lcd_get_pixel(x, y);
+
+        const int num_samples = 1 + test_random(&state) % 24;
+        num_new =
+          push_sawtooth(&display.chart, &state, &num_pushed, num_samples);
+    }
+
+    chart_destroy(&display.chart);
+    render_destroy(&render_ctx);
+}
+
+/*
+ * Check that rendering a display mode in stripes produces the same pixels on
+ * the panel as rendering it into a framebuffer, on every frame. The stripes
+ * clip the spans and lines at their boundaries, and can't erase the traces of
+ * the previous frame, so they fall back to clearing.
+ */
+static void check_stripes_match(DisplayMode mode,
+                                int samples_per_column,
+                                bool tiered) {
+    const size_t num_pixels =
+      (size_t)NUM_FRAMES * FAKE_LCD_WIDTH * DISPLAY_HEIGHT;
+    uint16_t* expected = malloc(num_pixels * sizeof(uint16_t));
+    uint16_t* actual   = malloc(num_pixels * sizeof(uint16_t));
+    CHECK(expected != NULL && actual != NULL);
+
+    render_frames(mode,
+                  samples_per_column,
+                  tiered,
+                  RENDER_FRAMEBUFFER,
+                  expected);
+    render_frames(mode, samples_per_column, tiered, RENDER_STRIPES, actual);
+    for (size_t i = 0; i < num_pixels; i++)
+        CHECK(actual[i] == expected[i]);
+
+    free(expected);
+    free(actual);
+}
+
+int main(void) {
+    static const int history_sizes[] = { 1, 2, 7, 320 };
+    for (size_t i = 0; i < LENGTH(history_sizes); i++) {
+        for (int quantized = 0; quantized <= 1; quantized++) {
+            check_random_pushes(history_sizes[i], 1, quantized, 0);
+            check_random_pushes(history_sizes[i], 3, quantized, 0);
+            check_random_pushes(history_sizes[i], 1, quantized, 100000);
+        }
+    }
+
+    test_partial_tier();
+    test_log_view();
+    test_dirty_flush();
+
+    check_stripes_match(DISPLAY_REDRAW, 1, false);
+    check_stripes_match(DISPLAY_REDRAW, 3, true);
+    check_stripes_match(DISPLAY_SWEEP, 1, false);
+    check_stripes_match(DISPLAY_SWEEP, 3, false);
+    check_stripes_match(DISPLAY_HW_SCROLL, 1, false);
+
+    printf("All chart tests passed\n");
+    return 0;
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Differential test of 'decimal_parse' against 'strtof', over fixed edge cases
+ * and millions of random plain decimal numbers.
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "decimal.h"
+#include "test.h"
+#include "util.h"
+
+#define NUM_RANDOM_INPUTS 5000000
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Check that 'decimal_parse' and 'strtof' agree on the specified input: both
+ * must succeed or fail, and on success, they must return the same bits and
+ * consume the same characters. Returns false if they don't agree.
+ */
+static bool agrees_with_strtof(const char* str) {
+    errno = 0;
+    char* expected_end;
+    const float expected      = strtof(str, &expected_end);
+    const bool expected_valid = expected_end != str && errno != ERANGE;
+
+    const char* end;
+    float result;
+    const bool valid = decimal_parse(str, &end, &result);
+
+    if (valid != expected_valid)
+        return false;
+    if (!valid)
+        return true;
+    return end == expected_end &&
+           memcmp(&result, &expected, sizeof(float)) == 0;
+}
+
+static void append_digits(char* dst,
+                          size_t* pos,
+                          int num_digits,
+                          uint64_t* state) {
+    for (int i = 0; i < num_digits; i++)
+        dst[(*pos)++] = '0' + test_random(state) % 10;
+}
+
+/*
+ * Write a random number in the format sent through the serial port (optional
+ * sign, digits, optional fraction and optional exponent) to 'dst', followed by
+ * a random terminator. Most numbers are short, like real values, but some have
+ * enough digits or a large enough exponent to need the fallback path.
+ */
+static void generate_number(char* dst, uint64_t* state) {
+    static const char* const terminators[] = {
+        "", " ", ",", "\n", "x", "e", "e+", ".",
+    };
+    size_t pos = 0;
+
+    const uint64_t sign = test_random(state) % 4;
+    if (sign == 1)
+        dst[pos++] = '-';
+    else if (sign == 2)
+        dst[pos++] = '+';
+
+    const bool is_long    = test_random(state) % 8 == 0;
+    const int max_digits  = is_long ? 12 : 5;
+    const int int_digits  = test_random(state) % (max_digits + 1);
+    const int frac_digits = test_random(state) % (max_digits + 1);
+    append_digits(dst, &pos, int_digits, state);
+    if (frac_digits > 0 || test_random(state) % 4 == 0) {
+        dst[pos++] = '.';
+        append_digits(dst, &pos, frac_digits, state);
+    }
+
+    if (test_random(state) % 4 == 0) {
+        dst[pos++] = (test_random(state) % 2 == 0) ? 'e' : 'E';
+        const uint64_t exponent_sign = test_random(state) % 3;
+        if (exponent_sign == 1)
+            dst[pos++] = '-';
+        else if (exponent_sign == 2)
+            dst[pos++] = '+';
+        append_digits(dst,
+                      &pos,
+                      1 + test_random(state) % (is_long ? 3 : 2),
+                      state);
+    }
+
+    const char* terminator =
+      terminators[test_random(state) % LENGTH(terminators)];
+    strcpy(&dst[pos], terminator);
+}
+
+/*----------------------------------------------------------------------------*/
+
+int main(void) {
+    static const char* const edge_cases[] = {
+        /* Signs, missing parts and terminators */
+        "0", "-0", "+0", "0.0", "-0.0", ".5", "5.", ".", "-", "+", "", " 1",
+        "e5", "1e", "1e+", "1e-", "1.5e3x",
+
+        /* Limits of the exact mantissa and powers of ten */
+        "16777216", "16777217", "167772161", "1e10", "1e11", "1e-10", "1e-11",
+        "0.1", "0.3", "3.14159", "-273.15", "00000000001", "1.000000000",
+
+        /* Limits of the float range */
+        "1e38", "3.4028235e38", "3.5e38", "1e39", "1e-38", "1e-45", "1e-46",
+        "1e99999", "1e-99999", "0e99999",
+        "123456789012345678901234567890", "0.000000000000000000001",
+
+        /* Special values, handled by the fallback */
+        "inf", "-inf", "nan", "infinity",
+    };
+
+    for (size_t i = 0; i < LENGTH(edge_cases); i++) {
+        if (!agrees_with_strtof(edge_cases[i])) {
+            fprintf(stderr, "Mismatch on edge case \"%s\"\n", edge_cases[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    uint64_t state = 1;
+    for (int i = 0; i < NUM_RANDOM_INPUTS; i++) {
+        char str[64];
+        generate_number(str, &state);
+        if (!agrees_with_strtof(str)) {
+            fprintf(stderr, "Mismatch on random input \"%s\"\n", str);
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("%zu edge cases and %d random inputs match 'strtof'\n",
+           LENGTH(edge_cases),
+           NUM_RANDOM_INPUTS);
+    return 0;
+}
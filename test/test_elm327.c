@@ -0,0 +1,353 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Test of the ELM327 client against an emulated adapter, which runs on its own
+ * thread on the other end of a pseudo-terminal. The emulator responds to the
+ * requests like an adapter with echo, linefeeds, spaces and headers disabled,
+ * connected to a CAN vehicle with one or more ECUs.
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "elm327.h"
+#include "pty_uart.h"
+#include "test.h"
+#include "util.h"
+
+/*
+ * Time that the emulated adapter waits for more responses when the request
+ * doesn't include their number, in milliseconds.
+ */
+#define EMULATOR_TIMEOUT_MS 50
+
+/*
+ * Data returned by an emulated ECU for a PID.
+ */
+typedef struct EmulatedPid {
+    int ecu;
+    uint8_t pid;
+    uint8_t num_bytes;
+    uint8_t data[2];
+} EmulatedPid;
+
+static const EmulatedPid emulated_pids[] = {
+    { 0, ELM327_PID_ENGINE_RPM,     2, { 0x1A, 0xF8 } },
+    { 0, ELM327_PID_VEHICLE_SPEED,  1, { 0x32 } },
+    { 0, ELM327_PID_COOLANT_TEMP,   1, { 0x7B } },
+    { 0, ELM327_PID_THROTTLE,       1, { 0x80 } },
+    { 0, ELM327_PID_MODULE_VOLTAGE, 2, { 0x31, 0x38 } },
+    { 0, ELM327_PID_MAF_RATE,       2, { 0x04, 0xD2 } },
+    { 0, ELM327_PID_AMBIENT_TEMP,   1, { 0x41 } },
+    { 1, ELM327_PID_COOLANT_TEMP,   1, { 0x7B } },
+    { 1, ELM327_PID_OIL_TEMP,       1, { 0x82 } },
+};
+
+/* Number of ECUs that respond, and setup commands that will be rejected */
+static atomic_int g_num_ecus            = 1;
+static atomic_int g_num_rejected_setups = 0;
+
+/* Last OBD request, and number of times the emulator waited for its timeout */
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static char g_last_request[32];
+static int g_num_timeouts = 0;
+
+/*----------------------------------------------------------------------------*/
+
+static void write_string(int fd, const char* str) {
+    const size_t len = strlen(str);
+    CHECK(write(fd, str, len) == (ssize_t)len);
+}
+
+static void append_hex(char* dst, size_t dst_size, const uint8_t* bytes,
+                       size_t num_bytes) {
+    for (size_t i = 0; i < num_bytes; i++) {
+        const size_t len = strlen(dst);
+        snprintf(&dst[len], dst_size - len, "%02X", bytes[i]);
+    }
+}
+
+/*
+ * Respond to a mode 01 request. Each ECU that supports some of the PIDs sends
+ * a message with them, in a single CAN frame or in several, and the adapter
+ * stops after the number of frames in the final digit of the request, if any.
+ */
+static void respond_obd(int fd, const char* request) {
+    const size_t request_len = strlen(request);
+    const int num_pids       = (request_len - 2) / 2;
+    int max_frames           = 0;
+    if (request_len % 2 != 0)
+        sscanf(&request[request_len - 1], "%1x", (unsigned*)&max_frames);
+
+    uint8_t pids[ELM327_MAX_PIDS_PER_REQUEST];
+    CHECK(num_pids <= ELM327_MAX_PIDS_PER_REQUEST);
+    for (int i = 0; i < num_pids; i++) {
+        unsigned pid;
+        CHECK(sscanf(&request[2 + i * 2], "%2x", &pid) == 1);
+        pids[i] = pid;
+    }
+
+    pthread_mutex_lock(&g_lock);
+    snprintf(g_last_request, sizeof(g_last_request), "%s", request);
+    pthread_mutex_unlock(&g_lock);
+
+    char response[512] = "";
+    int num_frames     = 0;
+    for (int ecu = 0; ecu < atomic_load(&g_num_ecus); ecu++) {
+        uint8_t message[64] = { 0x41 };
+        size_t message_size = 1;
+        for (int i = 0; i < num_pids; i++) {
+            for (size_t j = 0; j < LENGTH(emulated_pids); j++) {
+                const EmulatedPid* emulated = &emulated_pids[j];
+                if (emulated->ecu != ecu || emulated->pid != pids[i])
+                    continue;
+                message[message_size++] = emulated->pid;
+                memcpy(&message[message_size],
+                       emulated->data,
+                       emulated->num_bytes);
+                message_size += emulated->num_bytes;
+            }
+        }
+        if (message_size == 1)
+            continue;
+
+        if (message_size <= 7) {
+            if (max_frames > 0 && num_frames >= max_frames)
+                break;
+            append_hex(response, sizeof(response), message, message_size);
+            strcat(response, "\r");
+            num_frames++;
+            continue;
+        }
+
+        /* Multi-frame message, with the last frame padded */
+        snprintf(&response[strlen(response)],
+                 sizeof(response) - strlen(response),
+                 "%03zX\r",
+                 message_size);
+        size_t pos = 0;
+        for (int frame = 0; pos < message_size; frame++) {
+            if (max_frames > 0 && num_frames >= max_frames)
+                break;
+
+            const size_t frame_size = (frame == 0) ? 6 : 7;
+            snprintf(&response[strlen(response)],
+                     sizeof(response) - strlen(response),
+                     "%X:",
+                     frame % 16);
+            append_hex(response, sizeof(response), &message[pos], frame_size);
+            strcat(response, "\r");
+            pos += frame_size;
+            num_frames++;
+        }
+    }
+
+    if (num_frames == 0)
+        strcat(response, "NO DATA\r");
+
+    /* Without the number of responses, the adapter waits for more of them */
+    if (max_frames == 0 || num_frames < max_frames) {
+        pthread_mutex_lock(&g_lock);
+        g_num_timeouts++;
+        pthread_mutex_unlock(&g_lock);
+        usleep(EMULATOR_TIMEOUT_MS * 1000);
+    }
+
+    strcat(response, "\r>");
+    write_string(fd, response);
+}
+
+/*
+ * Read commands from the specified file descriptor, and respond to them like
+ * an ELM327 adapter.
+ */
+static void* emulator(void* arg) {
+    const int fd = *(int*)arg;
+    bool echo    = true;
+
+    char command[64];
+    size_t command_len = 0;
+    for (;;) {
+        char c;
+        if (read(fd, &c, 1) != 1)
+            return NULL;
+        if (echo)
+            CHECK(write(fd, &c, 1) == 1);
+
+        if (c != '\r') {
+            if (command_len < sizeof(command) - 1)
+                command[command_len++] = c;
+            continue;
+        }
+        command[command_len] = '\0';
+        command_len          = 0;
+
+        if (strcmp(command, "ATZ") == 0) {
+            echo = true;
+            write_string(fd, "\r\rELM327 v1.5\r\r>");
+        } else if (strcmp(command, "ATE0") == 0) {
+            echo = false;
+            write_string(fd, "OK\r\r>");
+        } else if (strcmp(command, "ATSP0") == 0 &&
+                   atomic_load(&g_num_rejected_setups) > 0) {
+            atomic_fetch_sub(&g_num_rejected_setups, 1);
+            write_string(fd, "?\r\r>");
+        } else if (strncmp(command, "AT", 2) == 0) {
+            write_string(fd, "OK\r\r>");
+        } else if (strncmp(command, "01", 2) == 0 &&
+                   strlen(command) >= 4) {
+            respond_obd(fd, command);
+        } else {
+            write_string(fd, "?\r\r>");
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void get_last_request(char* dst, size_t dst_size, int* num_timeouts) {
+    pthread_mutex_lock(&g_lock);
+    snprintf(dst, dst_size, "%s", g_last_request);
+    *num_timeouts = g_num_timeouts;
+    pthread_mutex_unlock(&g_lock);
+}
+
+/*
+ * Request the specified PIDs, and check the request that was sent, whether the
+ * emulator had to wait for its timeout, and the number of decoded PIDs. Each
+ * decoded value is checked against the data of the emulated ECUs, and the
+ * rest must be left untouched.
+ */
+static void check_read(const uint8_t* pids,
+                       int num_pids,
+                       const char* expected_request,
+                       bool expected_timeout,
+                       int expected_decoded) {
+    char request[32];
+    int timeouts_before, timeouts_after;
+    get_last_request(request, sizeof(request), &timeouts_before);
+
+    float values[ELM327_MAX_PIDS_PER_REQUEST];
+    for (int i = 0; i < num_pids; i++)
+        values[i] = NAN;
+    const int num_decoded = elm327_read_pids(pids, num_pids, values);
+
+    get_last_request(request, sizeof(request), &timeouts_after);
+    if (strcmp(request, expected_request) != 0) {
+        fprintf(stderr,
+                "Sent request '%s', expected '%s'\n",
+                request,
+                expected_request);
+        exit(EXIT_FAILURE);
+    }
+    CHECK((timeouts_after > timeouts_before) == expected_timeout);
+    CHECK(num_decoded == expected_decoded);
+
+    int num_valid = 0;
+    for (int i = 0; i < num_pids; i++) {
+        if (isnan(values[i]))
+            continue;
+        num_valid++;
+
+        const EmulatedPid* emulated = NULL;
+        for (size_t j = 0; j < LENGTH(emulated_pids); j++)
+            if (emulated_pids[j].pid == pids[i])
+                emulated = &emulated_pids[j];
+        CHECK(emulated != NULL);
+
+        uint32_t raw = emulated->data[0];
+        if (emulated->num_bytes == 2)
+            raw = (raw << 8) | emulated->data[1];
+
+        float scale, offset;
+        CHECK(elm327_get_pid_format(pids[i], &scale, &offset));
+        CHECK(values[i] == raw * scale + offset);
+    }
+    CHECK(num_valid == num_decoded);
+}
+
+int main(void) {
+    int fd = pty_uart_open();
+    pthread_t thread;
+    CHECK(pthread_create(&thread, NULL, emulator, &fd) == 0);
+
+    /* A failed initialization can be retried without reinstalling the driver */
+    atomic_store(&g_num_rejected_setups, 1);
+    CHECK(!elm327_init());
+    CHECK(elm327_init());
+    CHECK(pty_uart_get_num_installs() == 1);
+
+    /* Single PID, in a single frame */
+    const uint8_t rpm[] = { ELM327_PID_ENGINE_RPM };
+    check_read(rpm, LENGTH(rpm), "010C1", false, 1);
+
+    /* Six PIDs, whose response takes three frames */
+    const uint8_t six[] = {
+        ELM327_PID_ENGINE_RPM, ELM327_PID_VEHICLE_SPEED,
+        ELM327_PID_COOLANT_TEMP, ELM327_PID_THROTTLE,
+        ELM327_PID_MODULE_VOLTAGE, ELM327_PID_AMBIENT_TEMP,
+    };
+    check_read(six, LENGTH(six), "010C0D051142463", false, 6);
+    check_read(six, 2, "010C0D1", false, 2);
+
+    /*
+     * Responses of 6 and 7 bytes fit in a single frame. Otherwise, the first
+     * frame has room for 6 bytes and each consecutive frame for 7, so 13
+     * bytes take two frames and 14 bytes take three.
+     */
+    const uint8_t seven[] = { ELM327_PID_ENGINE_RPM, ELM327_PID_MAF_RATE };
+    check_read(seven, LENGTH(seven), "010C101", false, 2);
+    const uint8_t thirteen[] = {
+        ELM327_PID_ENGINE_RPM,   ELM327_PID_MAF_RATE, ELM327_PID_VEHICLE_SPEED,
+        ELM327_PID_COOLANT_TEMP, ELM327_PID_THROTTLE,
+    };
+    check_read(thirteen, LENGTH(thirteen), "010C100D05112", false, 5);
+    const uint8_t fourteen[] = {
+        ELM327_PID_ENGINE_RPM,     ELM327_PID_MAF_RATE,
+        ELM327_PID_MODULE_VOLTAGE, ELM327_PID_VEHICLE_SPEED,
+        ELM327_PID_COOLANT_TEMP,
+    };
+    check_read(fourteen, LENGTH(fourteen), "010C10420D053", false, 5);
+
+    /*
+     * With a second ECU, which has a PID that the first one doesn't, the frame
+     * of the first ECU is all the adapter waits for. From then on, the number
+     * of responses is not sent, so both ECUs are received. A PID sent by both
+     * ECUs is only counted once.
+     */
+    atomic_store(&g_num_ecus, 2);
+    const uint8_t split[] = { ELM327_PID_ENGINE_RPM, ELM327_PID_OIL_TEMP };
+    check_read(split, LENGTH(split), "010C5C1", false, 1);
+    check_read(split, LENGTH(split), "010C5C", true, 2);
+    const uint8_t both[] = { ELM327_PID_COOLANT_TEMP, ELM327_PID_OIL_TEMP };
+    check_read(both, LENGTH(both), "01055C", true, 2);
+
+    /* Unsupported PIDs */
+    const uint8_t fuel[] = { ELM327_PID_FUEL_LEVEL };
+    check_read(fuel, LENGTH(fuel), "012F", true, 0);
+
+    printf("All ELM327 tests passed\n");
+    return 0;
+}
@@ -0,0 +1,221 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Round-trip and corruption tests of 'frame_decode_sample', using the frames of
+ * the host-side encoder.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frame.h"
+#include "frame_encoder.h"
+#include "test.h"
+
+#define NUM_RANDOM_FRAMES 100000
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Decode the specified encoded frame, which ends with its delimiter.
+ */
+static bool decode(const uint8_t* encoded,
+                   size_t encoded_size,
+                   float* dst,
+                   int num_values,
+                   uint16_t* sequence) {
+    CHECK(encoded_size > 0 && encoded[encoded_size - 1] == FRAME_DELIMITER);
+    return frame_decode_sample(encoded,
+                               encoded_size - 1,
+                               dst,
+                               num_values,
+                               sequence);
+}
+
+/*
+ * Check that float frames with random bits, including infinities and NaNs,
+ * round-trip exactly.
+ */
+static void test_f32_round_trip(uint64_t* state) {
+    for (int i = 0; i < NUM_RANDOM_FRAMES; i++) {
+        const int num_values    = 1 + test_random(state) % 16;
+        const uint16_t sequence = test_random(state);
+
+        float values[16];
+        for (int j = 0; j < num_values; j++) {
+            const uint32_t bits = test_random(state);
+            memcpy(&values[j], &bits, sizeof(float));
+        }
+
+        uint8_t encoded[FRAME_ENCODER_MAX_SIZE];
+        const size_t size =
+          frame_encode_f32(values, num_values, sequence, encoded);
+        CHECK(memchr(encoded, FRAME_DELIMITER, size - 1) == NULL);
+
+        float decoded[16];
+        uint16_t decoded_sequence;
+        CHECK(decode(encoded, size, decoded, num_values, &decoded_sequence));
+        CHECK(memcmp(decoded, values, num_values * sizeof(float)) == 0);
+        CHECK(decoded_sequence == sequence);
+    }
+}
+
+/*
+ * Check that integer frames are decoded to the correctly rounded value of
+ * 'raw * 10^exponent', as parsed by 'strtof' from its decimal representation.
+ */
+static void test_i16_round_trip(uint64_t* state) {
+    for (int i = 0; i < NUM_RANDOM_FRAMES; i++) {
+        const int num_values    = 1 + test_random(state) % 16;
+        const int exponent      = (int)(test_random(state) % 21) - 10;
+        const uint16_t sequence = test_random(state);
+
+        int16_t raw[16];
+        for (int j = 0; j < num_values; j++)
+            raw[j] = (int16_t)test_random(state);
+
+        uint8_t encoded[FRAME_ENCODER_MAX_SIZE];
+        const size_t size =
+          frame_encode_i16(raw, num_values, exponent, sequence, encoded);
+
+        float decoded[16];
+        uint16_t decoded_sequence;
+        CHECK(decode(encoded, size, decoded, num_values, &decoded_sequence));
+        CHECK(decoded_sequence == sequence);
+
+        for (int j = 0; j < num_values; j++) {
+            char str[32];
+            snprintf(str, sizeof(str), "%de%d", raw[j], exponent);
+            CHECK(decoded[j] == strtof(str, NULL));
+        }
+    }
+}
+
+/*
+ * Check the largest frames, whose COBS encoding needs a full 254-byte block.
+ */
+static void test_largest_frames(void) {
+    float values[62];
+    for (int i = 0; i < 62; i++)
+        values[i] = 1000.f + i;
+
+    uint8_t encoded[FRAME_ENCODER_MAX_SIZE];
+    size_t size = frame_encode_f32(values, 62, 1, encoded);
+
+    float decoded[124];
+    uint16_t sequence;
+    CHECK(decode(encoded, size, decoded, 62, &sequence));
+    CHECK(memcmp(decoded, values, sizeof(values)) == 0);
+    CHECK(frame_encode_f32(values, 63, 1, encoded) == 0);
+
+    int16_t raw[124];
+    for (int i = 0; i < 124; i++)
+        raw[i] = 0x0101 * (1 + i % 100);
+
+    size = frame_encode_i16(raw, 124, 0, 2, encoded);
+    CHECK(decode(encoded, size, decoded, 124, &sequence));
+    for (int i = 0; i < 124; i++)
+        CHECK(decoded[i] == raw[i]);
+}
+
+/*
+ * Check that frames with an unexpected number of values or an exponent out of
+ * range are rejected, like empty and truncated frames, and that 'dst' is left
+ * untouched.
+ */
+static void test_invalid_fields(void) {
+    const float values[4] = { 1.f, 2.f, 3.f, 4.f };
+    const float sentinel  = 123.f;
+    float decoded[8]      = { sentinel, sentinel, sentinel, sentinel,
+                              sentinel, sentinel, sentinel, sentinel };
+    uint16_t sequence;
+
+    uint8_t encoded[FRAME_ENCODER_MAX_SIZE];
+    size_t size = frame_encode_f32(values, 4, 7, encoded);
+    CHECK(!decode(encoded, size, decoded, 3, &sequence));
+    CHECK(!decode(encoded, size, decoded, 5, &sequence));
+
+    /* Exponents out of range, with a valid CRC */
+    const int16_t raw[4] = { 1, 2, 3, 4 };
+    size = frame_encode_i16(raw, 4, 11, 7, encoded);
+    CHECK(!decode(encoded, size, decoded, 4, &sequence));
+    size = frame_encode_i16(raw, 4, -11, 7, encoded);
+    CHECK(!decode(encoded, size, decoded, 4, &sequence));
+
+    /* Empty and truncated frames */
+    CHECK(!frame_decode_sample(encoded, 0, decoded, 4, &sequence));
+    size = frame_encode_f32(values, 4, 7, encoded);
+    for (size_t i = 1; i < size - 1; i++)
+        CHECK(!frame_decode_sample(encoded, i, decoded, 4, &sequence));
+
+    for (int i = 0; i < 8; i++)
+        CHECK(decoded[i] == sentinel);
+}
+
+/*
+ * Check that replacing any single byte of an encoded frame with any other value
+ * makes the frame invalid. The CRC detects all errors of up to 16 consecutive
+ * bits in the decoded frame, but a corrupted COBS code byte moves data around
+ * instead, so every case is checked.
+ */
+static void test_corruption(void) {
+    const float values[4] = { 812.25f, 42.f, 87.f, 13.9f };
+
+    uint8_t encoded[FRAME_ENCODER_MAX_SIZE];
+    const size_t size = frame_encode_f32(values, 4, 0x1234, encoded) - 1;
+
+    int num_undetected = 0;
+    for (size_t pos = 0; pos < size; pos++) {
+        for (int byte = 0; byte < 256; byte++) {
+            if (byte == encoded[pos])
+                continue;
+
+            uint8_t corrupted[FRAME_ENCODER_MAX_SIZE];
+            memcpy(corrupted, encoded, size);
+            corrupted[pos] = byte;
+
+            float decoded[4];
+            uint16_t sequence;
+            if (frame_decode_sample(corrupted, size, decoded, 4, &sequence)) {
+                fprintf(stderr,
+                        "Undetected corruption: byte %zu set to 0x%02X\n",
+                        pos,
+                        byte);
+                num_undetected++;
+            }
+        }
+    }
+
+    CHECK(num_undetected == 0);
+}
+
+int main(void) {
+    uint64_t state = 1;
+    test_f32_round_trip(&state);
+    test_i16_round_trip(&state);
+    test_largest_frames();
+    test_invalid_fields();
+    test_corruption();
+
+    printf("All frame tests passed\n");
+    return 0;
+}
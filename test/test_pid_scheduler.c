@@ -0,0 +1,264 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Tests of 'PidScheduler' with a simulated clock: batching of the due
+ * channels, starvation of low-priority channels, the look-ahead horizon of the
+ * round-trip time, and the achieved rates.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pid_scheduler.h"
+#include "test.h"
+#include "util.h"
+
+/*
+ * Maximum number of PIDs in each simulated request.
+ */
+#define MAX_BATCH 6
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Simulated adapter: each request takes 'rtt_us', and the value of each
+ * channel is received, except on every other poll of the channels whose bits
+ * are set in 'lost_mask'.
+ */
+typedef struct Simulation {
+    PidScheduler sched;
+    int64_t now_us;
+    int64_t rtt_us;
+    int max_batch;
+    unsigned lost_mask;
+
+    /* Number of requests, and of polls of each channel */
+    int num_requests;
+    int num_polls[PID_SCHEDULER_MAX_CHANNELS];
+} Simulation;
+
+static void sim_init(Simulation* sim,
+                     const PidSchedulerConfig* configs,
+                     int num_channels,
+                     int64_t rtt_us,
+                     int max_batch) {
+    sim->now_us    = 1000000;
+    sim->rtt_us    = rtt_us;
+    sim->max_batch = max_batch;
+    sim->lost_mask = 0;
+
+    sim->num_requests = 0;
+    for (int i = 0; i < PID_SCHEDULER_MAX_CHANNELS; i++)
+        sim->num_polls[i] = 0;
+
+    pid_scheduler_init(&sim->sched, configs, num_channels, sim->now_us);
+}
+
+/*
+ * Wait until a channel is due, like the ingestion task, and send a request.
+ * Returns the number of polled channels, which are stored in 'batch'.
+ */
+static int sim_step(Simulation* sim, int* batch) {
+    sim->now_us += pid_scheduler_time_until_due(&sim->sched, sim->now_us);
+
+    const int num_polled =
+      pid_scheduler_next_batch(&sim->sched, sim->now_us, batch, sim->max_batch);
+    CHECK(num_polled > 0 && num_polled <= sim->max_batch);
+
+    bool received[PID_SCHEDULER_MAX_CHANNELS];
+    for (int i = 0; i < num_polled; i++) {
+        const bool lost = (sim->lost_mask & (1u << batch[i])) != 0;
+        received[i]     = !lost || sim->num_polls[batch[i]] % 2 == 0;
+        sim->num_polls[batch[i]]++;
+    }
+
+    const int64_t start_us = sim->now_us;
+    sim->now_us += sim->rtt_us;
+    pid_scheduler_complete(&sim->sched,
+                           batch,
+                           received,
+                           num_polled,
+                           start_us,
+                           sim->now_us);
+    sim->num_requests++;
+    return num_polled;
+}
+
+static void sim_run(Simulation* sim, int64_t duration_us) {
+    const int64_t end_us = sim->now_us + duration_us;
+    while (sim->now_us < end_us) {
+        int batch[MAX_BATCH];
+        sim_step(sim, batch);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Channels with the same rate are always polled together, in as few requests
+ * as 'max_channels' allows, and channels with different rates only add the
+ * requests of the fastest one.
+ */
+static void test_batching(void) {
+    static const PidSchedulerConfig configs[] = {
+        { 0x0C, 10.f, 0 }, { 0x0D, 10.f, 0 }, { 0x05, 10.f, 0 },
+        { 0x11, 10.f, 0 }, { 0x0F, 5.f, 0 },  { 0x46, 1.f, 0 },
+    };
+
+    Simulation sim;
+    sim_init(&sim, configs, LENGTH(configs), 20000, MAX_BATCH);
+
+    int batch[MAX_BATCH];
+    CHECK(sim_step(&sim, batch) == 6);
+
+    /* Each channel at 10 Hz is polled 10 times per second, in 10 requests */
+    const int first_requests = sim.num_requests;
+    sim_run(&sim, 10000000);
+    CHECK(sim.num_requests - first_requests == 100);
+    for (int i = 0; i < 4; i++)
+        CHECK(sim.num_polls[i] == 101);
+    CHECK(sim.num_polls[4] == 51);
+    CHECK(sim.num_polls[5] == 11);
+
+    /* With three PIDs per request, the six due ones take two requests */
+    sim_init(&sim, configs, LENGTH(configs), 20000, 3);
+    CHECK(sim_step(&sim, batch) == 3);
+    CHECK(sim_step(&sim, batch) == 3);
+    CHECK(pid_scheduler_time_until_due(&sim.sched, sim.now_us) > 0);
+}
+
+/*
+ * A low-priority channel is still polled when a high-priority one is always
+ * due, since its score grows with the periods it's overdue.
+ */
+static void test_starvation(void) {
+    static const PidSchedulerConfig configs[] = {
+        { 0x0C, 20.f, 2 },
+        { 0x05, 1.f, 0 },
+    };
+
+    /* The requests take longer than the period of the first channel */
+    Simulation sim;
+    sim_init(&sim, configs, LENGTH(configs), 60000, 1);
+    sim_run(&sim, 60000000);
+
+    /* It's polled after being overdue by around two periods */
+    CHECK(sim.num_polls[1] >= 15 && sim.num_polls[1] <= 30);
+    CHECK(sim.num_polls[0] > 30 * sim.num_polls[1]);
+}
+
+/*
+ * Channels that will be due before a request completes join it, according to
+ * the measured round-trip time, which follows the latency of the adapter.
+ */
+static void test_horizon(void) {
+    static const PidSchedulerConfig configs[] = {
+        { 0x0C, 10.f, 0 },
+        { 0x0D, 10.f, 0 },
+    };
+
+    PidScheduler sched;
+    pid_scheduler_init(&sched, configs, LENGTH(configs), 0);
+
+    /* Without a measurement, only the due channels are selected */
+    sched.channels[1].next_due_us = 30000;
+    int batch[MAX_BATCH];
+    CHECK(pid_scheduler_next_batch(&sched, 0, batch, MAX_BATCH) == 1);
+    CHECK(batch[0] == 0);
+
+    /* With a round-trip time of 40 ms, the second one joins the first */
+    const bool received[] = { true, true };
+    pid_scheduler_complete(&sched, batch, received, 1, 0, 40000);
+    CHECK(sched.rtt_us == 40000);
+    sched.channels[0].next_due_us = 100000;
+    sched.channels[1].next_due_us = 130000;
+    CHECK(pid_scheduler_next_batch(&sched, 100000, batch, MAX_BATCH) == 2);
+
+    /* Once the adapter gets faster, it doesn't anymore */
+    for (int i = 0; i < 64; i++)
+        pid_scheduler_complete(&sched, batch, received, 0, 0, 10000);
+    CHECK(sched.rtt_us >= 10000 && sched.rtt_us <= 10003);
+    CHECK(pid_scheduler_next_batch(&sched, 100000, batch, MAX_BATCH) == 1);
+    CHECK(batch[0] == 0);
+
+    /*
+     * The average of a noisy latency is not biased: differences are rounded
+     * towards zero in both directions.
+     */
+    uint64_t state   = 1;
+    int64_t sum_us   = 0;
+    const int warmup = 1000;
+    const int total  = 100000;
+    for (int i = 0; i < total; i++) {
+        const int64_t rtt_us = 10000 + (int64_t)(test_random(&state) % 41) - 20;
+        pid_scheduler_complete(&sched, batch, received, 0, 0, rtt_us);
+        if (i >= warmup)
+            sum_us += sched.rtt_us;
+    }
+    const double mean_us = (double)sum_us / (total - warmup);
+    CHECK(mean_us > 9999.5 && mean_us < 10000.5);
+}
+
+/*
+ * The achieved rate of each channel is measured over each rate window,
+ * counting only the values that were received.
+ */
+static void test_achieved_rate(void) {
+    static const PidSchedulerConfig configs[] = {
+        { 0x0C, 10.f, 0 },
+        { 0x0D, 4.f, 0 },
+        { 0x05, 10.f, 0 },
+    };
+
+    Simulation sim;
+    sim_init(&sim, configs, LENGTH(configs), 25000, MAX_BATCH);
+    sim.lost_mask = 1u << 2;
+
+    /* The rates are reported once per window */
+    int num_windows = 0;
+    while (num_windows < 3) {
+        const int64_t window_start_us = sim.sched.window_start_us;
+        int batch[MAX_BATCH];
+        sim_step(&sim, batch);
+        if (sim.sched.window_start_us == window_start_us)
+            continue;
+
+        CHECK(sim.now_us - window_start_us >= PID_SCHEDULER_RATE_WINDOW_US);
+        num_windows++;
+    }
+
+    const float* rates[] = { &sim.sched.channels[0].achieved_hz,
+                             &sim.sched.channels[1].achieved_hz,
+                             &sim.sched.channels[2].achieved_hz };
+    CHECK(*rates[0] > 9.8f && *rates[0] < 10.2f);
+    CHECK(*rates[1] > 3.8f && *rates[1] < 4.2f);
+    CHECK(*rates[2] > 4.8f && *rates[2] < 5.2f);
+}
+
+int main(void) {
+    test_batching();
+    test_starvation();
+    test_horizon();
+    test_achieved_rate();
+
+    printf("All PID scheduler tests passed\n");
+    return 0;
+}
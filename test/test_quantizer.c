@@ -0,0 +1,101 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Round-trip test of the quantized chart history with the values of every OBD
+ * PID known by the ELM327 client: each value decoded from a raw OBD value must
+ * be stored as that raw value, and converted back to the same float.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "chart.h"
+#include "elm327.h"
+#include "test.h"
+
+/*
+ * Chart height and dwell of its axis, which don't matter for the codes.
+ */
+#define DISPLAY_HEIGHT 240
+#define SHRINK_DWELL   10
+
+/*
+ * Number of raw values of the largest PIDs, which have 2 data bytes. The
+ * values of 1-byte PIDs are a subset.
+ */
+#define NUM_RAW_VALUES 65536
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Push every raw value of a PID with the specified format into a quantized
+ * chart with a single column, and check its code. Returns the number of values
+ * that didn't round-trip.
+ */
+static int check_pid(uint8_t pid, const ChartFormat* format) {
+    ChartCtx ctx;
+    chart_init(&ctx, 1, 1, DISPLAY_HEIGHT, SHRINK_DWELL, 1, format);
+
+    int num_mismatches = 0;
+    for (uint32_t raw = 0; raw < NUM_RAW_VALUES; raw++) {
+        /* Decoded like 'elm327_read_pids', as checked by 'test_elm327' */
+        const float value = raw * format->scale + format->offset;
+        chart_push(&ctx, raw, &value, 1);
+
+        const uint16_t code    = ctx.codes[0];
+        const float round_trip = code * format->scale + format->offset;
+        if (code != raw || memcmp(&round_trip, &value, sizeof(float)) != 0) {
+            if (num_mismatches == 0)
+                fprintf(stderr,
+                        "PID %02X: raw value %u (%.9g) stored as code %u "
+                        "(%.9g)\n",
+                        pid,
+                        raw,
+                        value,
+                        code,
+                        round_trip);
+            num_mismatches++;
+        }
+    }
+
+    chart_destroy(&ctx);
+    return num_mismatches;
+}
+
+int main(void) {
+    int num_pids       = 0;
+    int num_mismatches = 0;
+    for (int pid = 0; pid <= UINT8_MAX; pid++) {
+        ChartFormat format;
+        if (!elm327_get_pid_format(pid, &format.scale, &format.offset))
+            continue;
+
+        num_mismatches += check_pid(pid, &format);
+        num_pids++;
+    }
+
+    CHECK(num_pids > 0);
+    CHECK(num_mismatches == 0);
+
+    printf("All quantizer tests passed (%d PIDs, %d values each)\n",
+           num_pids,
+           NUM_RAW_VALUES);
+    return 0;
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Tests of 'SampleLog': samples with random timestamps and values, including
+ * NaNs and infinities, must be decoded bit-exactly from any position, also
+ * after the oldest blocks were discarded.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sample_log.h"
+#include "test.h"
+#include "util.h"
+
+#define NUM_CHANNELS 4
+#define NUM_SAMPLES  100000
+
+/*
+ * Number of random positions read from the log after each check.
+ */
+#define NUM_SEEKS 64
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Every appended sample, for comparing the decoded ones.
+ */
+static int64_t g_timestamps[NUM_SAMPLES];
+static uint32_t g_values[NUM_SAMPLES][NUM_CHANNELS];
+
+/*
+ * Generate the timestamp and values of each sample: mostly a constant rate
+ * with some jitter, and values that change slowly, with occasional gaps,
+ * repeated timestamps, jumps and random bit patterns.
+ */
+static void generate_samples(uint64_t* state) {
+    int64_t timestamp          = 1000;
+    float values[NUM_CHANNELS] = { 0.f, 90.f, 800.f, 13.8f };
+    for (int i = 0; i < NUM_SAMPLES; i++) {
+        const uint64_t r = test_random(state) % 256;
+        if (r == 0)
+            timestamp += (int64_t)1 << 40; /* Doesn't fit in any class */
+        else if (r < 4)
+            timestamp += test_random(state) % 10000000;
+        else if (r >= 8)
+            timestamp += 50000 + (int64_t)(test_random(state) % 2001) - 1000;
+        g_timestamps[i] = timestamp;
+
+        for (int j = 0; j < NUM_CHANNELS; j++) {
+            const uint64_t v = test_random(state) % 64;
+            if (v == 0) {
+                const uint32_t bits = test_random(state);
+                memcpy(&values[j], &bits, sizeof(float));
+            } else if (v < 32) {
+                values[j] += (float)(test_random(state) % 9) * 0.25f - 1.f;
+            }
+            memcpy(&g_values[i][j], &values[j], sizeof(float));
+        }
+    }
+}
+
+static void append_sample(SampleLog* log, int index) {
+    float values[NUM_CHANNELS];
+    memcpy(values, g_values[index], sizeof(values));
+    sample_log_append(log, g_timestamps[index], values);
+}
+
+/*
+ * Read the log from the specified position until its end, and check that the
+ * samples match the appended ones, given the number of appended samples.
+ */
+static void check_read(const SampleLog* log,
+                       int64_t num_appended,
+                       int64_t sample_index) {
+    const int64_t first_index = num_appended - log->num_samples;
+
+    SampleLogReader reader;
+    sample_log_seek(&reader, log, sample_index);
+
+    int64_t timestamp;
+    float values[NUM_CHANNELS];
+    for (int64_t i = first_index + sample_index; i < num_appended; i++) {
+        CHECK(sample_log_read(&reader, &timestamp, values));
+        CHECK(timestamp == g_timestamps[i]);
+        CHECK(memcmp(values, g_values[i], sizeof(values)) == 0);
+    }
+    CHECK(!sample_log_read(&reader, &timestamp, values));
+}
+
+/*
+ * Check the summaries of the blocks in use, and read the whole log and some
+ * random positions of it.
+ */
+static void check_log(const SampleLog* log,
+                      int64_t num_appended,
+                      uint64_t* state) {
+    int64_t num_samples = 0;
+    for (int i = 0; i < log->num_used_blocks; i++) {
+        const SampleLogBlock* block =
+          &log->blocks[(log->first_block + i) % log->num_blocks];
+        CHECK(block->num_samples > 0);
+        CHECK(block->first_timestamp <= block->last_timestamp);
+        num_samples += block->num_samples;
+    }
+    CHECK(num_samples == log->num_samples);
+    CHECK(log->num_samples <= num_appended);
+
+    check_read(log, num_appended, 0);
+    for (int i = 0; i < NUM_SEEKS && log->num_samples > 0; i++)
+        check_read(log,
+                   num_appended,
+                   test_random(state) % log->num_samples);
+}
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Check a log large enough for every sample, so none is discarded.
+ */
+static void test_round_trip(uint64_t* state) {
+    SampleLog log;
+    sample_log_init(&log, NUM_CHANNELS, (size_t)NUM_SAMPLES * 32);
+    check_log(&log, 0, state);
+
+    for (int i = 0; i < NUM_SAMPLES; i++)
+        append_sample(&log, i);
+    CHECK(log.num_samples == NUM_SAMPLES);
+    CHECK(log.num_used_blocks < log.num_blocks);
+    check_log(&log, NUM_SAMPLES, state);
+
+    sample_log_destroy(&log);
+}
+
+/*
+ * Check small logs, whose oldest blocks are discarded many times, so only the
+ * latest samples remain. Their budgets include the summaries of the blocks.
+ */
+static void test_wrap_around(uint64_t* state) {
+    static const int num_blocks[] = { 1, 2, 5 };
+    const size_t block_bytes = SAMPLE_LOG_BLOCK_SIZE + sizeof(SampleLogBlock);
+    for (size_t i = 0; i < LENGTH(num_blocks); i++) {
+        SampleLog log;
+        sample_log_init(&log, NUM_CHANNELS, num_blocks[i] * block_bytes);
+        CHECK(log.num_blocks == num_blocks[i]);
+        CHECK(sample_log_get_num_bytes(&log) == num_blocks[i] * block_bytes);
+
+        for (int j = 0; j < NUM_SAMPLES; j++) {
+            append_sample(&log, j);
+            CHECK(log.num_used_blocks <= log.num_blocks);
+            if (j % 997 == 0 || j == NUM_SAMPLES - 1)
+                check_log(&log, j + 1, state);
+        }
+        CHECK(log.num_samples < NUM_SAMPLES);
+        CHECK(log.num_used_blocks == log.num_blocks);
+
+        sample_log_destroy(&log);
+    }
+}
+
+int main(void) {
+    uint64_t state = 1;
+    generate_samples(&state);
+
+    test_round_trip(&state);
+    test_wrap_around(&state);
+
+    printf("All sample log tests passed\n");
+    return 0;
+}
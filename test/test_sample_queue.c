@@ -0,0 +1,191 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Stress test of 'SampleQueue', with the producer and the consumer running on
+ * separate threads, like the ingestion and render tasks.
+ */
+
+#include <pthread.h>
+#include <sched.h> /* sched_yield */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "sample_queue.h"
+#include "test.h"
+#include "util.h"
+
+#define NUM_SAMPLES 2000000
+
+/*
+ * Small capacity, so the positions wrap around the array very often.
+ */
+#define QUEUE_CAPACITY 8
+
+/*----------------------------------------------------------------------------*/
+
+typedef struct StressCtx {
+    SampleQueue queue;
+
+    /* Whether the producer retries pushing into a full queue */
+    bool lossless;
+
+    /* Set by the producer after pushing its last sample */
+    atomic_bool producer_done;
+} StressCtx;
+
+/*
+ * Fill the specified sample from its sequence number, so the consumer can
+ * detect samples that were torn, duplicated, reordered or lost.
+ */
+static void make_sample(Sample* dst, int64_t sequence) {
+    dst->timestamp_us = sequence;
+    for (int i = 0; i < SAMPLE_MAX_CHANNELS; i++)
+        dst->values[i] = (float)((sequence * (i + 1)) % 1000003);
+}
+
+static bool sample_is_intact(const Sample* sample) {
+    Sample expected;
+    make_sample(&expected, sample->timestamp_us);
+    for (int i = 0; i < SAMPLE_MAX_CHANNELS; i++)
+        if (sample->values[i] != expected.values[i])
+            return false;
+    return true;
+}
+
+static void* producer(void* arg) {
+    StressCtx* ctx = arg;
+
+    uint64_t state = 2;
+    for (int64_t i = 0; i < NUM_SAMPLES; i++) {
+        Sample sample;
+        make_sample(&sample, i);
+        while (!sample_queue_push(&ctx->queue, &sample) && ctx->lossless)
+            sched_yield();
+
+        /* Sometimes fall behind, so the queue runs empty */
+        if (test_random(&state) % 16 == 0)
+            sched_yield();
+    }
+
+    atomic_store(&ctx->producer_done, true);
+    return NULL;
+}
+
+/*
+ * Run the producer on a new thread, and consume its samples on this one, in
+ * batches of random sizes. Returns the number of received samples.
+ */
+static int64_t run_stress(bool lossless) {
+    StressCtx ctx;
+    ctx.lossless = lossless;
+    atomic_init(&ctx.producer_done, false);
+    sample_queue_init(&ctx.queue, QUEUE_CAPACITY);
+
+    pthread_t thread;
+    CHECK(pthread_create(&thread, NULL, producer, &ctx) == 0);
+
+    uint64_t state        = 1;
+    int64_t num_received  = 0;
+    int64_t last_sequence = -1;
+    for (;;) {
+        /*
+         * If the producer was done before popping, an empty queue means that
+         * every sample was either received or dropped.
+         */
+        const bool producer_done = atomic_load(&ctx.producer_done);
+
+        Sample batch[QUEUE_CAPACITY * 2];
+        const size_t max_samples = 1 + test_random(&state) % LENGTH(batch);
+        const size_t count = sample_queue_pop(&ctx.queue, batch, max_samples);
+        CHECK(count <= max_samples);
+
+        for (size_t i = 0; i < count; i++) {
+            CHECK(sample_is_intact(&batch[i]));
+            CHECK(batch[i].timestamp_us > last_sequence);
+            if (lossless)
+                CHECK(batch[i].timestamp_us == last_sequence + 1);
+            last_sequence = batch[i].timestamp_us;
+        }
+        num_received += count;
+
+        /* Sometimes fall behind too, so the queue fills up */
+        if (count == 0 || test_random(&state) % 64 == 0)
+            sched_yield();
+
+        if (count == 0 && producer_done)
+            break;
+    }
+
+    CHECK(pthread_join(thread, NULL) == 0);
+
+    /* When the producer retries, each failed push is counted as a drop */
+    if (lossless)
+        CHECK(num_received == NUM_SAMPLES);
+    else
+        CHECK(num_received + atomic_load(&ctx.queue.dropped) == NUM_SAMPLES);
+
+    sample_queue_destroy(&ctx.queue);
+    return num_received;
+}
+
+/*
+ * Check the behavior of a queue on a single thread: empty and full queues, and
+ * the order of the samples.
+ */
+static void test_single_thread(void) {
+    SampleQueue queue;
+    sample_queue_init(&queue, 4);
+
+    Sample batch[8];
+    CHECK(sample_queue_pop(&queue, batch, LENGTH(batch)) == 0);
+
+    for (int i = 0; i < 4; i++) {
+        Sample sample;
+        make_sample(&sample, i);
+        CHECK(sample_queue_push(&queue, &sample));
+    }
+
+    Sample sample;
+    make_sample(&sample, 4);
+    CHECK(!sample_queue_push(&queue, &sample));
+    CHECK(atomic_load(&queue.dropped) == 1);
+
+    CHECK(sample_queue_pop(&queue, batch, 3) == 3);
+    CHECK(batch[0].timestamp_us == 0 && batch[2].timestamp_us == 2);
+    CHECK(sample_queue_push(&queue, &sample));
+    CHECK(sample_queue_pop(&queue, batch, LENGTH(batch)) == 2);
+    CHECK(batch[0].timestamp_us == 3 && batch[1].timestamp_us == 4);
+    CHECK(sample_is_intact(&batch[1]));
+
+    sample_queue_destroy(&queue);
+}
+
+int main(void) {
+    test_single_thread();
+
+    run_stress(true);
+    const int64_t num_received = run_stress(false);
+
+    printf("All queue tests passed (%lld of %d samples received when the "
+           "producer doesn't wait)\n",
+           (long long)num_received,
+           NUM_SAMPLES);
+    return 0;
+}
@@ -0,0 +1,214 @@
+/*
+ * Copyright 2025 8dcc
+ *
+ * This file is part of ESP32 CYD OBD2.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Test of 'serial_uart_read_record' through the fake UART driver: detection of
+ * the record format, and resynchronization after corrupted data.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "serial_uart.h"
+#include "frame.h"
+#include "fake_uart.h"
+#include "frame_encoder.h"
+#include "test.h"
+#include "util.h"
+
+#define NUM_CHANNELS 4
+
+/*
+ * Stream under construction, and the expected result of reading each of its
+ * records.
+ */
+static uint8_t g_stream[4096];
+static size_t g_stream_size = 0;
+
+static struct {
+    bool valid;
+    float values[NUM_CHANNELS];
+} g_expected[32];
+static int g_num_expected = 0;
+
+/*----------------------------------------------------------------------------*/
+
+static void append_bytes(const void* data, size_t size) {
+    CHECK(g_stream_size + size <= sizeof(g_stream));
+    memcpy(&g_stream[g_stream_size], data, size);
+    g_stream_size += size;
+}
+
+static void append_string(const char* str) {
+    append_bytes(str, strlen(str));
+}
+
+/*
+ * Append a float frame whose values are 'first' and the next integers.
+ */
+static void append_frame(uint16_t sequence, float first) {
+    const float values[NUM_CHANNELS] = { first, first + 1, first + 2,
+                                         first + 3 };
+    uint8_t encoded[FRAME_ENCODER_MAX_SIZE];
+    append_bytes(encoded,
+                 frame_encode_f32(values, NUM_CHANNELS, sequence, encoded));
+}
+
+static void expect_valid(float first) {
+    g_expected[g_num_expected].valid = true;
+    for (int i = 0; i < NUM_CHANNELS; i++)
+        g_expected[g_num_expected].values[i] = first + i;
+    g_num_expected++;
+}
+
+static void expect_invalid(void) {
+    g_expected[g_num_expected++].valid = false;
+}
+
+/*
+ * Read the records of the stream, in chunks of the specified size, and check
+ * that they match the expected results.
+ */
+static void check_stream(size_t chunk_size) {
+    fake_uart_set_input(g_stream, g_stream_size, chunk_size);
+
+    for (int i = 0; i < g_num_expected; i++) {
+        const float sentinel       = -1.f;
+        float values[NUM_CHANNELS] = { sentinel, sentinel, sentinel,
+                                       sentinel };
+        const bool valid = serial_uart_read_record(values, NUM_CHANNELS);
+        if (valid != g_expected[i].valid) {
+            fprintf(stderr,
+                    "Record %d was %s, expected %s (chunks of %zu bytes)\n",
+                    i,
+                    valid ? "accepted" : "rejected",
+                    g_expected[i].valid ? "accepted" : "rejected",
+                    chunk_size);
+            exit(EXIT_FAILURE);
+        }
+
+        for (int j = 0; j < NUM_CHANNELS; j++)
+            CHECK(values[j] == (valid ? g_expected[i].values[j] : sentinel));
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Check that a binary frame is read as soon as it arrives when the format is
+ * still unknown, even if no newline or large amount of data follows it. The
+ * fake UART exits with an error if the reader keeps waiting after the frame.
+ * Then switch back to ASCII records with an overlong line.
+ */
+static void test_lone_frame(void) {
+    static uint8_t stream[512];
+    size_t size = 0;
+
+    const float values[NUM_CHANNELS] = { 1, 2, 3, 4 };
+    stream[size++]                   = FRAME_DELIMITER;
+    size += frame_encode_f32(values, NUM_CHANNELS, 0xFFFF, &stream[size]);
+    fake_uart_set_input(stream, size, 120);
+
+    float decoded[NUM_CHANNELS];
+    CHECK(serial_uart_read_record(decoded, NUM_CHANNELS));
+    CHECK(decoded[0] == 1.f && decoded[3] == 4.f);
+
+    size = 0;
+    while (size < 300)
+        stream[size++] = '7';
+    stream[size++] = '\n';
+    fake_uart_set_input(stream, size, 120);
+    CHECK(!serial_uart_read_record(decoded, NUM_CHANNELS));
+}
+
+int main(void) {
+    serial_uart_init();
+    test_lone_frame();
+
+    /* ASCII records, with empty lines and both kinds of separators */
+    append_string("1 2 3 4\n\n10,11,12,13\n");
+    expect_valid(1);
+    expect_valid(10);
+
+    /* Malformed and incomplete records are rejected as a unit */
+    append_string("1 2 x 4\n1 2 3\n");
+    expect_invalid();
+    expect_invalid();
+
+    /*
+     * The first delimiter switches to binary mode, discarding the partial line
+     * before it.
+     */
+    append_string("20 21");
+    append_bytes("\0", 1);
+    append_frame(0, 20);
+    expect_valid(20);
+
+    /* A noise byte inside a frame only invalidates that frame */
+    uint8_t encoded[FRAME_ENCODER_MAX_SIZE];
+    const float values[NUM_CHANNELS] = { 30, 31, 32, 33 };
+    const size_t size = frame_encode_f32(values, NUM_CHANNELS, 1, encoded);
+    append_bytes(encoded, 5);
+    append_bytes("\x55", 1);
+    append_bytes(&encoded[5], size - 5);
+    expect_invalid();
+    append_frame(3, 40);
+    expect_valid(40);
+
+    /* Noise between frames invalidates the next frame, but not the rest */
+    append_bytes("\x12\x34", 2);
+    append_frame(4, 50);
+    expect_invalid();
+    append_frame(5, 60);
+    expect_valid(60);
+
+    /*
+     * Data longer than any frame switches back to ASCII mode. The rest of that
+     * line is rejected, and the next one is accepted.
+     */
+    for (int i = 0; i < 150; i++)
+        append_string("7 ");
+    append_string("\n70 71 72 73\n");
+    expect_invalid();
+    expect_valid(70);
+
+    /* The stream is read the same way regardless of how the bytes arrive */
+    static const size_t chunk_sizes[] = { 4096, 120, 7, 1 };
+    for (size_t i = 0; i < LENGTH(chunk_sizes); i++) {
+        SerialUartStats before, after;
+        serial_uart_get_stats(&before);
+        check_stream(chunk_sizes[i]);
+        serial_uart_get_stats(&after);
+
+        CHECK(after.records_accepted - before.records_accepted == 6);
+        CHECK(after.records_rejected - before.records_rejected == 5);
+
+        /*
+         * Frames 1, 2 and 4 were lost. The sequence numbers of the next pass
+         * start over, so only the first one can be checked, which follows the
+         * lone frame.
+         */
+        if (i == 0)
+            CHECK(after.frames_lost - before.frames_lost == 3);
+    }
+
+    printf("All serial tests passed\n");
+    return 0;
+}